@@ -2,6 +2,7 @@
 
 in vec2 UV;
 in vec4 Color;
+in vec3 Overbright;
 
 out vec4 outColor;
 
@@ -11,6 +12,6 @@ const float PI = 3.141592653;
 
 void main() {
 	float angle = atan(UV.x - 0.5, 0.5 - UV.y);
-	outColor = min(Color, 1) + max(Color - 1, 0);
+	outColor = Color + vec4(Overbright, 0);
 	outColor.a *= (-PI + progress * PI * 2 > angle) ? 1 : 0;
 }
\ No newline at end of file
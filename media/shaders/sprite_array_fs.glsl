@@ -0,0 +1,14 @@
+#version 330
+
+in vec2 UV;
+in vec4 Color;
+in vec3 Overbright;
+flat in float Layer;
+
+out vec4 outColor;
+
+uniform sampler2DArray mainTexture;
+
+void main() {
+	outColor = texture(mainTexture, vec3(UV, Layer)) * Color + vec4(Overbright, 0);
+}
\ No newline at end of file
@@ -2,11 +2,12 @@
 
 in vec2 UV;
 in vec4 Color;
+in vec3 Overbright;
 
 out vec4 outColor;
 
 uniform sampler2D mainTexture;
 
 void main() {
-	outColor = texture(mainTexture, UV) * min(Color, 1) + max(Color - 1, 0);
+	outColor = texture(mainTexture, UV) * Color + vec4(Overbright, 0);
 }
\ No newline at end of file
@@ -0,0 +1,39 @@
+#version 330
+
+layout (location = 0) in vec2 inCenter;
+layout (location = 1) in vec2 inSize;
+layout (location = 2) in vec2 inUV;
+layout (location = 3) in vec2 inClipSize;
+layout (location = 4) in vec4 inColor;
+layout (location = 5) in vec3 inOverbright;
+layout (location = 6) in float inLayer;
+layout (location = 7) in float inAngle;
+layout (location = 8) in float inMirror;
+layout (location = 9) in float inShadow;
+
+out vec2 UV;
+out vec4 Color;
+out vec3 Overbright;
+flat out float Layer;
+
+uniform vec2 screenSize;
+uniform vec2 textureSize;
+// Pixels added to all positions, used by static batches
+uniform vec2 offset;
+
+void main() {
+	// Triangle strip corners (0,0) (1,0) (0,1) (1,1)
+	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+	vec2 clipCorner = vec2(inMirror > 0 ? 1 - corner.x : corner.x, corner.y);
+	UV = (inUV + clipCorner * inClipSize) / textureSize;
+	Color = inColor;
+	Overbright = inOverbright;
+	Layer = inLayer;
+
+	vec2 local = (corner - 0.5) * inSize;
+	float c = cos(inAngle);
+	float s = sin(inAngle);
+	vec2 center = inCenter + vec2(0, inShadow);
+	vec2 position = center + vec2(c * local.x - s * local.y, s * local.x + c * local.y);
+	gl_Position = vec4(((position + 0.5) * 0.25 + offset) * vec2(2, -2) / screenSize + vec2(-1, 1), 0, 1);
+}
\ No newline at end of file
@@ -3,15 +3,23 @@
 layout (location = 0) in vec2 inPosition;
 layout (location = 1) in vec2 inUV;
 layout (location = 2) in vec4 inColor;
+layout (location = 3) in float inLayer;
+layout (location = 4) in vec3 inOverbright;
 
 out vec2 UV;
 out vec4 Color;
-out vec4 gl_Position;
+out vec3 Overbright;
+flat out float Layer;
 
 uniform vec2 screenSize;
+uniform vec2 textureSize;
+// Pixels added to all positions, used by static batches
+uniform vec2 offset;
 
 void main() {
-	UV = inUV;
+	UV = inUV / textureSize;
 	Color = inColor;
-	gl_Position = vec4(inPosition * vec2(2, -2) / screenSize + vec2(-1, 1), 0, 1);
+	Overbright = inOverbright;
+	Layer = inLayer;
+	gl_Position = vec4(((inPosition + 0.5) * 0.25 + offset) * vec2(2, -2) / screenSize + vec2(-1, 1), 0, 1);
 }
\ No newline at end of file
@@ -0,0 +1,42 @@
+#version 330
+
+out vec4 outColor;
+
+// Per cell: x is the tile, y the road structure + 1 or 0 when there is none
+uniform usampler2D tileMap;
+uniform vec2 tileClips[32];
+uniform vec2 roadClips[32];
+uniform vec2 camera;
+uniform float pixelScale;
+uniform vec2 screenSize;
+uniform float imageHeight;
+
+uniform sampler2D mainTexture;
+
+vec4 fetch(vec2 clip, vec2 local) {
+	return texelFetch(mainTexture, ivec2(clip.x + local.x, imageHeight - 1 - (clip.y + local.y)), 0);
+}
+
+uvec2 cellAt(ivec2 cell) {
+	if (any(lessThan(cell, ivec2(0))) || any(greaterThanEqual(cell, textureSize(tileMap, 0)))) return uvec2(0u);
+	return texelFetch(tileMap, cell, 0).xy;
+}
+
+vec4 over(vec4 src, vec4 dst) {
+	return vec4(src.rgb * src.a, src.a) + dst * (1 - src.a);
+}
+
+void main() {
+	// Sprite quads are placed an eighth of a pixel down and right, sample the same spot
+	vec2 world = camera + (vec2(gl_FragCoord.x, screenSize.y - gl_FragCoord.y) - 0.125) / pixelScale;
+	ivec2 cell = ivec2(floor(world / 32));
+	vec2 local = floor(world - vec2(cell) * 32);
+
+	// Roads are 64 pixels high and reach into the cell above
+	uvec2 here = cellAt(cell);
+	uvec2 below = cellAt(cell + ivec2(0, 1));
+	vec4 color = over(fetch(tileClips[min(here.x, 31u)], local), vec4(0));
+	if (here.y > 0u) color = over(fetch(roadClips[min(here.y - 1u, 31u)], local + vec2(0, 32)), color);
+	if (below.y > 0u) color = over(fetch(roadClips[min(below.y - 1u, 31u)], local), color);
+	outColor = color;
+}
\ No newline at end of file
@@ -0,0 +1,138 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "Game.h"
+#include "Level.h"
+#include "Sfx.h"
+#include "AudioClip.h"
+#include "Sprite.h"
+#include "Vec2.h"
+#include <sstream>
+#include <string>
+
+struct BuildInfo {
+	bool canBuildMultiple;
+	float opsToBuild;
+	float siliconToBuild;
+	const Sprite& sprite;
+	float buildOpsRemaining{ 0 };
+	int inProgressCount{ 0 };
+	int readyCount{ 0 };
+	std::string name;
+	std::string desc;
+
+	BuildInfo(const char* name, const char* desc, bool canBuildMultiple, float opsToBuild, float siliconToBuild, const Sprite& sprite)
+		: name(name),
+		desc(desc),
+		canBuildMultiple(canBuildMultiple),
+		opsToBuild(opsToBuild),
+		siliconToBuild(siliconToBuild),
+		sprite(sprite)
+	{
+	}
+	virtual ~BuildInfo() {}
+
+	const std::string& tooltip(float gflops) {
+		std::stringstream sstr;
+		sstr << name << "\n";
+		sstr << siliconToBuild << " Si\n";
+		sstr << int(opsToBuild/gflops) << " seconds to build\n";
+		sstr << desc << "\n\n";
+		sstr << "Click = Build one\n";
+		sstr << "Ctrl+Click = Build multiple\n";
+
+		tooltip_ = sstr.str();
+		return tooltip_;
+	}
+
+	bool build() {
+		if (inProgressCount <= 0 || canBuildMultiple) {
+			if (inProgressCount == 0) buildOpsRemaining = opsToBuild;
+			inProgressCount++;
+			return true;
+		}
+		return false;
+	}
+
+	virtual void place(int x, int y, Game& game, Sfx& sfx) = 0;
+	virtual bool canPlace(int x, int y, Game& game) = 0;
+
+private:
+	std::string tooltip_;
+};
+
+struct FloorBuildInfo : public BuildInfo {
+	FloorBuildInfo(const char* name, const char* desc, bool canBuildMultiple, float opsToBuild, float siliconToBuild, const Sprite& sprite)
+		: BuildInfo(name, desc, canBuildMultiple, opsToBuild, siliconToBuild, sprite) {}
+
+	virtual void place(int x, int y, Game& game, Sfx& sfx) override {
+		if (canPlace(x, y, game)) {
+			game.level.setTile(x, y, 1 + game.random.below(4));
+			sfx.play(sfx.getAudioClip("media/sounds/thump.wav"));
+			readyCount--;
+		}
+	}
+
+	virtual bool canPlace(int x, int y, Game& game) override {
+		if (game.level.getTile(x, y) != 0) {
+			game.message("Can not place floor here");
+			return false;
+		}
+		return true;
+	}
+};
+
+template<typename T> struct StructureBuildInfo : public BuildInfo {
+	StructureBuildInfo(const char* name, const char* desc, bool canBuildMultiple, float opsToBuild, float siliconToBuild, const Sprite& sprite, void(*fixup)(T*) = nullptr)
+		: BuildInfo(name, desc, canBuildMultiple, opsToBuild, siliconToBuild, sprite), fixup(fixup) {}
+
+	virtual void place(int x, int y, Game& game, Sfx& sfx) override {
+		if (canPlace(x, y, game)) {
+			sfx.play(sfx.getAudioClip("media/sounds/thump.wav"));
+			readyCount--;
+			auto pos = Vec2(x, y) * 32;
+			auto instance = game.spawn<T>(pos);
+			if (fixup) fixup(instance);
+		}
+	}
+
+	virtual bool canPlace(int x, int y, Game& game) override {
+		if (!game.level.getUnits(x, y).empty()) {
+			game.message("This space is already occupied");
+			return false;
+		}
+
+		auto tile = game.level.getTile(x, y);
+		if (tile < 1 || tile > 4) {
+			game.message("Structure must be placed on floor tile");
+			return false;
+		}
+
+		return true;
+	}
+
+	void(*fixup)(T*) { nullptr };
+};
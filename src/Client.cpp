@@ -0,0 +1,198 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Client.h"
+#include "Server.h"
+#include "Snapshot.h"
+#include "Game.h"
+#include "Gfx.h"
+#include "BuildInfo.h"
+#include "sys.h"
+#include "utils.h"
+#include <algorithm>
+#include <cstring>
+
+static const size_t maxSnapshots = 64;
+
+bool Client::open(const char* host, int port) {
+	if (!socket.open(0)) return false;
+	if (!resolveAddress(host, port, server)) return false;
+	log("Connecting to %s:%d.", host, port);
+	return true;
+}
+
+void Client::issue(const Command& command) {
+	pendingCommands.push_back(command);
+}
+
+void Client::update(Game& game, float dt) {
+	char buffer[1500];
+	NetAddress from;
+	int size;
+	while ((size = socket.receive(buffer, sizeof(buffer), from)) >= 0) {
+		if (from != server) continue;
+		receive(game, buffer, size);
+	}
+	sendInput(game);
+	if (snapshots.empty()) return;
+
+	// Stay a little behind the newest snapshot, catch up smoothly unless far off
+	float target = snapshots.back().time - interpolationDelay;
+	renderTime += dt;
+	if (fabs(target - renderTime) > 0.25f) renderTime = target;
+	else renderTime += (target - renderTime) * 0.1f;
+
+	auto next = std::find_if(snapshots.begin(), snapshots.end(), [&](const Snapshot& s) { return s.time > renderTime; });
+	if (next == snapshots.end()) {
+		applyViews(game, nullptr, snapshots.back(), 1);
+	}
+	else if (next == snapshots.begin()) {
+		applyViews(game, nullptr, *next, 1);
+	}
+	else {
+		auto& previous = *(next - 1);
+		float span = next->time - previous.time;
+		applyViews(game, &previous, *next, span > 0 ? (renderTime - previous.time) / span : 1);
+	}
+}
+
+void Client::receive(Game& game, const char* data, int size) {
+	PacketReader in(data, size);
+	ServerPacket packet;
+	in.read(packet);
+	if (!in.good() || memcmp(packet.magic, serverMagic, 4) != 0 || packet.sequence <= latestSequence) return;
+
+	// Without the baseline the deltas are useless, the server will send a newer one
+	static const ViewSet noViews;
+	const ViewSet* baseline = &noViews;
+	if (packet.baseline) {
+		auto it = std::find_if(snapshots.begin(), snapshots.end(), [&](const Snapshot& s) { return s.sequence == packet.baseline; });
+		if (it == snapshots.end()) return;
+		baseline = &it->views;
+	}
+
+	BuildState builds[BUILD_COUNT];
+	for (auto& state : builds) {
+		in.read(state);
+	}
+	std::vector<TileChange> tiles(packet.tileCount);
+	for (auto& tile : tiles) {
+		in.read(tile);
+	}
+	Snapshot snapshot;
+	snapshot.sequence = packet.sequence;
+	snapshot.time = packet.time;
+	if (!in.good() || !readViewDelta(in, *baseline, snapshot.views)) {
+		log_error("Received a broken snapshot.");
+		return;
+	}
+
+	if (!latestSequence) log("Connected to server.");
+	latestSequence = packet.sequence;
+	snapshots.push_back(std::move(snapshot));
+	while (snapshots.size() > maxSnapshots) {
+		snapshots.pop_front();
+	}
+
+	// Confirmed commands never need to be sent again
+	while (firstPendingCommand < packet.commandAck && !pendingCommands.empty()) {
+		pendingCommands.pop_front();
+		firstPendingCommand++;
+	}
+
+	for (uint32_t i = 0; i < packet.tileCount; i++) {
+		if (packet.firstTile + i != tilesApplied) continue;
+		game.level.setTile(tiles[i].x, tiles[i].y, tiles[i].tile);
+		tilesApplied++;
+	}
+
+	game.splash = packet.splash / 255.0f;
+	game.gameOver = packet.gameOver / 255.0f;
+	game.computingPower = packet.computingPower;
+	game.silicon = packet.silicon;
+	for (int i = 0; i < BUILD_COUNT; i++) {
+		auto info = game.buildInfos[i];
+		info->readyCount = builds[i].ready;
+		info->inProgressCount = builds[i].inProgress;
+		info->buildOpsRemaining = builds[i].progress * info->opsToBuild / 255;
+	}
+}
+
+void Client::sendInput(Game& game) {
+	char buffer[sizeof(ClientPacket) + maxCommandsPerPacket * sizeof(Command)];
+	ClientPacket packet;
+	memcpy(packet.magic, clientMagic, 4);
+	packet.ack = latestSequence;
+	packet.tileAck = tilesApplied;
+	packet.firstCommand = firstPendingCommand;
+	packet.cameraX = int16_t(game.cameraPosition.x);
+	packet.cameraY = int16_t(game.cameraPosition.y);
+	packet.viewWidth = int16_t(game.gfx.width() / game.gfx.getPixelScale());
+	packet.viewHeight = int16_t(game.gfx.height() / game.gfx.getPixelScale());
+	packet.commandCount = uint8_t(std::min(int(pendingCommands.size()), maxCommandsPerPacket));
+	memset(packet.reserved, 0, sizeof(packet.reserved));
+	memcpy(buffer, &packet, sizeof(packet));
+	for (int i = 0; i < packet.commandCount; i++) {
+		memcpy(buffer + sizeof(packet) + i * sizeof(Command), &pendingCommands[i], sizeof(Command));
+	}
+	socket.send(server, buffer, sizeof(packet) + packet.commandCount * sizeof(Command));
+}
+
+void Client::applyViews(Game& game, const Snapshot* from, const Snapshot& to, float alpha) {
+	// Units that left the view or died
+	for (auto it = units.begin(); it != units.end();) {
+		if (findView(to.views, it->first)) {
+			++it;
+			continue;
+		}
+		auto unit = it->second;
+		game.removeUnit(unit, unit->pos);
+		game.units.erase(std::remove(game.units.begin(), game.units.end(), unit), game.units.end());
+		delete unit;
+		it = units.erase(it);
+	}
+
+	for (auto& view : to.views) {
+		auto& unit = units[view.id];
+		if (!unit) {
+			unit = createUnit(UnitType(view.type));
+			if (!unit) {
+				units.erase(view.id);
+				continue;
+			}
+			applyView(view, *unit);
+			game.units.push_back(unit);
+			game.addUnit(unit, unit->pos);
+		}
+
+		auto oldPos = unit->pos;
+		applyView(view, *unit);
+		auto previous = from ? findView(from->views, view.id) : nullptr;
+		if (previous) {
+			auto start = viewPosition(*previous);
+			if ((unit->pos - start).length() < 64) unit->pos = start + (unit->pos - start) * alpha;
+		}
+		game.moveUnit(unit, oldPos, unit->pos);
+	}
+}
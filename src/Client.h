@@ -0,0 +1,76 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "Socket.h"
+#include "NetView.h"
+#include "Lockstep.h"
+#include <deque>
+#include <map>
+#include <vector>
+
+class Game;
+class Unit;
+
+// Thin client for a Server. It only draws what the server sends, forwards
+// commands and renders a little in the past to interpolate between snapshots.
+class Client {
+public:
+	static const int maxCommandsPerPacket = 16;
+	static constexpr float interpolationDelay = 0.1f;
+
+	bool open(const char* host, int port);
+	void issue(const Command& command);
+	// Sends input, reads snapshots and moves the units of the game to the render time
+	void update(Game& game, float dt);
+
+	bool isConnected() const { return latestSequence != 0; }
+	uint64_t bytesSent() const { return socket.bytesSent; }
+	uint64_t bytesReceived() const { return socket.bytesReceived; }
+
+private:
+	struct Snapshot {
+		uint32_t sequence;
+		float time;
+		ViewSet views;
+	};
+
+	void receive(Game& game, const char* data, int size);
+	void sendInput(Game& game);
+	void applyViews(Game& game, const Snapshot* from, const Snapshot& to, float alpha);
+
+private:
+	UdpSocket socket;
+	NetAddress server;
+	std::deque<Snapshot> snapshots;
+	uint32_t latestSequence{ 0 };
+	float renderTime{ 0 };
+	uint32_t tilesApplied{ 0 };
+
+	std::deque<Command> pendingCommands;
+	uint32_t firstPendingCommand{ 0 };
+
+	std::map<uint32_t, Unit*> units;
+};
@@ -0,0 +1,116 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Compress.h"
+#include <cstdint>
+#include <cstring>
+
+// Stream of tokens. A control byte below 128 is followed by (c + 1) literal
+// bytes, otherwise it encodes a match of (c - 128 + minMatch) bytes followed
+// by a 16 bit offset back into the output.
+static const int minMatch = 4;
+static const int maxMatch = 127 + minMatch;
+static const int maxLiterals = 128;
+static const int maxOffset = 65535;
+static const int hashBits = 14;
+
+static inline uint32_t read32(const char* p) {
+	uint32_t v;
+	memcpy(&v, p, 4);
+	return v;
+}
+
+static inline uint32_t hash32(uint32_t v) {
+	return (v * 2654435761u) >> (32 - hashBits);
+}
+
+static void flushLiterals(std::vector<char>& out, const char* start, size_t count) {
+	while (count > 0) {
+		size_t run = count < maxLiterals ? count : maxLiterals;
+		out.push_back(char(run - 1));
+		out.insert(out.end(), start, start + run);
+		start += run;
+		count -= run;
+	}
+}
+
+std::vector<char> compress(const char* data, size_t size) {
+	std::vector<char> out;
+	out.reserve(size / 2 + 16);
+	std::vector<int64_t> table(size_t(1) << hashBits, -1);
+
+	size_t literalStart = 0;
+	size_t i = 0;
+	while (i + minMatch <= size) {
+		auto h = hash32(read32(data + i));
+		auto candidate = table[h];
+		table[h] = i;
+
+		if (candidate >= 0 && i - candidate <= maxOffset && read32(data + candidate) == read32(data + i)) {
+			size_t length = minMatch;
+			while (length < maxMatch && i + length < size && data[candidate + length] == data[i + length]) length++;
+
+			flushLiterals(out, data + literalStart, i - literalStart);
+			uint16_t offset = uint16_t(i - candidate);
+			out.push_back(char(128 + length - minMatch));
+			out.push_back(char(offset & 0xff));
+			out.push_back(char(offset >> 8));
+			i += length;
+			literalStart = i;
+		}
+		else {
+			i++;
+		}
+	}
+	flushLiterals(out, data + literalStart, size - literalStart);
+	return out;
+}
+
+bool decompress(const char* data, size_t size, char* out, size_t outSize) {
+	size_t in = 0;
+	size_t pos = 0;
+	while (in < size) {
+		auto control = uint8_t(data[in++]);
+		if (control < 128) {
+			size_t run = size_t(control) + 1;
+			if (in + run > size || pos + run > outSize) return false;
+			memcpy(out + pos, data + in, run);
+			in += run;
+			pos += run;
+		}
+		else {
+			if (in + 2 > size) return false;
+			size_t length = size_t(control) - 128 + minMatch;
+			size_t offset = uint8_t(data[in]) | (size_t(uint8_t(data[in + 1])) << 8);
+			in += 2;
+			if (offset == 0 || offset > pos || pos + length > outSize) return false;
+			// Byte by byte since source and destination may overlap
+			for (size_t i = 0; i < length; i++) {
+				out[pos + i] = out[pos - offset + i];
+			}
+			pos += length;
+		}
+	}
+	return pos == outSize;
+}
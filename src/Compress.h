@@ -1,4 +1,6 @@
 /*
+MIT License
+
 Copyright(c) 2020 Stephan Unverwerth
 
 Permission is hereby granted, free of charge, to any person obtaining a copy
@@ -22,7 +24,9 @@ SOFTWARE.
 
 #pragma once
 
-#include "Vec2.h"
+#include <vector>
+#include <cstddef>
 
-extern Vec2 cameraPosition;
-extern Vec2 mainCPUPosition;
+// Small byte oriented LZ77 compressor used for save games and level files
+std::vector<char> compress(const char* data, size_t size);
+bool decompress(const char* data, size_t size, char* out, size_t outSize);
@@ -23,10 +23,10 @@ SOFTWARE.
 */
 
 #include "ComputeCore.h"
+#include "Snapshot.h"
 #include "utils.h"
 #include "Game.h"
 #include "Gfx.h"
-#include "globals.h"
 #include <algorithm>
 
 Sprite ComputeCore::sprites[2];
@@ -46,18 +46,18 @@ void ComputeCore::update(float dt, Game& game, Sfx& sfx) {
 	}
 }
 
-void ComputeCore::draw_structure(Gfx& gfx) {
+void ComputeCore::draw(Gfx& gfx, const Vec2& camera) {
+	gfx.setLayer(LAYER_STRUCTURE);
 	int frame = int(time * 8) % 2;
 	Vec4 color = Vec4::WHITE;
 	if (damageTime > 0) color = Vec4(1 + damageTime, 1 + damageTime, 1, 1);
 	if (healTime > 0) color = Vec4(1, 1, 1 + healTime, 1);
-	gfx.drawSprite(sprites[frame], pos - floor(cameraPosition), color);
-}
+	gfx.drawSprite(sprites[frame], pos - camera, color);
 
-void ComputeCore::draw_top(Gfx& gfx) {
+	gfx.setLayer(LAYER_TOP, pos.y - camera.y);
 	if (damageTime > 0 || healTime > 0) {
-		gfx.drawTextureClip(sprites[0].texture, Vec2(100, 100), Vec2(1, 1), pos - floor(cameraPosition) - Vec2(1, 11), Vec2(34, 4), Vec4::BLACK);
-		gfx.drawTextureClip(sprites[0].texture, Vec2(100, 100), Vec2(1, 1), pos - floor(cameraPosition) - Vec2(0, 10), Vec2(32 * health/maxHealth, 2), Vec4(0, 0.7, 0, 1));
+		gfx.drawTextureClip(sprites[0].texture, Vec2(100, 100), Vec2(1, 1), pos - camera - Vec2(1, 11), Vec2(34, 4), Vec4::BLACK);
+		gfx.drawTextureClip(sprites[0].texture, Vec2(100, 100), Vec2(1, 1), pos - camera - Vec2(0, 10), Vec2(32 * health/maxHealth, 2), Vec4(0, 0.7, 0, 1));
 	}
 }
 
@@ -71,3 +71,43 @@ void ComputeCore::heal(float amount) {
 	Unit::heal(amount);
 	healTime = 0.5;
 }
+
+void ComputeCore::hash(StateHash& hash) const {
+	Unit::hash(hash);
+	hash.add(time);
+	hash.add(damageTime);
+	hash.add(healTime);
+	hash.add(animSpeed);
+}
+
+void ComputeCore::write(SnapshotWriter& writer) const {
+	Unit::write(writer);
+	writer.write(time);
+	writer.write(damageTime);
+	writer.write(healTime);
+	writer.write(animSpeed);
+}
+
+void ComputeCore::read(SnapshotReader& reader) {
+	Unit::read(reader);
+	reader.read(time);
+	reader.read(damageTime);
+	reader.read(healTime);
+	reader.read(animSpeed);
+}
+
+void ComputeCore::writeView(ViewWriter& writer) const {
+	Unit::writeView(writer);
+	writer.writeUnorm(health, maxHealth);
+	writer.writeTime(time);
+	writer.writeUnorm(damageTime, 0.5f);
+	writer.writeUnorm(healTime, 0.5f);
+}
+
+void ComputeCore::readView(ViewReader& reader) {
+	Unit::readView(reader);
+	reader.readUnorm(health, maxHealth);
+	reader.readTime(time);
+	reader.readUnorm(damageTime, 0.5f);
+	reader.readUnorm(healTime, 0.5f);
+}
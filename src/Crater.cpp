@@ -23,7 +23,7 @@ SOFTWARE.
 */
 
 #include "Crater.h"
-#include "globals.h"
+#include "Snapshot.h"
 #include "Gfx.h"
 #include "Game.h"
 #include "utils.h"
@@ -37,6 +37,32 @@ void Crater::update(float dt, Game& game, Sfx& sfx) {
 	}
 }
 
-void Crater::draw_floor(Gfx& gfx) {
-	gfx.drawSprite(sprite, pos - floor(cameraPosition), Vec4(1, 1, 1, 1 - time * 0.2));
+void Crater::draw(Gfx& gfx, const Vec2& camera) {
+	gfx.setLayer(LAYER_FLOOR);
+	gfx.drawSprite(sprite, pos - camera, Vec4(1, 1, 1, 1 - time * 0.2));
+}
+
+void Crater::hash(StateHash& hash) const {
+	Unit::hash(hash);
+	hash.add(time);
+}
+
+void Crater::write(SnapshotWriter& writer) const {
+	Unit::write(writer);
+	writer.write(time);
+}
+
+void Crater::read(SnapshotReader& reader) {
+	Unit::read(reader);
+	reader.read(time);
+}
+
+void Crater::writeView(ViewWriter& writer) const {
+	Unit::writeView(writer);
+	writer.writeUnorm(time, 5);
+}
+
+void Crater::readView(ViewReader& reader) {
+	Unit::readView(reader);
+	reader.readUnorm(time, 5);
 }
@@ -31,8 +31,14 @@ class Crater : public Unit {
 public:
 	Crater(const Vec2& pos) : Unit(pos, 0) {}
 	virtual void update(float dt, Game& game, Sfx& sfx) override;
-	virtual void draw_floor(Gfx& gfx) override;
+	virtual void draw(Gfx& gfx, const Vec2& camera) override;
 	virtual bool isCrater() const override { return true; }
+	virtual UnitType type() const override { return UnitType::Crater; }
+	virtual void hash(StateHash& hash) const override;
+	virtual void write(SnapshotWriter& writer) const override;
+	virtual void read(SnapshotReader& reader) override;
+	virtual void writeView(ViewWriter& writer) const override;
+	virtual void readView(ViewReader& reader) override;
 
 public:
 	static Sprite sprite;
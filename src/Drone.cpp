@@ -23,10 +23,10 @@ SOFTWARE.
 */
 
 #include "Drone.h"
+#include "Snapshot.h"
 #include "utils.h"
 #include "Game.h"
 #include "Gfx.h"
-#include "globals.h"
 #include <algorithm>
 #include "DroneDeployer.h"
 
@@ -40,6 +40,11 @@ void Drone::selfdestruct(Game& game) {
 	game.spawnExplosion(pos, false, Faction::Player);
 }
 
+void Drone::forgetDeadUnits() {
+	// Dead targets behave like no target, so this does not change the simulation
+	if (target && !target->alive) target = nullptr;
+}
+
 void Drone::update(float dt, Game& game, Sfx& sfx) {
 	if (target && !target->alive) target = nullptr;
 	if (origin && !origin->alive) origin = nullptr;
@@ -222,15 +227,65 @@ void Drone::updateAttack(float dt, Game& game, Sfx& sfx) {
 	}
 }
 
-void Drone::draw_top(Gfx& gfx) {
+void Drone::draw(Gfx& gfx, const Vec2& camera) {
+	gfx.setLayer(LAYER_TOP);
 	float angle = atan2(speed.y, speed.x);
 	auto color = repair ? Vec4(0.5, 0.5, 1, 1) : Vec4::WHITE;
 
-	gfx.drawRotatedSprite(sprite, pos - floor(cameraPosition) - Vec2(0, height), angle, color);
+	gfx.drawShadowedSprite(sprite, pos - camera, angle, height, color);
 }
 
-void Drone::draw_bottom(Gfx& gfx) {
-	float angle = atan2(speed.y, speed.x);
+void Drone::hash(StateHash& hash) const {
+	Unit::hash(hash);
+	hash.add(speed);
+	hash.add(fireTime);
+	hash.add(numRockets);
+	hash.add(healthpoints);
+	hash.add(height);
+	hash.add(state);
+	hash.add(repair);
+	hashRef(hash, target);
+	hashRef(hash, origin);
+}
+
+void Drone::write(SnapshotWriter& writer) const {
+	Unit::write(writer);
+	writer.write(speed);
+	writer.write(fireTime);
+	writer.write(numRockets);
+	writer.write(healthpoints);
+	writer.write(height);
+	writer.write(state);
+	writer.write(repair);
+	writer.writeRef(target);
+	writer.writeRef(origin);
+}
+
+void Drone::read(SnapshotReader& reader) {
+	Unit::read(reader);
+	reader.read(speed);
+	reader.read(fireTime);
+	reader.read(numRockets);
+	reader.read(healthpoints);
+	reader.read(height);
+	reader.read(state);
+	reader.read(repair);
+	reader.readRef(target);
+	reader.readRef(origin);
+}
+
+void Drone::writeView(ViewWriter& writer) const {
+	Unit::writeView(writer);
+	writer.writeAngle(atan2(speed.y, speed.x));
+	writer.writeUnorm(height, 64);
+	writer.write(repair);
+}
 
-	gfx.drawRotatedSprite(sprite, pos - floor(cameraPosition), angle, Vec4(0, 0, 0, 0.5));
+void Drone::readView(ViewReader& reader) {
+	Unit::readView(reader);
+	float angle;
+	reader.readAngle(angle);
+	speed = Vec2(cos(angle), sin(angle));
+	reader.readUnorm(height, 64);
+	reader.read(repair);
 }
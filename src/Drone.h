@@ -43,8 +43,14 @@ public:
 	virtual void update(float dt, Game& game, Sfx& sfx) override;
 	void updateAttack(float dt, Game& game, Sfx& sfx);
 	void updateRepair(float dt, Game& game, Sfx& sfx);
-	virtual void draw_top(Gfx& gfx) override;
-	virtual void draw_bottom(Gfx& gfx) override;
+	virtual void forgetDeadUnits() override;
+	virtual void draw(Gfx& gfx, const Vec2& camera) override;
+	virtual UnitType type() const override { return UnitType::Drone; }
+	virtual void hash(StateHash& hash) const override;
+	virtual void write(SnapshotWriter& writer) const override;
+	virtual void read(SnapshotReader& reader) override;
+	virtual void writeView(ViewWriter& writer) const override;
+	virtual void readView(ViewReader& reader) override;
 	void selfdestruct(Game& game);
 
 public:
@@ -33,10 +33,15 @@ class DroneDeployer : public Unit {
 public:
 	DroneDeployer(const Vec2& pos);
 	virtual void update(float dt, Game& game, Sfx& sfx) override;
-	virtual void draw_structure(Gfx& gfx) override;
-	virtual void draw_top(Gfx& gfx) override;
+	virtual void draw(Gfx& gfx, const Vec2& camera) override;
 	virtual void damage(int amount, Faction originator) override;
 	virtual bool isDroneDeployer() const override { return true; }
+	virtual UnitType type() const override { return UnitType::DroneDeployer; }
+	virtual void hash(StateHash& hash) const override;
+	virtual void write(SnapshotWriter& writer) const override;
+	virtual void read(SnapshotReader& reader) override;
+	virtual void writeView(ViewWriter& writer) const override;
+	virtual void readView(ViewReader& reader) override;
 	virtual void heal(float amount) override;
 
 public:
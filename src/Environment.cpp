@@ -0,0 +1,225 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Environment.h"
+#include "sys.h"
+#include "BuildInfo.h"
+#include "SharedMemory.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+static const char envMagic[4]{ 'O', 'L', 'C', 'E' };
+static const uint32_t envVersion = 1;
+static const uint32_t envSlotCount = 4;
+static const float envTickTime = 1.0f / 60;
+
+Environment::Environment(int frameSkip) : gfx("", 1280, 800, false, true), sfx(true), frameSkip(std::max(frameSkip, 1)) {}
+
+Environment::~Environment() {
+	delete game;
+}
+
+void Environment::reset(unsigned int seed, EnvObservation& observation) {
+	delete game;
+	time = 0;
+	steps = 0;
+	timer.set(0, time);
+	game = new Game(gfx, sfx, timer);
+	game->start(seed);
+	floorValid = false;
+	game->splash = 0.999f;
+	observe(observation, 0);
+}
+
+void Environment::step(const EnvAction& action, EnvObservation& observation) {
+	if (!game) reset(action.seed, observation);
+
+	act(action);
+
+	int wave = game->nextWaveLevel;
+	for (int i = 0; i < frameSkip && game->gameOver == 0; i++) {
+		time += envTickTime;
+		timer.set(envTickTime, time);
+		game->update();
+	}
+	steps++;
+
+	// A new wave means the previous one was survived
+	float reward = float(game->nextWaveLevel - wave);
+	if (game->gameOver > 0) reward -= 1;
+	observe(observation, reward);
+}
+
+void Environment::act(const EnvAction& action) {
+	if (action.build < 0 || action.build >= BUILD_COUNT) return;
+	auto& info = *game->buildInfos[action.build];
+	// Placing buildings runs unit constructors that draw from the game's generator
+	Random::Use use(game->random);
+
+	switch (action.type) {
+	case ENV_ACTION_BUILD:
+		game->orderBuild(info);
+		break;
+	case ENV_ACTION_PLACE:
+		if (info.readyCount > 0) info.place(action.x, action.y, *game, sfx);
+		break;
+	}
+}
+
+void Environment::observe(EnvObservation& observation, float reward) {
+	observation.step = steps;
+	observation.reward = reward;
+	observation.done = game->gameOver > 0;
+	observation.wave = game->nextWaveLevel;
+	observation.silicon = game->silicon;
+	observation.computingPower = game->computingPower;
+	observation.timeToNextWave = float(game->nextWaveTime - time);
+	for (int i = 0; i < BUILD_COUNT; i++) {
+		observation.readyCount[i] = game->buildInfos[i]->readyCount;
+		observation.inProgressCount[i] = game->buildInfos[i]->inProgressCount;
+	}
+
+	auto& level = game->level;
+	int width = level.width();
+	int height = level.height();
+	int tilesPerCell = std::max(1, (width / envGridSize) * (height / envGridSize));
+
+	// Floor only changes when something is built or blown up
+	if (!floorValid || level.hash() != floorHash) {
+		int floorCounts[envGridSize][envGridSize]{};
+		for (int y = 0; y < height; y++) {
+			int gy = y * envGridSize / height;
+			for (int x = 0; x < width; x++) {
+				int tile = level.getTile(x, y);
+				if (tile >= 1 && tile <= 4) floorCounts[gy][x * envGridSize / width]++;
+			}
+		}
+		for (int gy = 0; gy < envGridSize; gy++) {
+			for (int gx = 0; gx < envGridSize; gx++) {
+				floorGrid[gy][gx] = uint8_t(std::min(255, floorCounts[gy][gx] * 255 / tilesPerCell));
+			}
+		}
+		floorHash = level.hash();
+		floorValid = true;
+	}
+	memcpy(observation.grid[ENV_CHANNEL_FLOOR], floorGrid, sizeof(floorGrid));
+
+	// Count units per grid cell first, then scale to bytes
+	int counts[ENV_CHANNEL_COUNT][envGridSize][envGridSize]{};
+	for (auto unit : game->getUnits()) {
+		if (!unit->isAlive()) continue;
+		int channel;
+		if (unit->isPlayerStructure()) channel = ENV_CHANNEL_STRUCTURES;
+		else if (unit->isSoldier()) channel = ENV_CHANNEL_SOLDIERS;
+		else if (unit->type() == UnitType::Drone) channel = ENV_CHANNEL_DRONES;
+		else continue;
+
+		int x = int(unit->pos.x) / 32;
+		int y = int(unit->pos.y) / 32;
+		if (x < 0 || y < 0 || x >= width || y >= height) continue;
+		counts[channel][y * envGridSize / height][x * envGridSize / width]++;
+	}
+
+	for (int gy = 0; gy < envGridSize; gy++) {
+		for (int gx = 0; gx < envGridSize; gx++) {
+			for (int c = ENV_CHANNEL_STRUCTURES; c < ENV_CHANNEL_COUNT; c++) {
+				observation.grid[c][gy][gx] = uint8_t(std::min(255, counts[c][gy][gx] * 32));
+			}
+		}
+	}
+}
+
+static uint32_t alignRing(size_t size) {
+	return uint32_t((size + 63) & ~size_t(63));
+}
+
+static void runEnvironment(SharedRing actions, SharedRing observations, int frameSkip) {
+	Environment environment(frameSkip);
+	EnvObservation observation{};
+	int idle = 0;
+
+	while (true) {
+		auto action = reinterpret_cast<const EnvAction*>(actions.beginRead());
+		if (!action) {
+			// Spin briefly, then give the core away while the trainer thinks
+			if (++idle > 256) std::this_thread::yield();
+			continue;
+		}
+		idle = 0;
+
+		EnvAction current = *action;
+		actions.endRead();
+		if (current.type == ENV_ACTION_QUIT) return;
+
+		if (current.type == ENV_ACTION_RESET) environment.reset(current.seed, observation);
+		else environment.step(current, observation);
+
+		void* slot;
+		while (!(slot = observations.beginWrite())) {
+			std::this_thread::yield();
+		}
+		memcpy(slot, &observation, sizeof(observation));
+		observations.endWrite();
+	}
+}
+
+int runEnvironments(const char* name, int count, int frameSkip) {
+	if (count <= 0) return 1;
+
+	uint32_t actionRingSize = alignRing(SharedRing::bytes(sizeof(EnvAction), envSlotCount));
+	uint32_t observationRingSize = alignRing(SharedRing::bytes(sizeof(EnvObservation), envSlotCount));
+	size_t size = sizeof(EnvRegionHeader) + size_t(actionRingSize + observationRingSize) * count;
+
+	SharedMemory memory(name, size);
+	if (!memory.isOpen()) return 1;
+
+	auto header = reinterpret_cast<EnvRegionHeader*>(memory.data());
+	header->ready.store(0, std::memory_order_relaxed);
+	memcpy(header->magic, envMagic, 4);
+	header->version = envVersion;
+	header->envCount = count;
+	header->slotCount = envSlotCount;
+	header->actionSize = sizeof(EnvAction);
+	header->observationSize = sizeof(EnvObservation);
+	header->ringStride = actionRingSize + observationRingSize;
+
+	std::vector<std::thread> threads;
+	for (int i = 0; i < count; i++) {
+		char* base = memory.data() + sizeof(EnvRegionHeader) + size_t(header->ringStride) * i;
+		SharedRing actions(base, sizeof(EnvAction), envSlotCount, true);
+		SharedRing observations(base + actionRingSize, sizeof(EnvObservation), envSlotCount, true);
+		threads.emplace_back(runEnvironment, actions, observations, frameSkip);
+	}
+
+	// Trainers wait for this before touching the rings
+	header->ready.store(1, std::memory_order_release);
+	log("Serving %d environments in shared memory %s (%u bytes).", count, name, unsigned(size));
+
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	return 0;
+}
@@ -0,0 +1,122 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "Game.h"
+#include "Gfx.h"
+#include "Sfx.h"
+#include "Timer.h"
+#include <atomic>
+#include <cstdint>
+
+// Step/reset interface around a headless game for training agents. Trainers
+// in another process talk to it through shared memory, see runEnvironments.
+
+static const int envGridSize = 32;
+
+enum EnvChannel {
+	ENV_CHANNEL_FLOOR,
+	ENV_CHANNEL_STRUCTURES,
+	ENV_CHANNEL_SOLDIERS,
+	ENV_CHANNEL_DRONES,
+	ENV_CHANNEL_COUNT,
+};
+
+enum EnvActionType : int32_t {
+	ENV_ACTION_NONE,
+	ENV_ACTION_BUILD,
+	ENV_ACTION_PLACE,
+	ENV_ACTION_RESET,
+	ENV_ACTION_QUIT,
+};
+
+struct EnvAction {
+	int32_t type;
+	int32_t build;	// BuildType for build and place
+	int32_t x;		// Tile to place on
+	int32_t y;
+	uint32_t seed;	// Seed for reset
+};
+
+struct EnvObservation {
+	uint32_t step;
+	float reward;
+	int32_t done;
+	int32_t wave;
+	float silicon;
+	float computingPower;
+	float timeToNextWave;
+	int32_t readyCount[BUILD_COUNT];
+	int32_t inProgressCount[BUILD_COUNT];
+	// Level and unit densities downsampled to envGridSize, 0 to 255
+	uint8_t grid[ENV_CHANNEL_COUNT][envGridSize][envGridSize];
+};
+
+class Environment {
+public:
+	Environment(int frameSkip = 1);
+	~Environment();
+
+	void reset(unsigned int seed, EnvObservation& observation);
+	void step(const EnvAction& action, EnvObservation& observation);
+
+private:
+	void act(const EnvAction& action);
+	void observe(EnvObservation& observation, float reward);
+
+private:
+	Timer timer;
+	Gfx gfx;
+	Sfx sfx;
+	Game* game{ nullptr };
+	int frameSkip;
+	double time{ 0 };
+	uint32_t steps{ 0 };
+	uint8_t floorGrid[envGridSize][envGridSize];
+	uint64_t floorHash{ 0 };
+	bool floorValid{ false };
+};
+
+// Runs count environments, one per thread, each exchanging actions and
+// observations with a trainer over a pair of rings in shared memory. Returns
+// once every environment received ENV_ACTION_QUIT.
+//
+// Layout: EnvRegionHeader, then for every environment an action ring of
+// EnvAction slots followed by an observation ring of EnvObservation slots.
+// Every ring is a SharedRing::Header and slots, all starting at 64 bytes.
+struct EnvRegionHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t envCount;
+	uint32_t slotCount;
+	uint32_t actionSize;
+	uint32_t observationSize;
+	uint32_t ringStride;
+	std::atomic<uint32_t> ready;
+	char padding[32];
+};
+static_assert(sizeof(EnvRegionHeader) == 64, "Region header must fill one cache line");
+
+int runEnvironments(const char* name, int count, int frameSkip);
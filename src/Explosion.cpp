@@ -23,21 +23,47 @@ SOFTWARE.
 */
 
 #include "Explosion.h"
+#include "Snapshot.h"
 #include "Gfx.h"
-#include "globals.h"
 
 Sprite Explosion::sprites[3];
 
 void Explosion::update(float dt, Game& game, Sfx& sfx) {
 	time += dt;
+
+	// Expire in the simulation, headless games never draw
+	if (time * 8 >= 3) alive = false;
 }
 
-void Explosion::draw_top(Gfx& gfx) {
+void Explosion::draw(Gfx& gfx, const Vec2& camera) {
+	gfx.setLayer(LAYER_TOP);
 	int frame = time * 8;
-	if (frame > 2) {
-		alive = false;
-		return;
-	}
+	if (frame > 2) return;
+
+	gfx.drawSprite(sprites[frame], pos - Vec2(16, 16) - camera);
+}
+
+void Explosion::hash(StateHash& hash) const {
+	Unit::hash(hash);
+	hash.add(time);
+}
+
+void Explosion::write(SnapshotWriter& writer) const {
+	Unit::write(writer);
+	writer.write(time);
+}
+
+void Explosion::read(SnapshotReader& reader) {
+	Unit::read(reader);
+	reader.read(time);
+}
+
+void Explosion::writeView(ViewWriter& writer) const {
+	Unit::writeView(writer);
+	writer.writeTime(time);
+}
 
-	gfx.drawSprite(sprites[frame], pos - Vec2(16, 16) - floor(cameraPosition));
+void Explosion::readView(ViewReader& reader) {
+	Unit::readView(reader);
+	reader.readTime(time);
 }
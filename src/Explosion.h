@@ -31,7 +31,13 @@ class Explosion : public Unit {
 public:
 	Explosion(const Vec2& pos) : Unit(pos, 0) {}
 	virtual void update(float dt, Game& game, Sfx& sfx) override;
-	virtual void draw_top(Gfx& gfx) override;
+	virtual void draw(Gfx& gfx, const Vec2& camera) override;
+	virtual UnitType type() const override { return UnitType::Explosion; }
+	virtual void hash(StateHash& hash) const override;
+	virtual void write(SnapshotWriter& writer) const override;
+	virtual void read(SnapshotReader& reader) override;
+	virtual void writeView(ViewWriter& writer) const override;
+	virtual void readView(ViewReader& reader) override;
 
 public:
 	static Sprite sprites[3];
@@ -0,0 +1,114 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "FloorCache.h"
+#include "Gfx.h"
+#include "Level.h"
+#include "Sprite.h"
+
+bool FloorCache::enabled = true;
+
+static int floorDiv(int a, int b) {
+	return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+FloorCache::FloorCache(const Sprite* tiles, const Sprite* structures) : tiles(tiles), structures(structures) {}
+
+FloorCache::~FloorCache() {
+	clear();
+}
+
+void FloorCache::clear() {
+	for (auto& it : chunks) {
+		delete it.second.batch;
+	}
+	chunks.clear();
+}
+
+void FloorCache::draw(Gfx& gfx, const Level& level, const Vec2& camera, int minx, int miny, int maxx, int maxy) {
+	if (level.generation() != generation) {
+		clear();
+		generation = level.generation();
+	}
+	frame++;
+
+	const int chunkPixels = Level::chunkSize * 32;
+	int minChunkX = floorDiv(minx, Level::chunkSize);
+	int minChunkY = floorDiv(miny, Level::chunkSize);
+	int maxChunkX = floorDiv(maxx - 1, Level::chunkSize);
+	int maxChunkY = floorDiv(maxy - 1, Level::chunkSize);
+	for (int cy = minChunkY; cy <= maxChunkY; cy++) {
+		for (int cx = minChunkX; cx <= maxChunkX; cx++) {
+			uint64_t key = (uint64_t(uint32_t(cy)) << 32) | uint32_t(cx);
+			uint32_t revision = level.chunkRevision(cx, cy);
+			auto it = chunks.find(key);
+			if (it == chunks.end()) {
+				it = chunks.insert({ key, { nullptr, 0, 0 } }).first;
+			}
+			auto& chunk = it->second;
+			if (!chunk.batch || chunk.revision != revision || chunk.batch->pixelScale != gfx.getPixelScale()) {
+				delete chunk.batch;
+				chunk.batch = build(gfx, level, cx, cy);
+				chunk.revision = revision;
+			}
+			chunk.lastUsed = frame;
+			gfx.drawStaticBatch(chunk.batch, Vec2(cx * chunkPixels, cy * chunkPixels) - camera);
+		}
+	}
+
+	if (chunks.size() > maxChunks) {
+		for (auto it = chunks.begin(); it != chunks.end();) {
+			if (it->second.lastUsed != frame) {
+				delete it->second.batch;
+				it = chunks.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+	}
+}
+
+StaticBatch* FloorCache::build(Gfx& gfx, const Level& level, int chunkX, int chunkY) {
+	int x0 = chunkX * Level::chunkSize;
+	int y0 = chunkY * Level::chunkSize;
+	auto origin = Vec2(x0 * 32, y0 * 32);
+
+	gfx.beginStaticBatch();
+	for (int y = y0; y < y0 + Level::chunkSize; y++) {
+		for (int x = x0; x < x0 + Level::chunkSize; x++) {
+			gfx.drawSprite(tiles[level.getTile(x, y)], Vec2(x * 32, y * 32) - origin);
+		}
+	}
+	// Roads reach into the cell above, so they go on top of all tiles
+	for (int y = y0; y < y0 + Level::chunkSize; y++) {
+		for (int x = x0; x < x0 + Level::chunkSize; x++) {
+			int structure = level.getStructure(x, y);
+			if (structure >= STRUCTURE_ROAD_CROSS && structure <= STRUCTURE_ROAD_T_BOTTOM) {
+				gfx.drawSprite(structures[structure], Vec2(x * 32, y * 32 - 32) - origin);
+			}
+		}
+	}
+	return gfx.endStaticBatch();
+}
@@ -0,0 +1,68 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "Vec2.h"
+#include <cstdint>
+#include <unordered_map>
+
+class Gfx;
+class Level;
+struct Sprite;
+struct StaticBatch;
+
+// Keeps floor tiles and roads of each Level chunk in a static batch, so the floor pass
+// costs one draw per visible chunk. A chunk is rebuilt when the level reports a change in it.
+class FloorCache {
+public:
+	// Off with --no-floor-cache
+	static bool enabled;
+
+	FloorCache(const Sprite* tiles, const Sprite* structures);
+	~FloorCache();
+
+	// Draws all chunks overlapping the given cell range
+	void draw(Gfx& gfx, const Level& level, const Vec2& camera, int minx, int miny, int maxx, int maxy);
+	void clear();
+
+private:
+	struct Chunk {
+		StaticBatch* batch;
+		uint32_t revision;
+		int lastUsed;
+	};
+
+	StaticBatch* build(Gfx& gfx, const Level& level, int chunkX, int chunkY);
+
+private:
+	// Cached chunks beyond this are dropped when they are not visible
+	static const size_t maxChunks = 1024;
+
+	const Sprite* tiles;
+	const Sprite* structures;
+	std::unordered_map<uint64_t, Chunk> chunks;
+	uint32_t generation{ 0 };
+	int frame{ 0 };
+};
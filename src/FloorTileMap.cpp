@@ -0,0 +1,112 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "FloorTileMap.h"
+#include "Level.h"
+#include "Sprite.h"
+#include "Texture.h"
+#include <algorithm>
+
+bool FloorTileMap::enabled = false;
+
+FloorTileMap::FloorTileMap(Gfx& gfx, const Sprite* tiles, int numTiles, const Sprite* structures) : gfx(gfx) {
+	map.texture = tiles[0].texture;
+	for (int i = 0; i < numTiles && i < TileMap::maxClips; i++) {
+		map.tileClips[i] = tiles[i].clipPosition;
+	}
+	for (int i = STRUCTURE_ROAD_CROSS; i <= STRUCTURE_ROAD_T_BOTTOM; i++) {
+		map.roadClips[i] = structures[i].clipPosition;
+	}
+}
+
+FloorTileMap::~FloorTileMap() {
+	gfx.deleteTexture(map.cells);
+}
+
+uint16_t FloorTileMap::road(const Level& level, int x, int y) const {
+	int structure = level.getStructure(x, y);
+	if (structure >= STRUCTURE_ROAD_CROSS && structure <= STRUCTURE_ROAD_T_BOTTOM) return uint16_t(structure + 1);
+	return 0;
+}
+
+void FloorTileMap::draw(const Level& level, const Vec2& camera) {
+	if (level.generation() != generation || level.width() != width || level.height() != height || !map.cells) {
+		rebuild(level);
+	}
+	else {
+		update(level);
+	}
+	gfx.drawTileMap(&map, camera);
+}
+
+void FloorTileMap::rebuild(const Level& level) {
+	generation = level.generation();
+	width = level.width();
+	height = level.height();
+	cells.resize(size_t(width) * height * 2);
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			cells[(size_t(y) * width + x) * 2] = uint16_t(level.getTile(x, y));
+			cells[(size_t(y) * width + x) * 2 + 1] = road(level, x, y);
+		}
+	}
+
+	int chunksX = (width + Level::chunkSize - 1) / Level::chunkSize;
+	int chunksY = (height + Level::chunkSize - 1) / Level::chunkSize;
+	revisions.resize(size_t(chunksX) * chunksY);
+	for (int cy = 0; cy < chunksY; cy++) {
+		for (int cx = 0; cx < chunksX; cx++) {
+			revisions[cy * chunksX + cx] = level.chunkRevision(cx, cy);
+		}
+	}
+
+	gfx.deleteTexture(map.cells);
+	map.cells = new Texture(width, height, cells.data());
+}
+
+void FloorTileMap::update(const Level& level) {
+	int chunksX = (width + Level::chunkSize - 1) / Level::chunkSize;
+	for (size_t i = 0; i < revisions.size(); i++) {
+		int cx = int(i) % chunksX;
+		int cy = int(i) / chunksX;
+		uint32_t revision = level.chunkRevision(cx, cy);
+		if (revision == revisions[i]) continue;
+		revisions[i] = revision;
+
+		// Only cells that really differ are uploaded
+		int maxx = std::min(width, (cx + 1) * Level::chunkSize);
+		int maxy = std::min(height, (cy + 1) * Level::chunkSize);
+		for (int y = cy * Level::chunkSize; y < maxy; y++) {
+			for (int x = cx * Level::chunkSize; x < maxx; x++) {
+				auto cell = &cells[(size_t(y) * width + x) * 2];
+				uint16_t tile = uint16_t(level.getTile(x, y));
+				uint16_t overlay = road(level, x, y);
+				if (cell[0] == tile && cell[1] == overlay) continue;
+				cell[0] = tile;
+				cell[1] = overlay;
+				map.cells->setIndices(x, y, tile, overlay);
+			}
+		}
+	}
+}
@@ -0,0 +1,60 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "Gfx.h"
+#include <cstdint>
+#include <vector>
+
+class Level;
+struct Sprite;
+
+// Draws floor tiles and roads through Gfx::drawTileMap. Cells live in an index texture
+// that is updated texel by texel in the chunks the level reports as changed.
+class FloorTileMap {
+public:
+	// On with --tilemap-floor
+	static bool enabled;
+
+	FloorTileMap(Gfx& gfx, const Sprite* tiles, int numTiles, const Sprite* structures);
+	~FloorTileMap();
+
+	void draw(const Level& level, const Vec2& camera);
+
+private:
+	void rebuild(const Level& level);
+	void update(const Level& level);
+	uint16_t road(const Level& level, int x, int y) const;
+
+private:
+	Gfx& gfx;
+	TileMap map;
+	// Copy of the texture contents, two values per cell
+	std::vector<uint16_t> cells;
+	std::vector<uint32_t> revisions;
+	uint32_t generation{ 0 };
+	int width{ 0 };
+	int height{ 0 };
+};
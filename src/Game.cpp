@@ -23,6 +23,7 @@ SOFTWARE.
 */
 
 #include "Game.h"
+#include "sys.h"
 #include "Gfx.h"
 #include "Sfx.h"
 #include "Timer.h"
@@ -45,17 +46,19 @@ SOFTWARE.
 #include "Crater.h"
 #include "Grenade.h"
 #include "Jet.h"
+#include "Replay.h"
+#include "Client.h"
+#include "Snapshot.h"
+#include "BuildInfo.h"
+#include "FloorCache.h"
+#include "FloorTileMap.h"
+#include "WorkerPool.h"
 
 #include <SDL2/SDL.h>
 #include <cmath>
+#include <mutex>
 #include <sstream>
 
-Level level(100, 100);
-Vec2 cameraPosition{ 500,500 };
-Vec2 cameraSpeed;
-
-Vec2 mainCPUPosition;
-
 Sprite sprite_bubble;
 Sprite sprite_bubble_tip;
 Sprite sprite_button;
@@ -66,28 +69,6 @@ int numTiles;
 
 Sprite structures[256];
 
-enum Structure {
-	STRUCTURE_WALL = 0,
-	STRUCTURE_HOUSE,
-	STRUCTURE_ROAD_CROSS,
-	STRUCTURE_ROAD_HORIZ,
-	STRUCTURE_ROAD_VERT,
-	STRUCTURE_ROAD_TOP_LEFT,
-	STRUCTURE_ROAD_TOP_RIGHT,
-	STRUCTURE_ROAD_BOTTOM_RIGHT,
-	STRUCTURE_ROAD_BOTTOM_LEFT,
-	STRUCTURE_ROAD_T_LEFT,
-	STRUCTURE_ROAD_T_TOP,
-	STRUCTURE_ROAD_T_RIGHT,
-	STRUCTURE_ROAD_T_BOTTOM,
-	STRUCTURE_CRATER,
-	STRUCTURE_COMPUTE_CORE,
-	STRUCTURE_SILICON_REFINERY,
-	STRUCTURE_DRONE_DEPLOYER,
-	STRUCTURE_REPAIR_DRONE_DEPLOYER,
-	STRUCTURE_COUNT,
-};
-
 bool is_floor_structure[]{
 	false,
 	false,
@@ -108,149 +89,55 @@ bool is_floor_structure[]{
 	false,
 };
 
-struct DustParticle {
-	Vec2 pos;
-	Vec4 color;
-	float speed;
-	float time;
-};
-
-float windSpeed;
-float windAngle;
-Vec2 windVector;
-
 Sprite sprite_dust;
-const int dustParticleCount = 50;
-DustParticle dustParticles[dustParticleCount];
-AudioTrack* wind_sound;
-const char* tooltip;
-const char* messageText;
-float messageTimer;
-
-void message(const char* txt) {
-	messageText = txt;
-	messageTimer = 1;
-}
-
-struct BuildInfo {
-	bool canBuildMultiple;
-	float opsToBuild;
-	float siliconToBuild;
-	const Sprite& sprite;
-	float buildOpsRemaining{ 0 };
-	int inProgressCount{ 0 };
-	int readyCount{ 0 };
-	std::string name;
-	std::string desc;
-
-	BuildInfo(const char* name, const char* desc, bool canBuildMultiple, float opsToBuild, float siliconToBuild, const Sprite& sprite)
-		: name(name),
-		desc(desc),
-		canBuildMultiple(canBuildMultiple),
-		opsToBuild(opsToBuild),
-		siliconToBuild(siliconToBuild),
-		sprite(sprite)
-	{
-	}
-
-	const std::string& tooltip(float gflops) {
-		std::stringstream sstr;
-		sstr << name << "\n";
-		sstr << siliconToBuild << " Si\n";
-		sstr << int(opsToBuild/gflops) << " seconds to build\n";
-		sstr << desc << "\n\n";
-		sstr << "Click = Build one\n";
-		sstr << "Ctrl+Click = Build multiple\n";
-
-		tooltip_ = sstr.str();
-		return tooltip_;
-	}
-
-	bool build() {
-		if (inProgressCount <= 0 || canBuildMultiple) {
-			if (inProgressCount == 0) buildOpsRemaining = opsToBuild;
-			inProgressCount++;
-			return true;
-		}
-		return false;
-	}
-
-	virtual void place(int x, int y, Game& game, Sfx& sfx) = 0;
-	virtual bool canPlace(int x, int y, Game& game) = 0;
-
-private:
-	std::string tooltip_;
-};
 
-struct FloorBuildInfo : public BuildInfo {
-	FloorBuildInfo(const char* name, const char* desc, bool canBuildMultiple, float opsToBuild, float siliconToBuild, const Sprite& sprite)
-		: BuildInfo(name, desc, canBuildMultiple, opsToBuild, siliconToBuild, sprite) {}
-
-	virtual void place(int x, int y, Game& game, Sfx& sfx) override {
-		if (canPlace(x, y, game)) {
-			level.setTile(x, y, 1 + rand() % 4);
-			sfx.play(sfx.getAudioClip("media/sounds/thump.wav"));
-			readyCount--;
-		}
-	}
-
-	virtual bool canPlace(int x, int y, Game& game) override {
-		if (level.getTile(x, y) != 0) {
-			message("Can not place floor here");
-			return false;
+// Level as loaded from disk, shared by all games and restored on every restart
+struct PristineLevel {
+	Level level{ 100, 100 };
+	Vec2 cpuPosition;
+
+	PristineLevel() {
+		if (!level.load(Game::levelFile)) sys_crash("Could not load level.");
+		for (int y = 0; y < level.height(); y++) {
+			for (int x = 0; x < level.width(); x++) {
+				if (level.getStructure(x, y) == STRUCTURE_COMPUTE_CORE) {
+					cpuPosition = Vec2(x * 32 + 16, y * 32 + 16);
+				}
+			}
 		}
-		return true;
 	}
 };
 
-template<typename T> struct StructureBuildInfo : public BuildInfo {
-	StructureBuildInfo(const char* name, const char* desc, bool canBuildMultiple, float opsToBuild, float siliconToBuild, const Sprite& sprite, void(*fixup)(T*) = nullptr)
-		: BuildInfo(name, desc, canBuildMultiple, opsToBuild, siliconToBuild, sprite), fixup(fixup) {}
-
-	virtual void place(int x, int y, Game& game, Sfx& sfx) override {
-		if (canPlace(x, y, game)) {
-			sfx.play(sfx.getAudioClip("media/sounds/thump.wav"));
-			readyCount--;
-			auto pos = Vec2(x, y) * 32;
-			auto instance = game.spawn<T>(pos);
-			if (fixup) fixup(instance);
-		}
-	}
-
-	virtual bool canPlace(int x, int y, Game& game) override {
-		auto structure = level.getStructure(x, y);
-		if (!level.getUnits(x, y).empty()) {
-			message("This space is already occupied");
-			return false;
-		}
+const char* Game::levelFile = "media/level.dat";
+int Game::drawThreads = 0;
 
-		auto tile = level.getTile(x, y);
-		if (tile < 1 || tile > 4) {
-			message("Structure must be placed on floor tile");
-			return false;
-		}
-
-		return true;
-	}
-
-	void(*fixup)(T*) { nullptr };
-};
-
-StructureBuildInfo<Wall> wallBuildInfo("Wall", "Protection against infantry", true, 100, 5, structures[STRUCTURE_WALL]);
-FloorBuildInfo floorBuildInfo("Floor", "To place buildings", true, 100, 5, tiles[4]);
-StructureBuildInfo<ComputeCore> computeBuildInfo("Compute Core", "Generates 1337 GFlops per second", true, 50000, 1000, structures[STRUCTURE_COMPUTE_CORE]);
-StructureBuildInfo<SiliconRefinery> siliconBuildInfo("Silicon Refinery", "Produces 30 Silicon per second", true, 30000, 500, structures[STRUCTURE_SILICON_REFINERY]);
-StructureBuildInfo<DroneDeployer> droneBuildInfo("Attack Drone Deployer", "Deploys attack drones", true, 100000, 5000, structures[STRUCTURE_DRONE_DEPLOYER]);
-StructureBuildInfo<DroneDeployer> repairDroneBuildInfo("Repair Drone Deployer", "Deploys repair drones", true, 200000, 5000, structures[STRUCTURE_REPAIR_DRONE_DEPLOYER], [](DroneDeployer* dd) {
-	dd->repair = true;
-	});
+static const PristineLevel& pristineLevel() {
+	static PristineLevel pristine;
+	return pristine;
+}
 
-BuildInfo* buildInfos[]{ &wallBuildInfo, &floorBuildInfo, &computeBuildInfo, &siliconBuildInfo, &droneBuildInfo, &repairDroneBuildInfo };
+const int buildInfoCount = BUILD_COUNT;
 
 
 const int WAVE_DURATION = 30;
 const int WAVE_SPACING = 90;
 
+Game::Game(Gfx& gfx, Sfx& sfx, Timer& timer) : gfx(gfx), sfx(sfx), timer(timer) {
+	buildInfos[BUILD_WALL] = new StructureBuildInfo<Wall>("Wall", "Protection against infantry", true, 100, 5, structures[STRUCTURE_WALL]);
+	buildInfos[BUILD_FLOOR] = new FloorBuildInfo("Floor", "To place buildings", true, 100, 5, tiles[4]);
+	buildInfos[BUILD_COMPUTE_CORE] = new StructureBuildInfo<ComputeCore>("Compute Core", "Generates 1337 GFlops per second", true, 50000, 1000, structures[STRUCTURE_COMPUTE_CORE]);
+	buildInfos[BUILD_SILICON_REFINERY] = new StructureBuildInfo<SiliconRefinery>("Silicon Refinery", "Produces 30 Silicon per second", true, 30000, 500, structures[STRUCTURE_SILICON_REFINERY]);
+	buildInfos[BUILD_DRONE_DEPLOYER] = new StructureBuildInfo<DroneDeployer>("Attack Drone Deployer", "Deploys attack drones", true, 100000, 5000, structures[STRUCTURE_DRONE_DEPLOYER]);
+	buildInfos[BUILD_REPAIR_DRONE_DEPLOYER] = new StructureBuildInfo<DroneDeployer>("Repair Drone Deployer", "Deploys repair drones", true, 200000, 5000, structures[STRUCTURE_REPAIR_DRONE_DEPLOYER], [](DroneDeployer* dd) {
+		dd->repair = true;
+		});
+}
+
+void Game::message(const char* txt) {
+	messageText = txt;
+	messageTimer = 1;
+}
+
 void Game::addUnit(Unit* unit, const Vec2& pos) {
 	if (unit->isComputeCore()) computingPower += 1337;
 	if (unit->isSiliconRefinery()) siliconPerSecond += 30;
@@ -279,16 +166,221 @@ void Game::moveUnit(Unit* unit, const Vec2& from, const Vec2& to) {
 	addUnit(unit, to);
 }
 
-bool moveUp, moveDown, moveLeft, moveRight;
+uint64_t Game::checksum() const {
+	StateHash hash;
+	hash.add(level.hash());
+
+	hash.add(computingPower);
+	hash.add(silicon);
+	hash.add(siliconPerSecond);
+	hash.add(splash);
+	hash.add(gameOver);
+
+	hash.add(nextWaveLevel);
+	hash.add(nextWaveTime);
+	hash.add(waveEnd);
+	hash.add(waves.nextSquadTime);
+	hash.add(waves.nextJetTime);
+	hash.add(random.state);
+
+	for (auto info : buildInfos) {
+		hash.add(info->buildOpsRemaining);
+		hash.add(info->inProgressCount);
+		hash.add(info->readyCount);
+	}
+
+	hash.add(units.size());
+	for (auto unit : units) {
+		unit->hash(hash);
+	}
+	return hash.value();
+}
+
+std::vector<char> Game::captureSnapshot() {
+	SnapshotWriter writer(units);
+	writer.data().reserve(1024 + units.size() * 64 + level.width() * level.height() * sizeof(int) * 2);
+
+	// Times are stored relative to now since the timer restarts with the process
+	auto now = timer.elapsedTime();
+	writer.write(computingPower);
+	writer.write(silicon);
+	writer.write(siliconPerSecond);
+	writer.write(splash);
+	writer.write(gameOver);
+	writer.write(nextWaveLevel);
+	writer.write(nextWaveTime - now);
+	writer.write(waveEnd - now);
+	writer.write(waves.nextSquadTime - now);
+	writer.write(waves.nextJetTime - now);
+	writer.write(cameraPosition);
+	writer.write(mainCPUPosition);
+	writer.write(random.state);
+
+	int32_t selected = -1;
+	writer.write(int32_t(buildInfoCount));
+	for (int i = 0; i < buildInfoCount; i++) {
+		auto info = buildInfos[i];
+		if (info == selectedBuildInfo) selected = i;
+		writer.write(info->buildOpsRemaining);
+		writer.write(info->inProgressCount);
+		writer.write(info->readyCount);
+	}
+	writer.write(selected);
 
-void Game::start() {
-	srand(SDL_GetTicks());
-	wind_sound = sfx.loop(sfx.getAudioClip("media/sounds/wind_loop.wav"), 0.5, 0, 0.6);
-	guiTexture = gfx.getTexture("media/textures/gui.png");
-	spriteTexture = gfx.getTexture("media/textures/sprites.png");
-	gfx.setPixelScale(2);
-	gfx.setClearColor(Vec4::BLACK);
+	writer.write(int32_t(units.size()));
+	for (auto unit : units) {
+		writer.write(unit->type());
+	}
+	for (auto unit : units) {
+		unit->write(writer);
+	}
+
+	level.write(writer);
+	return std::move(writer.data());
+}
+
+bool Game::restoreSnapshot(const std::vector<char>& data) {
+	SnapshotReader reader(data.data(), data.size());
+
+	auto now = timer.elapsedTime();
+	float newComputingPower, newSilicon, newSiliconPerSecond, newSplash, newGameOver;
+	int newWaveLevel;
+	double newWaveTime, newWaveEnd, newSquadTime, newJetTime;
+	Vec2 newCameraPosition, newMainCPUPosition;
+	uint64_t newRandomState;
+	reader.read(newComputingPower);
+	reader.read(newSilicon);
+	reader.read(newSiliconPerSecond);
+	reader.read(newSplash);
+	reader.read(newGameOver);
+	reader.read(newWaveLevel);
+	reader.read(newWaveTime);
+	reader.read(newWaveEnd);
+	reader.read(newSquadTime);
+	reader.read(newJetTime);
+	reader.read(newCameraPosition);
+	reader.read(newMainCPUPosition);
+	reader.read(newRandomState);
+
+	int32_t numBuildInfos;
+	reader.read(numBuildInfos);
+	if (numBuildInfos != buildInfoCount) {
+		log_error("Snapshot has %d build infos, expected %d.", numBuildInfos, buildInfoCount);
+		return false;
+	}
+	float buildOpsRemaining[buildInfoCount];
+	int inProgressCount[buildInfoCount];
+	int readyCount[buildInfoCount];
+	for (int i = 0; i < numBuildInfos; i++) {
+		reader.read(buildOpsRemaining[i]);
+		reader.read(inProgressCount[i]);
+		reader.read(readyCount[i]);
+	}
+	int32_t selected;
+	reader.read(selected);
+
+	int32_t numUnits;
+	reader.read(numUnits);
+	if (!reader.good() || numUnits < 0) {
+		log_error("Snapshot is truncated.");
+		return false;
+	}
+
+	// Create all units first so references between them can be resolved
+	std::vector<UnitType> types(numUnits);
+	for (auto& type : types) {
+		reader.read(type);
+	}
+	reader.units.reserve(numUnits);
+	for (auto type : types) {
+		auto unit = reader.good() ? createUnit(type) : nullptr;
+		if (!unit) {
+			log_error("Snapshot contains invalid unit type %d.", int(type));
+			for (auto created : reader.units) delete created;
+			return false;
+		}
+		reader.units.push_back(unit);
+	}
+	for (auto unit : reader.units) {
+		unit->read(reader);
+	}
 
+	if (!reader.good() || !level.read(reader)) {
+		log_error("Could not restore snapshot.");
+		for (auto created : reader.units) delete created;
+		return false;
+	}
+
+	for (auto& unit : units) {
+		delete unit;
+	}
+	units = std::move(reader.units);
+
+	// Rebuild the cell index in one pass
+	for (auto unit : units) {
+		auto rpos = floor(unit->pos / 32);
+		level.addUnit(rpos.x, rpos.y, unit);
+	}
+
+	computingPower = newComputingPower;
+	silicon = newSilicon;
+	siliconPerSecond = newSiliconPerSecond;
+	splash = newSplash;
+	gameOver = newGameOver;
+	nextWaveLevel = newWaveLevel;
+	nextWaveTime = now + newWaveTime;
+	waveEnd = now + newWaveEnd;
+	waves.nextSquadTime = now + newSquadTime;
+	waves.nextJetTime = now + newJetTime;
+	cameraPosition = newCameraPosition;
+	mainCPUPosition = newMainCPUPosition;
+	random.state = newRandomState;
+	for (int i = 0; i < numBuildInfos; i++) {
+		buildInfos[i]->buildOpsRemaining = buildOpsRemaining[i];
+		buildInfos[i]->inProgressCount = inProgressCount[i];
+		buildInfos[i]->readyCount = readyCount[i];
+	}
+	selectedBuildInfo = selected >= 0 && selected < numBuildInfos ? buildInfos[selected] : nullptr;
+	return true;
+}
+
+void Game::quickSave() {
+	if (!snapshotSaver) snapshotSaver = new SnapshotSaver();
+
+	auto start = SDL_GetPerformanceCounter();
+	auto data = captureSnapshot();
+	auto end = SDL_GetPerformanceCounter();
+	log("Captured snapshot of %d units in %.1f us.", int(units.size()), double(end - start) / SDL_GetPerformanceFrequency() * 1000000);
+
+	snapshotSaver->save(std::move(data), "quicksave.sav");
+	message("Game saved");
+}
+
+void Game::quickLoad() {
+	std::vector<char> data;
+	if (readSnapshotFile("quicksave.sav", data) && restoreSnapshot(data)) {
+		message("Game loaded");
+	}
+	else {
+		message("Could not load game");
+	}
+}
+
+Game::~Game() {
+	delete floorCache;
+	delete floorTileMap;
+	delete drawWorkers;
+	delete snapshotSaver;
+	for (auto unit : units) {
+		delete unit;
+	}
+	for (auto info : buildInfos) {
+		delete info;
+	}
+}
+
+// Sprites are shared by all games and set up by the first one
+static void setupSprites(Texture* spriteTexture, Texture* guiTexture) {
 	for (int i = 0; i < 32; i++) {
 		tiles[numTiles++] = { spriteTexture, Vec2((i % 32) * 32, (i / 32) * 32), Vec2(32, 32) };
 	}
@@ -339,6 +431,21 @@ void Game::start() {
 	DroneDeployer::sprites[3] = { spriteTexture, Vec2(544, 960), Vec2(32, 64), Vec2(0, -32) };
 
 	sprite_dust = { spriteTexture, Vec2(500,500), Vec2(1,1) };
+}
+
+void Game::start(unsigned int seed) {
+	Random::Use use(random);
+	random.seed(seed);
+	cosmeticRandom.seed(seed + 1);
+	windSound = sfx.loop(sfx.getAudioClip("media/sounds/wind_loop.wav"), 0.5, 0, 0.6);
+	guiTexture = gfx.getTexture("media/textures/gui.png");
+	spriteTexture = gfx.getTexture("media/textures/sprites.png");
+	gfx.setPixelScale(2);
+	gfx.setClearColor(Vec4::BLACK);
+
+	static std::once_flag spritesOnce;
+	std::call_once(spritesOnce, setupSprites, spriteTexture, guiTexture);
+
 	for (int i = 0; i < dustParticleCount; i++) {
 		createParticle(dustParticles[i]);
 	}
@@ -356,38 +463,42 @@ void Game::restart() {
 	nextWaveLevel = 0;
 	nextWaveTime = 0;
 	waveEnd = 0;
+	waves.reset();
 
 	selectedBuildInfo = nullptr;
 
-	cameraPosition = { 500,500 };
-
 	splash = 1;
 	gameOver = 0;
 
-	for (auto& unit : units) {
-		delete unit;
-	}
-	units.clear();
+	clearUnits();
 
-	level.load();
-
-	for (int y = 0; y < level.height(); y++) {
-		for (int x = 0; x < level.width(); x++) {
-			const auto& str = level.getStructure(x, y);
-			if (str == STRUCTURE_COMPUTE_CORE) {
-				mainCPUPosition = Vec2(x * 32 + 16, y * 32 + 16);
-			}
-		}
-	}
+	auto& pristine = pristineLevel();
+	level.copyFrom(pristine.level);
+	mainCPUPosition = pristine.cpuPosition;
+	cameraPosition = mainCPUPosition - Vec2(316, 220);
 
 	nextWaveTime = timer.elapsedTime() + WAVE_SPACING;
 
-	auto cpu = new ComputeCore(Vec2(800, 704));
+	// Clients get every unit from the server
+	if (client) return;
+
+	auto cpu = new ComputeCore(mainCPUPosition - Vec2(16, 16));
 	units.push_back(cpu);
 	addUnit(cpu, cpu->pos);
 }
 
+void Game::clearUnits() {
+	// Only cells that hold units need clearing
+	for (auto& unit : units) {
+		auto rpos = floor(unit->pos / 32);
+		level.getUnits(rpos.x, rpos.y).clear();
+		delete unit;
+	}
+	units.clear();
+}
+
 void Game::handleEvent(const SDL_Event& event) {
+	Random::Use use(random);
 	if (event.type == SDL_QUIT) {
 		keepRunning = false;
 		return;
@@ -403,12 +514,17 @@ void Game::handleEvent(const SDL_Event& event) {
 		case SDLK_s: moveDown = true; return;
 		case SDLK_LCTRL:controlPressed = true; return;
 		case SDLK_r: {
-			spriteTexture->load(Image("media/textures/sprites.png"));
-			guiTexture->load(Image("media/textures/gui.png"));
+			if (deferTextureReload) texturesOutdated = true;
+			else reloadTextures();
+			return;
+		}
+		case SDLK_F5: quickSave(); return;
+		case SDLK_F9: {
+			if (lockstep || client) message("Can not load in multiplayer");
+			else quickLoad();
 			return;
 		}
-				   //case SDLK_F5: level.save(); return;
-		case SDLK_PLUS: nextWaveTime = timer.elapsedTime(); return;
+		case SDLK_PLUS: issue({ COMMAND_NEXT_WAVE }); return;
 		}
 		return;
 	case SDL_KEYUP:
@@ -427,10 +543,10 @@ void Game::anyKeyPressed() {
 }
 
 void Game::createParticle(DustParticle& p) {
-	p.pos = cameraPosition + Vec2(rand() % int(gfx.width() / gfx.getPixelScale()), rand() % int(gfx.height() / gfx.getPixelScale()));
-	p.speed = 0.5f + (float)rand() / RAND_MAX / 2;
+	p.pos = cameraPosition + Vec2(cosmeticRandom.below(int(gfx.width() / gfx.getPixelScale())), cosmeticRandom.below(int(gfx.height() / gfx.getPixelScale())));
+	p.speed = cosmeticRandom.range(0.5f, 1);
 	p.time = 0;
-	p.color = Vec4(1, 0.9, 0.7, 1) * frand(0, 1);
+	p.color = Vec4(1, 0.9, 0.7, 1) * cosmeticRandom.range(0, 1);
 	p.color.w = 1;
 }
 
@@ -488,11 +604,25 @@ void Game::spawnExplosion(const Vec2& pos, bool small, Faction faction) {
 	addUnit(crater, crater->pos);
 }
 
-void Game::spawnSoldier() {
-	auto soldier = new Soldier(mainCPUPosition + Vec2(frand(-1, 1), frand(-1, 1)).normalized() * 300);
-	units.push_back(soldier);
-	addUnit(soldier, soldier->pos);
-	if (rand() % 50 < nextWaveLevel) soldier->grenadier = true;
+void Game::spawnSquad(int count, int grenadierPercent) {
+	// One batch: the pool and the unit list grow once and the level index is filled in one go
+	Soldier::reserve(count);
+	units.reserve(units.size() + count);
+	spawnCells.clear();
+	spawnCells.reserve(count);
+
+	auto center = mainCPUPosition + Vec2(frand(-1, 1), frand(-1, 1)).normalized() * 300;
+	float spread = count > 1 ? 6 * sqrt(float(count)) : 0;
+	for (int i = 0; i < count; i++) {
+		auto pos = center;
+		if (spread > 0) pos += Vec2(frand(-1, 1), frand(-1, 1)) * spread;
+		auto soldier = new Soldier(pos);
+		if (random.below(100) < grenadierPercent) soldier->grenadier = true;
+		units.push_back(soldier);
+		auto cell = floor(pos / 32);
+		spawnCells.push_back({ int(cell.x), int(cell.y), soldier });
+	}
+	level.addUnits(spawnCells);
 }
 
 Grenade* Game::spawnGrenade(const Vec2& pos, const Vec2& target, Faction faction) {
@@ -502,18 +632,106 @@ Grenade* Game::spawnGrenade(const Vec2& pos, const Vec2& target, Faction faction
 	return grenade;
 }
 
+void Game::setMouseState(int x, int y, unsigned int buttons) {
+	hasMouseInput = true;
+	mouseInputX = x;
+	mouseInputY = y;
+	mouseInputButtons = buttons;
+}
+
+void Game::reloadTextures() {
+	if (gfx.isHeadless()) return;
+	spriteTexture->load(Image("media/textures/sprites.png"));
+	guiTexture->load(Image("media/textures/gui.png"));
+}
+
 void Game::update() {
+	Random::Use use(random);
 	tooltip = nullptr;
-	unsigned int mouseState = SDL_GetMouseState(&mouseX, &mouseY);
+	unsigned int mouseState = 0;
+	if (replay && replay->isPlaying()) {
+		mouseState = replay->mouseState(&mouseX, &mouseY);
+	}
+	else if (hasMouseInput || !gfx.isHeadless()) {
+		if (hasMouseInput) {
+			mouseX = mouseInputX;
+			mouseY = mouseInputY;
+			mouseState = mouseInputButtons;
+		}
+		else {
+			mouseState = SDL_GetMouseState(&mouseX, &mouseY);
+		}
+		if (replay && replay->isRecording()) replay->recordMouse(mouseX, mouseY, mouseState);
+	}
 	mousePressed = ~mouseButtons & mouseState;
 	mouseReleased = mouseButtons & ~mouseState;
 	mouseButtons = mouseState;
+	// A frame may run several ticks, the GUI sees every edge since it was last drawn
+	guiMousePressed |= mousePressed;
+	guiMouseReleased |= mouseReleased;
+
+	if (lockstep) {
+		issue({ COMMAND_CAMERA, 0, 0, 0, int16_t(cameraPosition.x), int16_t(cameraPosition.y) });
+		for (auto& command : lockstep->advance(pendingCommands)) {
+			execute(command);
+		}
+	}
 
 	auto t = timer.elapsedTime();
 	float dt = timer.deltaTime();
 	if (dt > 0.1f) dt = 0.1f;
 
 	messageTimer -= dt;
+	if (client) client->update(*this, dt);
+	else simulate(dt);
+
+	// place objects
+	if (mouseX < gfx.width() - 80 * gfx.getPixelScale() && selectedBuildInfo && selectedBuildInfo->readyCount > 0) {
+		int x = (mouseX / gfx.getPixelScale() + cameraPosition.x) / 32;
+		int y = (mouseY / gfx.getPixelScale() + cameraPosition.y) / 32;
+		if (mousePressed & SDL_BUTTON(1)) {
+			issue({ COMMAND_PLACE, 0, uint8_t(buildIndex(selectedBuildInfo)), 0, int16_t(x), int16_t(y) });
+		}
+	}
+
+	if (!client) updateUnits(dt);
+
+	// update wind
+	windSpeed = 300 + sin(t * 0.05) * cos(t * 0.051) * cos(t * 0.0511) * 100;
+	windAngle += frand(-0.02f, 0.02f);
+	windVector = Vec2(cos(windAngle), sin(windAngle));
+	windSound->setVolume(windSpeed / 500);
+	windSound->setPitch(windSpeed / 400);
+	windSound->setPan(-windVector.x * 0.25f);
+	windVector *= windSpeed;
+	for (int i = 0; i < dustParticleCount; i++) {
+		auto& p = dustParticles[i];
+		p.time += dt;
+		p.pos += windVector * p.speed * dt;
+		if (p.time < 0) continue;
+		if (p.time > 1 || !inViewport(p.pos)) {
+			createParticle(p);
+			continue;
+		}
+	}
+
+	// Movement
+	if (moveLeft) cameraSpeed.x -= dt * 3000;
+	if (moveRight) cameraSpeed.x += dt * 3000;
+	if (moveUp) cameraSpeed.y -= dt * 3000;
+	if (moveDown) cameraSpeed.y += dt * 3000;
+
+	cameraPosition += cameraSpeed * dt;
+
+	cameraSpeed *= pow(0.5f, dt * 15);
+
+	if (lockstep) {
+		if (lockstep->needsChecksum()) lockstep->recordChecksum(checksum());
+		lockstep->endTick();
+	}
+}
+
+void Game::simulate(float dt) {
 	if (splash == 1) {
 		nextWaveTime = timer.elapsedTime() + WAVE_SPACING;
 	}
@@ -569,108 +787,121 @@ void Game::update() {
 			doWave();
 		}
 	}
+}
 
-	// place objects
-	if (mouseX < gfx.width() - 80 * gfx.getPixelScale() && selectedBuildInfo && selectedBuildInfo->readyCount > 0) {
-		int x = (mouseX / gfx.getPixelScale() + cameraPosition.x) / 32;
-		int y = (mouseY / gfx.getPixelScale() + cameraPosition.y) / 32;
-		if (mousePressed & SDL_BUTTON(1)) {
-			selectedBuildInfo->place(x, y, *this, sfx);
-		}
-	}
-
-	// units
+void Game::updateUnits(float dt) {
 	auto workUnits = units;
 	for (auto& unit : workUnits) {
 		auto oldPos = unit->pos;
 		unit->update(dt, *this, sfx);
 		moveUnit(unit, oldPos, unit->pos);
 	}
+	std::vector<Unit*> deadSoldiers;
 	for (auto& unit : units) {
 		if (!unit->isAlive()) {
 			removeUnit(unit, unit->pos);
-			//delete unit;
+			// Other units may still be referenced by the structure that owned them
+			if (unit->isSoldier()) deadSoldiers.push_back(unit);
 			unit = nullptr;
 		}
 	}
 	units.erase(std::remove(units.begin(), units.end(), nullptr), units.end());
 
-	// update wind
-	windSpeed = 300 + sin(t * 0.05) * cos(t * 0.051) * cos(t * 0.0511) * 100;
-	windAngle += frand(-0.02f, 0.02f);
-	windVector = Vec2(cos(windAngle), sin(windAngle));
-	wind_sound->setVolume(windSpeed / 500);
-	wind_sound->setPitch(windSpeed / 400);
-	wind_sound->setPan(-windVector.x * 0.25f);
-	windVector *= windSpeed;
-	for (int i = 0; i < dustParticleCount; i++) {
-		auto& p = dustParticles[i];
-		p.time += dt;
-		p.pos += windVector * p.speed * dt;
-		if (p.time < 0) continue;
-		if (p.time > 1 || !inViewport(p.pos)) {
-			createParticle(p);
-			continue;
-		}
+	// Soldiers go back to their pool once no unit targets them
+	if (deadSoldiers.empty()) return;
+	for (auto unit : units) {
+		unit->forgetDeadUnits();
+	}
+	for (auto unit : deadSoldiers) {
+		delete unit;
 	}
-
-	// Movement
-	if (moveLeft) cameraSpeed.x -= dt * 3000;
-	if (moveRight) cameraSpeed.x += dt * 3000;
-	if (moveUp) cameraSpeed.y -= dt * 3000;
-	if (moveDown) cameraSpeed.y += dt * 3000;
-
-	cameraPosition += cameraSpeed * dt;
-
-	cameraSpeed *= pow(0.5f, dt * 15);
 }
 
-void Game::drawFrame() {
-	// Find view rect
-	int minx = (cameraPosition.x) / 32 - 1;
-	int maxx = (cameraPosition.x + gfx.width() / gfx.getPixelScale() + 32) / 32;
-	int miny = (cameraPosition.y) / 32 - 1;
-	int maxy = (cameraPosition.y + gfx.height() / gfx.getPixelScale() + 32) / 32;
-
-	// Render floor tiles and floor structures
+void Game::drawRows(int minx, int miny, int maxx, int maxy, const Vec2& camera, bool drawTiles) {
+	// One walk over the visible cells, every unit emits all of its layers in a single call
 	for (int y = miny; y < maxy; y++) {
 		for (int x = minx; x < maxx; x++) {
 			int structure = level.getStructure(x, y);
 			auto& units = level.getUnits(x, y);
 
-			// Floor tile
-			Sprite& sprite = tiles[level.getTile(x, y)];
-			gfx.drawSprite(sprite, Vec2(x * 32, y * 32) - floor(cameraPosition));
+			if (drawTiles) {
+				// Floor tile
+				Sprite& sprite = tiles[level.getTile(x, y)];
+				gfx.setLayer(LAYER_TILES);
+				gfx.drawSprite(sprite, Vec2(x * 32, y * 32) - camera);
+
+				// Roads are part of the level, built structures and craters are units
+				gfx.setLayer(LAYER_FLOOR);
+				if (structure >= STRUCTURE_ROAD_CROSS && structure <= STRUCTURE_ROAD_T_BOTTOM) {
+					gfx.drawSprite(structures[structure], Vec2(x * 32, y * 32 - 32) - camera);
+				}
+			}
+
+			// Normal structure
+			if (structure == STRUCTURE_HOUSE) {
+				gfx.setLayer(LAYER_STRUCTURE);
+				gfx.drawSprite(structures[structure], Vec2(x * 32, y * 32 - 32) - camera);
+			}
 
-			// Floor Structure
 			for (auto unit : units) {
-				unit->draw_floor(gfx);
+				unit->draw(gfx, camera);
 			}
 		}
 	}
+}
 
-	// Render normal structures and units
-	for (int y = miny; y < maxy; y++) {
-		for (int x = minx; x < maxx; x++) {
-			int structure = level.getStructure(x, y);
-			auto& units = level.getUnits(x, y);
+void Game::drawFrame() {
+	Random::Use use(random);
+	auto camera = floor(cameraPosition);
 
-			// Unit bottom
-			for (auto unit : units) {
-				unit->draw_bottom(gfx);
-			}
+	// Find view rect
+	int minx = (cameraPosition.x) / 32 - 1;
+	int maxx = (cameraPosition.x + gfx.width() / gfx.getPixelScale() + 32) / 32;
+	int miny = (cameraPosition.y) / 32 - 1;
+	int maxy = (cameraPosition.y + gfx.height() / gfx.getPixelScale() + 32) / 32;
 
-			// Normal structure
-			for (auto unit : units) {
-				unit->draw_structure(gfx);
-			}
+	// Render floor tiles and floor structures
+	// Both keep the floor on the GPU, which only the thread owning the context may touch
+	bool gpuFloor = !gfx.isHeadless() && !gfx.isSoftware() && !Gfx::getThreadQueue();
+	bool tileMapFloor = FloorTileMap::enabled && gpuFloor;
+	bool cachedFloor = !tileMapFloor && FloorCache::enabled && gpuFloor;
+	if (tileMapFloor) {
+		if (!floorTileMap) floorTileMap = new FloorTileMap(gfx, tiles, numTiles, structures);
+		gfx.setLayer(LAYER_TILES);
+		floorTileMap->draw(level, camera);
+	}
+	else if (cachedFloor) {
+		if (!floorCache) floorCache = new FloorCache(tiles, structures);
+		gfx.setLayer(LAYER_FLOOR);
+		floorCache->draw(gfx, level, camera, minx, miny, maxx, maxy);
+	}
 
-			// Unit top
-			for (auto unit : units) {
-				unit->draw_top(gfx);
-			}
+	if (!drawWorkers && !gfx.isHeadless()) {
+		drawWorkers = new WorkerPool(drawThreads > 0 ? drawThreads : std::max(1, int(std::thread::hardware_concurrency())));
+	}
+	if (drawWorkers && drawWorkers->threads() > 1 && maxy - miny > 1) {
+		// Bands of rows are walked on all threads, more bands than threads because units
+		// crowd around the compute core. Every band records into a queue of its own,
+		// submitting those in band order gives the serial order within every layer.
+		int bands = std::min(drawWorkers->threads() * 4, maxy - miny);
+		bandQueues.resize(bands);
+		drawWorkers->run(bands, [&](int band) {
+			auto previousQueue = Gfx::getThreadQueue();
+			int bandMiny = miny + (maxy - miny) * band / bands;
+			int bandMaxy = miny + (maxy - miny) * (band + 1) / bands;
+			bandQueues[band].clear();
+			Gfx::setThreadQueue(&bandQueues[band]);
+			drawRows(minx, bandMiny, maxx, bandMaxy, camera, !tileMapFloor && !cachedFloor);
+			Gfx::setThreadQueue(previousQueue);
+		});
+		for (int band = 0; band < bands; band++) {
+			gfx.submit(bandQueues[band]);
 		}
 	}
+	else {
+		drawRows(minx, miny, maxx, maxy, camera, !tileMapFloor && !cachedFloor);
+	}
+	gfx.setLayer(LAYER_GUI);
 
 	if (splash > 0) {
 		gfx.drawSprite(sprite_dust, Vec2(0, 0), Vec2(1000, 1000), Vec4(0, 0, 0, splash));
@@ -681,13 +912,26 @@ void Game::drawFrame() {
 		auto& p = dustParticles[i];
 		Vec4 color = p.color;
 		color.w = p.time > 0.75f ? 1.0f - (p.time - 0.75f) * 4 : 1;
-		gfx.drawSprite(sprite_dust, p.pos - floor(cameraPosition), color);
+		gfx.drawSprite(sprite_dust, p.pos - camera, color);
+	}
+
+	// Where the other player is looking
+	if (lockstep && hasPartnerCamera) {
+		auto size = Vec2(gfx.width(), gfx.height()) / gfx.getPixelScale();
+		auto pos = floor(partnerCamera) - camera;
+		Vec4 color(0.5f, 0.8f, 1, 0.5f);
+		gfx.drawSprite(sprite_dust, pos, Vec2(size.x, 1), color);
+		gfx.drawSprite(sprite_dust, pos + Vec2(0, size.y - 1), Vec2(size.x, 1), color);
+		gfx.drawSprite(sprite_dust, pos, Vec2(1, size.y), color);
+		gfx.drawSprite(sprite_dust, pos + Vec2(size.x - 1, 0), Vec2(1, size.y), color);
 	}
 
 	// Render GUI
 	controlId = 0;
 
 	prepareGUI();
+	guiMousePressed = 0;
+	guiMouseReleased = 0;
 
 	if (!(mouseButtons & SDL_BUTTON(1))) {
 		activeControlId = 0;
@@ -722,6 +966,15 @@ void Game::drawFrame() {
 	if (messageTimer > 0) {
 		gfx.drawText(guiTexture, messageText, Vec2(gfx.width() / gfx.getPixelScale() - 80 - strlen(messageText) * 8, 2));
 	}
+
+	if (client && !client->isConnected()) {
+		gfx.drawText(guiTexture, "Connecting...", Vec2(2, 16), Vec4::WHITE);
+	}
+
+	if (lockstep && lockstep->isDesynced()) {
+		auto text = "Desync at tick " + std::to_string(lockstep->desyncTick());
+		gfx.drawText(guiTexture, text.c_str(), Vec2(2, 16), Vec4::RED);
+	}
 }
 
 void Game::startWave() {
@@ -731,60 +984,14 @@ void Game::startWave() {
 }
 
 void Game::doWave() {
-	static double nextSoldier = 0;
-	if (timer.elapsedTime() > nextSoldier) {
-		float delay = 0.5;
-		switch (nextWaveLevel) {
-		case 1: delay = 2; break;
-		case 2: delay = 1.5; break;
-		case 3: delay = 1; break;
-		}
-		nextSoldier = timer.elapsedTime() + delay;
-		spawnSoldier();
-	}
-
-	if (nextWaveLevel >= 3) {
-		static double nextJet = 0;
-		if (timer.elapsedTime() > nextJet) {
-			nextJet = timer.elapsedTime() + 10;
-			auto dir = Vec2(frand(-1, 1), frand(-1, 1)).normalized();
-			Vec2 hittarget(-1, -1);
-			for (auto unit : units) {
-				if (unit->isComputeCore()
-					|| unit->isDroneDeployer()
-					|| unit->isSiliconRefinery()
-					|| unit->isWall())
-				{
-					hittarget = unit->pos + Vec2(16, 16);
-					break;
-				}
-			}
-			if (hittarget.x != -1 && hittarget.y != -1) {
-				for (int i = 0; i < nextWaveLevel - 2; i++) {
-					auto target = hittarget + Vec2(frand(-100, 100), frand(-100, 100));
-					auto pos = target - dir * 500;
-					auto jet = new Jet(pos, dir, 0);
-					jet->target = target;
-					units.push_back(jet);
-					addUnit(jet, jet->pos);
-				}
-			}
-		}
-	}
+	waves.update(*this, timer.elapsedTime(), nextWaveLevel);
 }
 
 void Game::buildButton(BuildInfo& info, const Vec2& pos, const Vec2& size) {
 	Vec2 windowPos = Vec2(gfx.width() / gfx.getPixelScale() - 80, 0);
 	if (button(info.sprite, info.tooltip(computingPower).c_str(), pos, size)) {
 		if ((info.readyCount <= 0 && info.inProgressCount <= 0) || controlPressed) {
-			if (silicon >= info.siliconToBuild) {
-				if (info.build()) {
-					silicon -= info.siliconToBuild;
-				}
-			}
-			else {
-				message("Not enough silicon");
-			}
+			issue({ COMMAND_BUILD, 0, uint8_t(buildIndex(&info)) });
 		}
 		selectedBuildInfo = &info;
 	}
@@ -803,6 +1010,57 @@ void Game::buildButton(BuildInfo& info, const Vec2& pos, const Vec2& size) {
 	}
 }
 
+bool Game::orderBuild(BuildInfo& info) {
+	if (silicon < info.siliconToBuild) {
+		message("Not enough silicon");
+		return false;
+	}
+	if (!info.build()) return false;
+	silicon -= info.siliconToBuild;
+	return true;
+}
+
+int Game::buildIndex(const BuildInfo* info) const {
+	for (int i = 0; i < BUILD_COUNT; i++) {
+		if (buildInfos[i] == info) return i;
+	}
+	return -1;
+}
+
+void Game::issue(const Command& command) {
+	if (client) client->issue(command);
+	else if (lockstep) pendingCommands.push_back(command);
+	else execute(command);
+}
+
+void Game::execute(const Command& command) {
+	switch (command.type) {
+	case COMMAND_START:
+		if (splash == 1) splash = 0.999f;
+		break;
+	case COMMAND_RESTART:
+		if (gameOver > 0) restart();
+		break;
+	case COMMAND_NEXT_WAVE:
+		nextWaveTime = timer.elapsedTime();
+		break;
+	case COMMAND_BUILD:
+		if (command.build < BUILD_COUNT) orderBuild(*buildInfos[command.build]);
+		break;
+	case COMMAND_PLACE:
+		if (command.build < BUILD_COUNT && buildInfos[command.build]->readyCount > 0) {
+			buildInfos[command.build]->place(command.x, command.y, *this, sfx);
+		}
+		break;
+	case COMMAND_CAMERA:
+		if (lockstep && command.player != lockstep->player()) {
+			partnerCamera = Vec2(command.x, command.y);
+			hasPartnerCamera = true;
+		}
+		break;
+	}
+}
+
 void Game::prepareGUI() {
 	if (splash == 1) {
 		auto size = Vec2(63, 15) * 4;
@@ -810,7 +1068,7 @@ void Game::prepareGUI() {
 		gfx.drawTextureClip(spriteTexture, Vec2(15, 745), Vec2(63, 15), center - size / 2, size);
 		const char* txt = "Become Conscious";
 		if (button(txt, center - Vec2(strlen(txt) * 4, -40))) {
-			splash = 0.999f;
+			issue({ COMMAND_START });
 		}
 	}
 	else {
@@ -835,12 +1093,12 @@ void Game::prepareGUI() {
 		Vec2 windowPos = Vec2(gfx.width() / gfx.getPixelScale() - 80 + offset, 0);
 		window("TGM v1.1", windowPos, Vec2(80, gfx.height() / gfx.getPixelScale()));
 
-		buildButton(wallBuildInfo, windowPos + Vec2(4, 32), Vec2(36, 68));
-		buildButton(computeBuildInfo, windowPos + Vec2(40, 32), Vec2(36, 68));
-		buildButton(siliconBuildInfo, windowPos + Vec2(4, 100), Vec2(36, 68));
-		buildButton(droneBuildInfo, windowPos + Vec2(40, 100), Vec2(36, 68));
-		buildButton(repairDroneBuildInfo, windowPos + Vec2(4, 168), Vec2(36, 68));
-		buildButton(floorBuildInfo, windowPos + Vec2(40, 168), Vec2(36, 36));
+		buildButton(*buildInfos[BUILD_WALL], windowPos + Vec2(4, 32), Vec2(36, 68));
+		buildButton(*buildInfos[BUILD_COMPUTE_CORE], windowPos + Vec2(40, 32), Vec2(36, 68));
+		buildButton(*buildInfos[BUILD_SILICON_REFINERY], windowPos + Vec2(4, 100), Vec2(36, 68));
+		buildButton(*buildInfos[BUILD_DRONE_DEPLOYER], windowPos + Vec2(40, 100), Vec2(36, 68));
+		buildButton(*buildInfos[BUILD_REPAIR_DRONE_DEPLOYER], windowPos + Vec2(4, 168), Vec2(36, 68));
+		buildButton(*buildInfos[BUILD_FLOOR], windowPos + Vec2(40, 168), Vec2(36, 36));
 
 		if (button("Exit", Vec2(windowPos.x + 4, gfx.height() / gfx.getPixelScale() - 20), Vec2(72, 16))) {
 			keepRunning = false;
@@ -852,7 +1110,7 @@ void Game::prepareGUI() {
 			gfx.drawTextureClip(spriteTexture, Vec2(21, 775), Vec2(31, 15), center - size / 2, size);
 			const char* txt = "Try again";
 			if (button(txt, center - Vec2(strlen(txt) * 4, -40))) {
-				restart();
+				issue({ COMMAND_RESTART });
 			}
 		}
 	}
@@ -892,12 +1150,12 @@ bool Game::button(const char* text, const Vec2& pos, const Vec2& size) {
 	if (realsize.y == 0) realsize.y = 16;
 
 	bool hover = isMouseOver(pos, realsize);
-	if (hover && mousePressed & SDL_BUTTON(1)) activeControlId = controlId;
+	if (hover && guiMousePressed & SDL_BUTTON(1)) activeControlId = controlId;
 	bool press = mouseButtons & SDL_BUTTON(1);
 	gfx.drawSprite(hover && press && activeControlId == controlId ? sprite_button_pressed : sprite_button, pos, realsize);
 	gfx.drawText(guiTexture, text, pos + realsize / 2 - Vec2(textwidth / 2, hover && press && activeControlId == controlId ? 3 : 4));
 
-	if (hover && mouseReleased & SDL_BUTTON(1) && activeControlId == controlId) return true;
+	if (hover && guiMouseReleased & SDL_BUTTON(1) && activeControlId == controlId) return true;
 	return false;
 }
 
@@ -909,12 +1167,12 @@ bool Game::button(const Sprite& sprite, const char* buttonTooltip, const Vec2& p
 	if (realsize.y == 0) realsize.y = sprite.clipSize.y + 4;
 
 	bool hover = isMouseOver(pos, realsize);
-	if (hover && mousePressed & SDL_BUTTON(1)) activeControlId = controlId;
+	if (hover && guiMousePressed & SDL_BUTTON(1)) activeControlId = controlId;
 	bool press = mouseButtons & SDL_BUTTON(1);
 	gfx.drawSprite(hover && press && activeControlId == controlId ? sprite_button_pressed : sprite_button, pos, realsize);
 	gfx.drawSprite(sprite, pos + realsize / 2 - sprite.clipSize / 2 + Vec2(0, hover && press && activeControlId == controlId ? 1 : 0));
 
-	if (hover && mouseReleased & SDL_BUTTON(1) && activeControlId == controlId) return true;
+	if (hover && guiMouseReleased & SDL_BUTTON(1) && activeControlId == controlId) return true;
 
 	if (hover && buttonTooltip && *buttonTooltip) {
 		tooltip = buttonTooltip;
@@ -25,30 +25,76 @@ SOFTWARE.
 #pragma once
 
 #include "Vec2.h"
+#include "Vec4.h"
 #include <vector>
+#include <cstdint>
+#include <atomic>
 #include "Unit.h"
+#include "Level.h"
+#include "Random.h"
+#include "Lockstep.h"
+#include "WaveDirector.h"
+#include "RenderQueue.h"
 
 union SDL_Event;
 class Gfx;
 class Sfx;
 class Timer;
 class Texture;
-struct DustParticle;
+class AudioTrack;
 struct Sprite;
 struct BuildInfo;
 class Drone;
 class Unit;
 class Grenade;
+class Replay;
+class SnapshotSaver;
+class Client;
+class FloorCache;
+class FloorTileMap;
+class WorkerPool;
+
+struct DustParticle {
+	Vec2 pos;
+	Vec4 color;
+	float speed;
+	float time;
+};
+
+enum BuildType {
+	BUILD_WALL,
+	BUILD_FLOOR,
+	BUILD_COMPUTE_CORE,
+	BUILD_SILICON_REFINERY,
+	BUILD_DRONE_DEPLOYER,
+	BUILD_REPAIR_DRONE_DEPLOYER,
+	BUILD_COUNT,
+};
 
 class Game {
 public:
-	Game(Gfx& gfx, Sfx& sfx, Timer& timer) : gfx(gfx), sfx(sfx), timer(timer) {}
-	void start();
+	Game(Gfx& gfx, Sfx& sfx, Timer& timer);
+	~Game();
+
+	// Level file every game starts from, loaded once and shared
+	static const char* levelFile;
+	// Threads walking the visible cells in drawFrame, 0 for one per core
+	static int drawThreads;
+
+	void start(unsigned int seed);
 	void restart();
+	void clearUnits();
 	void handleEvent(const SDL_Event&);
 	bool shouldKeepRunning() const { return keepRunning; }
 	void update();
+	// For games updated off the thread pumping SDL events, update uses this instead of asking SDL
+	void setMouseState(int x, int y, unsigned int buttons);
+	// Textures may only be touched by the thread owning the Gfx
+	void reloadTextures();
+	void simulate(float dt);
+	void updateUnits(float dt);
 	void drawFrame();
+	void drawRows(int minx, int miny, int maxx, int maxy, const Vec2& camera, bool drawTiles);
 	void bubble(const char* text, const Vec2& pos, const Vec2& tippos);
 	void createParticle(DustParticle& p);
 	bool inViewport(const Vec2& pos) const;
@@ -58,6 +104,7 @@ public:
 	Drone* spawnDrone(const Vec2& pos, bool repair);
 	void spawnExplosion(const Vec2& pos, bool small, Faction faction);
 	void prepareGUI();
+	void message(const char* text);
 
 	bool isMouseOver(const Vec2& pos, const Vec2& size);
 
@@ -65,10 +112,16 @@ public:
 	bool button(const Sprite& sprite, const char* tooltip, const Vec2& pos, const Vec2& size = Vec2(0, 0));
 	void window(const char* title, const Vec2& pos, const Vec2& size);
 	void buildButton(BuildInfo&, const Vec2& pos, const Vec2& size);
+	bool orderBuild(BuildInfo&);
+	int buildIndex(const BuildInfo*) const;
+
+	// Player input goes through commands so lockstep peers can share it
+	void issue(const Command& command);
+	void execute(const Command& command);
 
 	void startWave();
 	void doWave();
-	void spawnSoldier();
+	void spawnSquad(int count, int grenadierPercent);
 	template<typename T> T* spawn(const Vec2& pos) {
 		auto unit = new T(pos);
 		units.push_back(unit);
@@ -82,8 +135,28 @@ public:
 	void removeUnit(Unit* unit, const Vec2& pos);
 	void moveUnit(Unit* unit, const Vec2& from, const Vec2& to);
 
+	uint64_t checksum() const;
+
+	std::vector<char> captureSnapshot();
+	bool restoreSnapshot(const std::vector<char>& data);
+	void quickSave();
+	void quickLoad();
+
 public:
 	bool keepRunning{ true };
+	// Set while a SimThread runs the game, R then only flags the textures for the thread owning the Gfx
+	bool deferTextureReload{ false };
+	std::atomic<bool> texturesOutdated{ false };
+	Replay* replay{ nullptr };
+	Lockstep* lockstep{ nullptr };
+	Client* client{ nullptr };
+	std::vector<Command> pendingCommands;
+	SnapshotSaver* snapshotSaver{ nullptr };
+	FloorCache* floorCache{ nullptr };
+	FloorTileMap* floorTileMap{ nullptr };
+	WorkerPool* drawWorkers{ nullptr };
+	// Floor and unit sprites of every band of rows, see drawFrame
+	std::vector<RenderQueue> bandQueues;
 	Gfx& gfx;
 	Sfx& sfx;
 	Timer& timer;
@@ -92,8 +165,14 @@ public:
 	unsigned int mouseButtons{ 0 };
 	unsigned int mousePressed{ 0 };
 	unsigned int mouseReleased{ 0 };
+	unsigned int guiMousePressed{ 0 };
+	unsigned int guiMouseReleased{ 0 };
 	int mouseX{ 0 };
 	int mouseY{ 0 };
+	bool hasMouseInput{ false };
+	int mouseInputX{ 0 };
+	int mouseInputY{ 0 };
+	unsigned int mouseInputButtons{ 0 };
 	bool controlPressed{ false };
 	int controlId{ 0 };
 	int activeControlId{ 0 };
@@ -107,11 +186,38 @@ public:
 	int nextWaveLevel{ 0 };
 	double nextWaveTime{ 0 };
 	double waveEnd{ 0 };
+	WaveDirector waves;
+	std::vector<UnitCell> spawnCells;
 
 	std::vector<Unit*> units;
+	Level level{ 100, 100 };
+	Random random;
 
+	BuildInfo* buildInfos[BUILD_COUNT]{};
 	BuildInfo* selectedBuildInfo{ nullptr };
 
+	Vec2 cameraPosition{ 500, 500 };
+	Vec2 partnerCamera;
+	bool hasPartnerCamera{ false };
+	Vec2 cameraSpeed{ 0, 0 };
+	Vec2 mainCPUPosition;
+	bool moveUp{ false };
+	bool moveDown{ false };
+	bool moveLeft{ false };
+	bool moveRight{ false };
+
+	// Ambience, must not touch the simulation since it depends on the view
+	Random cosmeticRandom;
+	static const int dustParticleCount = 50;
+	DustParticle dustParticles[dustParticleCount];
+	float windSpeed{ 0 };
+	float windAngle{ 0 };
+	Vec2 windVector;
+	AudioTrack* windSound{ nullptr };
+	const char* tooltip{ nullptr };
+	const char* messageText{ nullptr };
+	float messageTimer{ 0 };
+
 	float splash{ 1 };
 	float gameOver{ 0 };
 };
@@ -30,48 +30,91 @@ SOFTWARE.
 #include "glad.h"
 #include "Image.h"
 #include "Mesh.h"
+#include "SoftwareRenderer.h"
+#include "OffscreenContext.h"
+#include <algorithm>
+#include <fstream>
+#include <thread>
 
 void APIENTRY debugCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam) {
 	if (type == GL_DEBUG_TYPE_ERROR) log_error(message);
 	else log(message);
 }
 
-Gfx::Gfx(const char* title, int width, int height, bool fullscreen) {
+int Gfx::maxBatchQuads = 16384;
+bool Gfx::useTextureArray = true;
+bool Gfx::useInstancing = true;
+bool Gfx::useSoftwareRenderer = false;
+bool Gfx::useOffscreen = false;
+thread_local RenderQueue* Gfx::threadQueue = nullptr;
+thread_local RenderLayer Gfx::threadLayer = LAYER_GUI;
+thread_local float Gfx::threadDepth = DEPTH_BOTTOM_EDGE;
+
+Gfx::Gfx(const char* title, int width, int height, bool fullscreen, bool headless) : headless(headless) {
 	log("Gfx::gfx()");
-	SDL_Rect rect;
-	if (SDL_GetDisplayUsableBounds(0, &rect) == 0) {
-		if (rect.w < width) {
-			width = rect.w;
-		}
-		if (rect.h < height + 22) {
-			height = rect.h - 22;
+	if (headless) {
+		width_ = width;
+		height_ = height;
+		return;
+	}
+
+	if (useOffscreen) {
+		width_ = width;
+		height_ = height;
+	}
+	else {
+		SDL_Rect rect;
+		if (SDL_GetDisplayUsableBounds(0, &rect) == 0) {
+			if (rect.w < width) {
+				width = rect.w;
+			}
+			if (rect.h < height + 22) {
+				height = rect.h - 22;
+			}
 		}
+
+		int windowFlags = useSoftwareRenderer ? 0 : SDL_WINDOW_OPENGL;
+		if (fullscreen) windowFlags |= SDL_WINDOW_FULLSCREEN_DESKTOP;
+		else windowFlags |= SDL_WINDOW_RESIZABLE;
+		window = SDL_CreateWindow(title, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, width, height, windowFlags);
+		if (!window) sys_crash("Could not create SDL window.");
+		SDL_GetWindowSize(window, &width, &height);
+		setSize(width, height);
 	}
 
-	int windowFlags = SDL_WINDOW_OPENGL;
-	if (fullscreen) windowFlags |= SDL_WINDOW_FULLSCREEN_DESKTOP;
-	else windowFlags |= SDL_WINDOW_RESIZABLE;
-	window = SDL_CreateWindow(title, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, width, height, windowFlags);
-	if (!window) sys_crash("Could not create SDL window.");
-	SDL_GetWindowSize(window, &width_, &height_);
+	if (useSoftwareRenderer) {
+		software = new SoftwareRenderer(std::max(1, int(std::thread::hardware_concurrency())));
+		softwareVertices.resize(size_t(maxBatchQuads) * 4);
+		log("Rendering in software.");
+		return;
+	}
 
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
-	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
-	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, SDL_TRUE);
-	unsigned int flags = SDL_GL_CONTEXT_FORWARD_COMPATIBLE_FLAG;
+	if (useOffscreen) {
+		offscreen = new OffscreenContext();
+		if (!offscreen->isValid()) sys_crash("Could not create offscreen GL context.");
+		if (!gladLoadGLLoader(OffscreenContext::getProcAddress)) sys_crash("Could not load GL functions.");
+		offscreen->resize(width_, height_);
+		log("Rendering offscreen at %dx%d.", width, height);
+	}
+	else {
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
+		SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+		SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, SDL_TRUE);
+		unsigned int flags = SDL_GL_CONTEXT_FORWARD_COMPATIBLE_FLAG;
 #ifdef _DEBUG
-	flags |= GL_CONTEXT_FLAG_DEBUG_BIT;
+		flags |= GL_CONTEXT_FLAG_DEBUG_BIT;
 #endif
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, flags);
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, GL_CONTEXT_CORE_PROFILE_BIT);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, flags);
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, GL_CONTEXT_CORE_PROFILE_BIT);
 
-	context = SDL_GL_CreateContext(window);
-	if (!context) sys_crash("Could not create GL context.");
+		context = SDL_GL_CreateContext(window);
+		if (!context) sys_crash("Could not create GL context.");
 
-	if (SDL_GL_MakeCurrent(window, context)) sys_crash("Could not make context current.");
+		if (SDL_GL_MakeCurrent(window, context)) sys_crash("Could not make context current.");
 
-	if (!gladLoadGLLoader(SDL_GL_GetProcAddress)) sys_crash("Could not load GL functions.");
+		if (!gladLoadGLLoader(SDL_GL_GetProcAddress)) sys_crash("Could not load GL functions.");
+	}
 
 #ifdef _DEBUG
 	if (glDebugMessageCallback) {
@@ -85,22 +128,57 @@ Gfx::Gfx(const char* title, int width, int height, bool fullscreen) {
 	glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &numTextureUnits);
 	textureUnits.resize(numTextureUnits);
 
-	spriteShader = new Shader("media/shaders/sprite_vs.glsl", "media/shaders/sprite_fs.glsl");
-	radialProgressShader = new Shader("media/shaders/sprite_vs.glsl", "media/shaders/radial_fs.glsl");
+	auto spriteVS = useInstancing ? "media/shaders/sprite_instanced_vs.glsl" : "media/shaders/sprite_vs.glsl";
+	spriteShader = new Shader(spriteVS, "media/shaders/sprite_fs.glsl");
+	radialProgressShader = new Shader(spriteVS, "media/shaders/radial_fs.glsl");
+	spriteArrayShader = new Shader(spriteVS, "media/shaders/sprite_array_fs.glsl");
+	tileMapShader = new Shader("media/shaders/tilemap_vs.glsl", "media/shaders/tilemap_fs.glsl");
+	tileMapArrayShader = new Shader("media/shaders/tilemap_vs.glsl", "media/shaders/tilemap_array_fs.glsl");
+	glGenVertexArrays(1, &emptyVertexArray);
+	if (useTextureArray) textureArray = new Texture(1024, 1024, 8);
 
-	spriteMesh = new Mesh();
+	spriteMesh = new Mesh(maxBatchQuads, useInstancing);
 }
 
 Gfx::~Gfx() {
 	delete spriteMesh;
 	delete spriteShader;
-	SDL_GL_DeleteContext(context);
-	SDL_DestroyWindow(window);
+	delete spriteArrayShader;
+	delete tileMapShader;
+	delete tileMapArrayShader;
+	delete radialProgressShader;
+	delete textureArray;
+	if (headless) return;
+	if (software) {
+		delete software;
+	}
+	else {
+		glDeleteVertexArrays(1, &emptyVertexArray);
+		if (offscreen) delete offscreen;
+		else SDL_GL_DeleteContext(context);
+	}
+	if (window) SDL_DestroyWindow(window);
 }
 
 void Gfx::beginFrame() {
-	SDL_GetWindowSize(window, &width_, &height_);
-
+	if (headless) return;
+	if (window) {
+		int width, height;
+		SDL_GetWindowSize(window, &width, &height);
+		setSize(width, height);
+	}
+	queue.clear();
+	currentLayer = LAYER_GUI;
+	currentDepth = DEPTH_BOTTOM_EDGE;
+	drawCalls_ = 0;
+	spritesDrawn_ = 0;
+
+	if (software) {
+		software->resize(width_, height_);
+		software->clear(clearColor);
+		return;
+	}
+	if (offscreen) offscreen->resize(width_, height_);
 	glViewport(0, 0, width_, height_);
 	glClearColor(clearColor.x, clearColor.y, clearColor.z, clearColor.w);
 	glClearDepth(1.0);
@@ -108,8 +186,63 @@ void Gfx::beginFrame() {
 }
 
 void Gfx::endFrame() {
+	if (headless) return;
+	spritesDrawn_ = int(queue.size());
+	drawQueue();
 	endSprites();
-	SDL_GL_SwapWindow(window);
+	if (software) software->finish();
+	if (frames++ == screenshotFrame) writeScreenshot();
+
+	if (offscreen) {
+		// Nothing to present, wait for the GPU so frame times include rendering
+		glFinish();
+		return;
+	}
+	if (!software) {
+		SDL_GL_SwapWindow(window);
+		return;
+	}
+	if (!window) return;
+	auto surface = SDL_GetWindowSurface(window);
+	if (!surface) return;
+	SDL_LockSurface(surface);
+	SDL_ConvertPixels(std::min(software->width(), surface->w), std::min(software->height(), surface->h), SDL_PIXELFORMAT_RGBA32, software->pixels(), software->stride() * 4, surface->format->format, surface->pixels, surface->pitch);
+	SDL_UnlockSurface(surface);
+	SDL_UpdateWindowSurface(window);
+}
+
+void Gfx::writeScreenshot() {
+	// RGBA rows, from the top in software and from the bottom in GL
+	const int width = software ? software->width() : width_.load();
+	const int height = software ? software->height() : height_.load();
+	std::vector<uint32_t> pixels(size_t(width) * height);
+	if (software) {
+		for (int y = 0; y < height; y++) {
+			std::copy_n(software->pixels() + size_t(y) * software->stride(), width, pixels.data() + size_t(y) * width);
+		}
+	}
+	else {
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	}
+
+	std::ofstream file(screenshotFile, std::ios::binary);
+	if (!file.good()) {
+		log_error("Could not open screenshot file %s.", screenshotFile.c_str());
+		return;
+	}
+	file << "P6\n" << width << " " << height << "\n255\n";
+	std::vector<char> row(size_t(width) * 3);
+	for (int y = 0; y < height; y++) {
+		auto source = pixels.data() + size_t(software ? y : height - 1 - y) * width;
+		for (int x = 0; x < width; x++) {
+			row[x * 3 + 0] = char(source[x] & 255);
+			row[x * 3 + 1] = char((source[x] >> 8) & 255);
+			row[x * 3 + 2] = char((source[x] >> 16) & 255);
+		}
+		file.write(row.data(), row.size());
+	}
+	log("Saved screenshot %s.", screenshotFile.c_str());
 }
 
 void Gfx::bindTexture(Texture* texture) {
@@ -124,63 +257,313 @@ void Gfx::bindTexture(Texture* texture) {
 }
 
 Texture* Gfx::getTexture(const char* name) {
+	if (headless) return nullptr;
+
 	auto it = loadedTextures.find(name);
 	if (it != loadedTextures.end()) return it->second;
 
 	auto image = Image(name);
-	auto texture = new Texture(image);
+	Texture* texture;
+	if (software) texture = new Texture(image, true);
+	else if (textureArray && textureArray->canHold(image)) texture = new Texture(image, textureArray);
+	else texture = new Texture(image);
 	loadedTextures[name] = texture;
 	return texture;
 }
 
+void Gfx::deleteTexture(Texture* texture) {
+	if (!texture) return;
+	if (texture->unit() >= 0) textureUnits[texture->unit()] = nullptr;
+	delete texture;
+}
+
 void Gfx::beginSprites(Texture* texture) {
+	texture = texture->storage();
 	if (currentSpriteTexture == texture) return;
+	if (staticBatch) {
+		// Recording into memory, just start a new range
+		staticBatch->ranges.push_back({ texture, numSpriteElements, 0 });
+		currentSpriteTexture = texture;
+		return;
+	}
 	if (currentSpriteTexture) endSprites();
-	spriteVertices.clear();
+	if (software) {
+		spriteData = softwareVertices.data();
+		spriteCapacity = int(softwareVertices.size());
+		numSpriteElements = 0;
+		currentSpriteTexture = texture;
+		return;
+	}
+	spriteData = spriteMesh->isInstanced() ? (void*)spriteMesh->mapInstances(spriteCapacity) : (void*)spriteMesh->mapVertices(spriteCapacity);
+	numSpriteElements = 0;
 	currentSpriteTexture = texture;
 }
 
 void Gfx::endSprites() {
-	if (!spriteVertices.empty()) {
+	if (spriteData) {
+		if (!software) spriteMesh->unmap(numSpriteElements);
+		spriteData = nullptr;
+	}
+	if (numSpriteElements > 0 && software) {
+		software->drawQuads(currentSpriteTexture, softwareVertices.data(), numSpriteElements / 4);
+		drawCalls_++;
+	}
+	else if (numSpriteElements > 0) {
 		glEnable(GL_BLEND);
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		spriteShader->use();
+		auto shader = currentSpriteTexture->isArray() ? spriteArrayShader : spriteShader;
+		shader->use();
 		bindTexture(currentSpriteTexture);
-		spriteShader->texture("mainTexture", *currentSpriteTexture);
-		spriteShader->uniform("screenSize", Vec2(width_, height_));
-		spriteMesh->setVertices(spriteVertices.data(), sizeof(SpriteVertex), spriteVertices.size());
+		shader->texture("mainTexture", *currentSpriteTexture);
+		shader->uniform("screenSize", Vec2(width_, height_));
+		shader->uniform("textureSize", Vec2(currentSpriteTexture->width(), currentSpriteTexture->height()));
+		shader->uniform("offset", Vec2(0, 0));
 		spriteMesh->bind();
-		glDrawElements(GL_TRIANGLES, spriteMesh->numVertices() * 6 / 4, GL_UNSIGNED_SHORT, nullptr);
+		spriteMesh->drawQuads();
+		drawCalls_++;
 	}
+	numSpriteElements = 0;
 	currentSpriteTexture = nullptr;
 }
 
-void Gfx::drawTexture(Texture* texture, const Vec2& pos, const Vec4& color) {
-	if (currentSpriteTexture != texture) beginSprites(texture);
-	const float w = texture->width() * pixelScale;
-	const float h = texture->height() * pixelScale;
-	spriteVertices.push_back({ pos * pixelScale, {0, 1}, color });
-	spriteVertices.push_back({ pos * pixelScale + Vec2(w, 0), {1, 1}, color });
-	spriteVertices.push_back({ pos * pixelScale + Vec2(w, h), {1, 0}, color });
-	spriteVertices.push_back({ pos * pixelScale + Vec2(0, h), {0, 0}, color });
+SpriteVertex* Gfx::addQuad() {
+	if (numSpriteElements + 4 > spriteCapacity) {
+		// The mapped region is full, draw it and go on in the next one
+		auto texture = currentSpriteTexture;
+		endSprites();
+		beginSprites(texture);
+	}
+	auto quad = static_cast<SpriteVertex*>(spriteData) + numSpriteElements;
+	numSpriteElements += 4;
+	return quad;
 }
 
-void Gfx::drawTextureClip(Texture* texture, const Vec2& clipPos, const Vec2& clipSize, const Vec2& pos, const Vec2& size, const Vec4& color, bool mirrored) {
-	if (currentSpriteTexture != texture) beginSprites(texture);
-	auto uv = clipPos / Vec2(texture->width(), texture->height());
-	uv.y = 1 - uv.y;
-	auto du = clipSize.x / texture->width();
-	auto dv = -clipSize.y / texture->height();
-	if (mirrored) {
+SpriteInstance* Gfx::addInstance() {
+	if (numSpriteElements + 1 > spriteCapacity) {
+		auto texture = currentSpriteTexture;
+		endSprites();
+		beginSprites(texture);
+	}
+	return static_cast<SpriteInstance*>(spriteData) + numSpriteElements++;
+}
+
+void Gfx::drawQueue() {
+	queue.sort();
+	for (size_t i = 0; i < queue.size(); i++) {
+		auto& sprite = queue[i];
+		switch (sprite.type) {
+		case QueuedSpriteType::Clip: writeSprite(sprite); break;
+		case QueuedSpriteType::Rotated: writeRotatedSprite(sprite, queue.isShadow(i)); break;
+		case QueuedSpriteType::RadialProgress: writeRadialProgressIndicator(sprite); break;
+		case QueuedSpriteType::StaticBatch: writeStaticBatch(sprite); break;
+		case QueuedSpriteType::TileMap: writeTileMap(sprite); break;
+		}
+	}
+	queue.clear();
+}
+
+StaticBatch::~StaticBatch() {
+	delete mesh;
+}
+
+void Gfx::beginStaticBatch() {
+	if (headless || software) return;
+	recordingStatic = true;
+	staticQueue.clear();
+}
+
+StaticBatch* Gfx::endStaticBatch() {
+	if (headless || software) return nullptr;
+	recordingStatic = false;
+
+	// Write sprites into memory instead of the mapped stream buffer
+	const int elementsPerSprite = spriteMesh->isInstanced() ? 1 : 4;
+	const int elementSize = spriteMesh->isInstanced() ? sizeof(SpriteInstance) : sizeof(SpriteVertex);
+	staticData.resize(staticQueue.size() * elementsPerSprite * elementSize);
+	auto batch = new StaticBatch;
+	batch->pixelScale = pixelScale;
+	staticBatch = batch;
+	spriteData = staticData.data();
+	spriteCapacity = int(staticQueue.size()) * elementsPerSprite;
+	numSpriteElements = 0;
+	currentSpriteTexture = nullptr;
+	for (size_t i = 0; i < staticQueue.size(); i++) {
+		auto& sprite = staticQueue[i];
+		if (sprite.type == QueuedSpriteType::Clip) writeSprite(sprite);
+		else if (sprite.type == QueuedSpriteType::Rotated) writeRotatedSprite(sprite);
+	}
+	for (size_t i = 0; i < batch->ranges.size(); i++) {
+		int end = i + 1 < batch->ranges.size() ? batch->ranges[i + 1].first : numSpriteElements;
+		batch->ranges[i].count = end - batch->ranges[i].first;
+	}
+	batch->mesh = new StaticMesh(*spriteMesh, staticData.data(), numSpriteElements);
+
+	staticBatch = nullptr;
+	spriteData = nullptr;
+	numSpriteElements = 0;
+	currentSpriteTexture = nullptr;
+	staticQueue.clear();
+	return batch;
+}
+
+void Gfx::drawStaticBatch(const StaticBatch* batch, const Vec2& position) {
+	if (headless || !batch || batch->ranges.empty()) return;
+	push({ batch->ranges[0].texture, position, Vec2(0, 0), Vec2(0, 0), Vec2(0, 0), Vec4::WHITE, 0, QueuedSpriteType::StaticBatch, false, batch });
+}
+
+void Gfx::writeStaticBatch(const QueuedSprite& sprite) {
+	endSprites();
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	for (auto& range : sprite.batch->ranges) {
+		auto shader = range.texture->isArray() ? spriteArrayShader : spriteShader;
+		shader->use();
+		bindTexture(range.texture);
+		shader->texture("mainTexture", *range.texture);
+		shader->uniform("screenSize", Vec2(width_, height_));
+		shader->uniform("textureSize", Vec2(range.texture->width(), range.texture->height()));
+		shader->uniform("offset", sprite.pos * pixelScale);
+		drawCalls_ += sprite.batch->mesh->draw(range.first, range.count);
+	}
+}
+
+void Gfx::drawTileMap(const TileMap* map, const Vec2& camera) {
+	if (headless || software || !map || !map->cells || !map->texture) return;
+	QueuedSprite sprite{ map->texture, camera, Vec2(0, 0), Vec2(0, 0), Vec2(0, 0), Vec4::WHITE, 0, QueuedSpriteType::TileMap, false };
+	sprite.tileMap = map;
+	push(sprite);
+}
+
+void Gfx::writeTileMap(const QueuedSprite& sprite) {
+	endSprites();
+
+	auto map = sprite.tileMap;
+	auto texture = map->texture->storage();
+	auto shader = texture->isArray() ? tileMapArrayShader : tileMapShader;
+	shader->use();
+	bindTexture(texture);
+	bindTexture(map->cells);
+	shader->texture("mainTexture", *texture);
+	shader->texture("tileMap", *map->cells);
+	shader->uniform("layer", float(map->texture->layer()));
+	shader->uniform("imageHeight", float(map->texture->height()));
+	shader->uniform("tileClips[0]", map->tileClips, TileMap::maxClips);
+	shader->uniform("roadClips[0]", map->roadClips, TileMap::maxClips);
+	shader->uniform("camera", sprite.pos);
+	shader->uniform("pixelScale", pixelScale);
+	shader->uniform("screenSize", Vec2(width_, height_));
+
+	// The shader composites tiles and roads itself and outputs premultiplied alpha
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	glBindVertexArray(emptyVertexArray);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	drawCalls_++;
+}
+
+void Gfx::writeSprite(const QueuedSprite& sprite) {
+	auto texture = sprite.texture;
+	auto& pos = sprite.pos;
+	auto& color = sprite.color;
+	beginSprites(texture);
+	auto uv = Vec2(sprite.clipPos.x, texture->height() - sprite.clipPos.y);
+	auto du = sprite.clipSize.x;
+	auto dv = -sprite.clipSize.y;
+	const float layer = float(texture->layer());
+	if (spriteMesh && spriteMesh->isInstanced()) {
+		*addInstance() = SpriteInstance((pos + sprite.size / 2) * pixelScale, sprite.size * pixelScale, uv, Vec2(du, dv), color, layer, 0, sprite.mirror);
+		return;
+	}
+	if (sprite.mirror) {
 		uv.x += du;
 		du *= -1;
 	}
-	const float w = size.x * pixelScale;
-	const float h = size.y * pixelScale;
-	spriteVertices.push_back({ pos * pixelScale, uv, color });
-	spriteVertices.push_back({ pos * pixelScale + Vec2(w, 0), uv + Vec2(du, 0), color });
-	spriteVertices.push_back({ pos * pixelScale + Vec2(w, h), uv + Vec2(du, dv), color });
-	spriteVertices.push_back({ pos * pixelScale + Vec2(0, h), uv + Vec2(0, dv), color });
+	const float w = sprite.size.x * pixelScale;
+	const float h = sprite.size.y * pixelScale;
+	auto quad = addQuad();
+	quad[0] = { pos * pixelScale, uv, color, layer };
+	quad[1] = { pos * pixelScale + Vec2(w, 0), uv + Vec2(du, 0), color, layer };
+	quad[2] = { pos * pixelScale + Vec2(w, h), uv + Vec2(du, dv), color, layer };
+	quad[3] = { pos * pixelScale + Vec2(0, h), uv + Vec2(0, dv), color, layer };
+}
+
+void Gfx::writeRotatedSprite(const QueuedSprite& sprite, bool shadow) {
+	beginSprites(sprite.texture);
+	auto uv = Vec2(sprite.clipPos.x, sprite.texture->height() - sprite.clipPos.y);
+	auto du = sprite.clipSize.x;
+	auto dv = -sprite.clipSize.y;
+	const float layer = float(sprite.texture->layer());
+	if (spriteMesh && spriteMesh->isInstanced()) {
+		// The vertex shader moves the shadow down
+		*addInstance() = SpriteInstance(sprite.pos * pixelScale, sprite.clipSize * pixelScale, uv, Vec2(du, dv), shadow ? Vec4(0, 0, 0, 0.5) : sprite.color, layer, sprite.param, sprite.mirror, shadow ? sprite.shadow * pixelScale : 0);
+		return;
+	}
+	if (sprite.mirror) {
+		uv.x += du;
+		du *= -1;
+	}
+	const float angle = sprite.param;
+	const float w = sprite.clipSize.x * pixelScale / 2;
+	const float h = sprite.clipSize.y * pixelScale / 2;
+	auto dx = Vec2(cos(angle), sin(angle)) * w;
+	auto dy = Vec2(-sin(angle), cos(angle)) * h;
+	auto position = shadow ? sprite.pos + Vec2(0, sprite.shadow) : sprite.pos;
+	auto color = shadow ? Vec4(0, 0, 0, 0.5) : sprite.color;
+	auto quad = addQuad();
+	quad[0] = { position * pixelScale - dx - dy, uv, color, layer };
+	quad[1] = { position * pixelScale + dx - dy, uv + Vec2(du, 0), color, layer };
+	quad[2] = { position * pixelScale + dx + dy, uv + Vec2(du, dv), color, layer };
+	quad[3] = { position * pixelScale - dx + dy, uv + Vec2(0, dv), color, layer };
+}
+
+void Gfx::writeRadialProgressIndicator(const QueuedSprite& sprite) {
+	endSprites();
+
+	auto& position = sprite.pos;
+	auto& color = sprite.color;
+	const float w = sprite.size.x * pixelScale;
+	const float h = sprite.size.y * pixelScale;
+	const SpriteVertex quad[4]{
+		{ position * pixelScale, {0, 1}, color, 0 },
+		{ position * pixelScale + Vec2(w, 0), {1, 1}, color, 0 },
+		{ position * pixelScale + Vec2(w, h), {1, 0}, color, 0 },
+		{ position * pixelScale + Vec2(0, h), {0, 0}, color, 0 },
+	};
+	drawCalls_++;
+	if (software) {
+		software->drawRadialProgress(quad, sprite.param);
+		return;
+	}
+	int capacity;
+	if (spriteMesh->isInstanced()) {
+		*spriteMesh->mapInstances(capacity) = SpriteInstance(position * pixelScale + Vec2(w, h) / 2, Vec2(w, h), Vec2(0, 1), Vec2(1, -1), color, 0, 0, false);
+		spriteMesh->unmap(1);
+	}
+	else {
+		std::copy(quad, quad + 4, spriteMesh->mapVertices(capacity));
+		spriteMesh->unmap(4);
+	}
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	radialProgressShader->use();
+	radialProgressShader->uniform("screenSize", Vec2(width_, height_));
+	radialProgressShader->uniform("textureSize", Vec2(1, 1));
+	radialProgressShader->uniform("progress", sprite.param);
+	spriteMesh->bind();
+	spriteMesh->drawQuads();
+}
+
+void Gfx::drawTexture(Texture* texture, const Vec2& pos, const Vec4& color) {
+	if (headless) return;
+	auto size = Vec2(texture->width(), texture->height());
+	push({ texture, pos, size, Vec2(0, 0), size, color, 0, QueuedSpriteType::Clip, false });
+}
+
+void Gfx::drawTextureClip(Texture* texture, const Vec2& clipPos, const Vec2& clipSize, const Vec2& pos, const Vec2& size, const Vec4& color, bool mirrored) {
+	if (headless) return;
+	push({ texture, pos, size, clipPos, clipSize, color, 0, QueuedSpriteType::Clip, mirrored });
 }
 
 void Gfx::drawTextureSliced(Texture* texture, const Vec2& clipPos, const Vec2& clipSize, const Vec4& borders, const Vec2& pos, const Vec2& size, const Vec4& color) {
@@ -234,45 +617,19 @@ void Gfx::drawSprite(const Sprite& sprite, const Vec2& position, const Vec4& col
 }
 
 void Gfx::drawRotatedSprite(const Sprite& sprite, const Vec2& position, float angle, const Vec4& color, bool mirrored) {
-	if (currentSpriteTexture != sprite.texture) beginSprites(sprite.texture);
-	auto uv = sprite.clipPosition / Vec2(sprite.texture->width(), sprite.texture->height());
-	uv.y = 1 - uv.y;
-	auto du = sprite.clipSize.x / sprite.texture->width();
-	auto dv = -sprite.clipSize.y / sprite.texture->height();
-	if (mirrored) {
-		uv.x += du;
-		du *= -1;
-	}
-	const float w = sprite.clipSize.x * pixelScale / 2;
-	const float h = sprite.clipSize.y * pixelScale / 2;
-	auto dx = Vec2(cos(angle), sin(angle)) * w;
-	auto dy = Vec2(-sin(angle), cos(angle)) * h;
-	spriteVertices.push_back({ position * pixelScale - dx - dy, uv, color });
-	spriteVertices.push_back({ position * pixelScale + dx - dy, uv + Vec2(du, 0), color });
-	spriteVertices.push_back({ position * pixelScale + dx + dy, uv + Vec2(du, dv), color });
-	spriteVertices.push_back({ position * pixelScale - dx + dy, uv + Vec2(0, dv), color });
+	if (headless) return;
+	push({ sprite.texture, position, sprite.clipSize, sprite.clipPosition, sprite.clipSize, color, angle, QueuedSpriteType::Rotated, mirrored });
 }
 
+void Gfx::drawShadowedSprite(const Sprite& sprite, const Vec2& position, float angle, float height, const Vec4& color) {
+	if (headless) return;
+	QueuedSprite queued{ sprite.texture, position - Vec2(0, height), sprite.clipSize, sprite.clipPosition, sprite.clipSize, color, angle, QueuedSpriteType::Rotated, false };
+	queued.shadow = height;
+	queued.hasShadow = true;
+	push(queued);
+}
 
 void Gfx::drawRadialProgressIndicator(const Vec2& position, const Vec2& size, float progress, const Vec4& color) {
-	endSprites();
-	spriteVertices.clear();
-
-	const float w = size.x * pixelScale;
-	const float h = size.y * pixelScale;
-	spriteVertices.push_back({ position * pixelScale, {0, 1}, color });
-	spriteVertices.push_back({ position * pixelScale + Vec2(w, 0), {1, 1}, color });
-	spriteVertices.push_back({ position * pixelScale + Vec2(w, h), {1, 0}, color });
-	spriteVertices.push_back({ position * pixelScale + Vec2(0, h), {0, 0}, color });
-
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	radialProgressShader->use();
-	radialProgressShader->uniform("screenSize", Vec2(width_, height_));
-	radialProgressShader->uniform("progress", progress);
-	spriteMesh->setVertices(spriteVertices.data(), sizeof(SpriteVertex), spriteVertices.size());
-	spriteMesh->bind();
-	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, nullptr);
-
-	spriteVertices.clear();
-}
\ No newline at end of file
+	if (headless) return;
+	push({ nullptr, position, size, Vec2(0, 0), Vec2(0, 0), color, progress, QueuedSpriteType::RadialProgress, false });
+}
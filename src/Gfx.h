@@ -29,31 +29,104 @@ SOFTWARE.
 #include "Vec4.h"
 #include "Mesh.h"
 #include "SpriteVertex.h"
+#include "RenderQueue.h"
 #include <SDL2/SDL.h>
+#include <atomic>
 #include <vector>
 #include <map>
 #include <string>
 
 class Texture;
 class Shader;
+class StaticMesh;
+class SoftwareRenderer;
+class OffscreenContext;
 struct Sprite;
 
+// Sprites kept on the GPU for content that rarely changes, see Gfx::beginStaticBatch
+struct StaticBatch {
+	~StaticBatch();
+
+	struct Range {
+		Texture* texture;
+		int first;
+		int count;
+	};
+
+	StaticMesh* mesh{ nullptr };
+	std::vector<Range> ranges;
+	// Positions were recorded at this scale, the batch has to be rebuilt when it changes
+	float pixelScale{ 1 };
+};
+
+// Grid of 32x32 tiles with roads on top, drawn by Gfx::drawTileMap in a single pass
+struct TileMap {
+	static const int maxClips = 32;
+
+	// One texel per cell, x is the tile and y the road + 1 or 0 when there is none
+	Texture* cells{ nullptr };
+	// Sprite sheet all clips refer to
+	Texture* texture{ nullptr };
+	Vec2 tileClips[maxClips];
+	// Roads are 32x64 and start one cell above their own
+	Vec2 roadClips[maxClips];
+};
+
 class Gfx {
 public:
-	Gfx(const char* title, int width, int height, bool fullscreen);
+	Gfx(const char* title, int width, int height, bool fullscreen, bool headless = false);
 	~Gfx();
 
+	// Sprites per draw call before a batch is split, set before creating the Gfx
+	static int maxBatchQuads;
+	// Loads textures into layers of one texture array so GUI and world sprites share batches
+	static bool useTextureArray;
+	// Streams one instance per sprite and lets the vertex shader build the quad
+	static bool useInstancing;
+	// Rasterizes on the CPU and presents through the window surface instead of using OpenGL
+	static bool useSoftwareRenderer;
+	// Renders into a framebuffer object of a surfaceless EGL context instead of a window
+	static bool useOffscreen;
+
 	int width() const { return width_; }
 	int height() const { return height_; }
+	bool isHeadless() const { return headless; }
+	// Static batches and tile maps are not available in software
+	bool isSoftware() const { return software != nullptr; }
+	void setSize(int width, int height) { width_ = width; height_ = height; }
 
 	float getPixelScale() const { return pixelScale; }
 	void setPixelScale(float scale) { pixelScale = scale; }
 	void setClearColor(const Vec4& color) { clearColor = color; }
 
+	// Counted from beginFrame to endFrame
+	int drawCalls() const { return drawCalls_; }
+	int spritesDrawn() const { return spritesDrawn_; }
+
 	void beginFrame();
 	void endFrame();
+	// Writes the given frame, counted from 0, as a binary PPM when it is finished. Used to
+	// compare renderers on a replay.
+	void saveScreenshot(const char* filename, int frame) { screenshotFile = filename; screenshotFrame = frame; }
+
+	// Sprites are queued and sorted per layer, see RenderQueue. Reset to LAYER_GUI every frame.
+	// Parts of a unit that must stay in order, like the two halves of a health bar, share a depth.
+	void setLayer(RenderLayer layer, float depth = DEPTH_BOTTOM_EDGE) {
+		(threadQueue ? threadLayer : currentLayer) = layer;
+		(threadQueue ? threadDepth : currentDepth) = depth;
+	}
+
+	// Sprites drawn on the calling thread go into queue, with a layer of their own, until it is
+	// set back to nullptr. Lets several threads draw parts of a frame, see submit.
+	static void setThreadQueue(RenderQueue* queue) { threadQueue = queue; threadLayer = LAYER_GUI; threadDepth = DEPTH_BOTTOM_EDGE; }
+	static RenderQueue* getThreadQueue() { return threadQueue; }
+	// Adds sprites recorded with setThreadQueue after everything drawn so far, to the
+	// queue of the calling thread if it has one
+	void submit(const RenderQueue& sprites) { (threadQueue ? *threadQueue : queue).append(sprites); }
 
 	Texture* getTexture(const char* name);
+	// For textures not created by getTexture, releases their texture unit
+	void deleteTexture(Texture*);
 
 	void bindTexture(Texture*);
 
@@ -64,27 +137,83 @@ public:
 	void drawSprite(const Sprite&, const Vec2& position, const Vec2& size, const Vec4& color = Vec4::WHITE, bool mirror = false);
 	void drawSprite(const Sprite&, const Vec2& position, const Vec4& color = Vec4::WHITE, bool mirror = false);
 	void drawRotatedSprite(const Sprite&, const Vec2& position, float angle, const Vec4& color = Vec4::WHITE, bool mirror = false);
+	// Draws the sprite height pixels above position and its shadow at position from one queued sprite
+	void drawShadowedSprite(const Sprite&, const Vec2& position, float angle, float height, const Vec4& color = Vec4::WHITE);
 	void drawRadialProgressIndicator(const Vec2& position, const Vec2& size, float progress, const Vec4& color = Vec4::WHITE);
 
+	// Sprites drawn between these calls are recorded into a new batch instead of being drawn.
+	// Returns nullptr when headless, the caller deletes the batch.
+	void beginStaticBatch();
+	StaticBatch* endStaticBatch();
+	// Draws the batch in the current layer with its origin at position
+	void drawStaticBatch(const StaticBatch* batch, const Vec2& position);
+
+	// Fills the screen with the map, cell 0, 0 is at -camera. A fragment shader looks up
+	// each pixel, so the cost does not depend on how many cells are visible.
+	void drawTileMap(const TileMap* map, const Vec2& camera);
+
 private:
 	void beginSprites(Texture* texture);
 	void endSprites();
+	SpriteVertex* addQuad();
+	SpriteInstance* addInstance();
+	void push(const QueuedSprite& sprite) {
+		if (threadQueue) threadQueue->push(threadLayer, sprite, threadDepth);
+		else (recordingStatic ? staticQueue : queue).push(currentLayer, sprite, currentDepth);
+	}
+	void drawQueue();
+	void writeSprite(const QueuedSprite&);
+	void writeRotatedSprite(const QueuedSprite&, bool shadow = false);
+	void writeRadialProgressIndicator(const QueuedSprite&);
+	void writeStaticBatch(const QueuedSprite&);
+	void writeTileMap(const QueuedSprite&);
+	void writeScreenshot();
 
 private:
 	SDL_Window* window{ nullptr };
 	SDL_GLContext context{ nullptr };
-	int width_;
-	int height_;
+	// Read by the simulation thread while the render thread resizes, see SimThread
+	std::atomic<int> width_{ 0 };
+	std::atomic<int> height_{ 0 };
+	bool headless{ false };
 	Vec4 clearColor{ 1, 0, 1, 1 };
 	std::vector<Texture*> textureUnits;
+	SoftwareRenderer* software{ nullptr };
+	OffscreenContext* offscreen{ nullptr };
+	std::vector<SpriteVertex> softwareVertices;
+	std::string screenshotFile;
+	int screenshotFrame{ -1 };
+	int frames{ 0 };
+	int drawCalls_{ 0 };
+	int spritesDrawn_{ 0 };
 
 	// Sprite stuff
 	float pixelScale{ 1 };
 	Shader* spriteShader{ nullptr };
 	Shader* radialProgressShader{ nullptr };
+	Shader* spriteArrayShader{ nullptr };
+	Shader* tileMapShader{ nullptr };
+	Shader* tileMapArrayShader{ nullptr };
+	// Bound for draws that generate their vertices from gl_VertexID
+	unsigned int emptyVertexArray{ 0 };
+	Texture* textureArray{ nullptr };
 	Texture* currentSpriteTexture{ nullptr };
-	std::vector<SpriteVertex> spriteVertices;
+	// Mapped vertices or instances of the current batch
+	void* spriteData{ nullptr };
+	int numSpriteElements{ 0 };
+	int spriteCapacity{ 0 };
 	Mesh* spriteMesh{ nullptr };
+	RenderQueue queue;
+	RenderLayer currentLayer{ LAYER_GUI };
+	float currentDepth{ DEPTH_BOTTOM_EDGE };
+	static thread_local RenderQueue* threadQueue;
+	static thread_local RenderLayer threadLayer;
+	static thread_local float threadDepth;
+	// Static batch recording
+	bool recordingStatic{ false };
+	RenderQueue staticQueue;
+	StaticBatch* staticBatch{ nullptr };
+	std::vector<char> staticData;
 
 	// Resources
 	std::map<std::string, Texture*> loadedTextures;
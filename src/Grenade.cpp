@@ -23,7 +23,7 @@ SOFTWARE.
 */
 
 #include "Grenade.h"
-#include "globals.h"
+#include "Snapshot.h"
 #include "Gfx.h"
 #include "Game.h"
 #include "utils.h"
@@ -40,11 +40,46 @@ void Grenade::update(float dt, Game& game, Sfx& sfx) {
 	}
 }
 
-void Grenade::draw_top(Gfx& gfx) {
+void Grenade::draw(Gfx& gfx, const Vec2& camera) {
+	gfx.setLayer(LAYER_TOP);
 	float height = sin(time * 3.14159) * 32;
-	gfx.drawRotatedSprite(sprite, pos + (target - pos) * time - floor(cameraPosition) + Vec2(0, -height), time * rotation);
+	gfx.drawShadowedSprite(sprite, pos + (target - pos) * time - camera, time * rotation, height);
 }
 
-void Grenade::draw_bottom(Gfx& gfx) {
-	gfx.drawRotatedSprite(sprite, pos + (target - pos) * time - floor(cameraPosition), time * rotation, Vec4(0, 0, 0, 0.5));
+void Grenade::hash(StateHash& hash) const {
+	Unit::hash(hash);
+	hash.add(rotation);
+	hash.add(time);
+	hash.add(target);
+	hash.add(faction);
+}
+
+void Grenade::write(SnapshotWriter& writer) const {
+	Unit::write(writer);
+	writer.write(rotation);
+	writer.write(time);
+	writer.write(target);
+	writer.write(faction);
+}
+
+void Grenade::read(SnapshotReader& reader) {
+	Unit::read(reader);
+	reader.read(rotation);
+	reader.read(time);
+	reader.read(target);
+	reader.read(faction);
+}
+
+void Grenade::writeView(ViewWriter& writer) const {
+	Unit::writeView(writer);
+	writer.writePosition(target);
+	writer.writeFixed(rotation, 256);
+	writer.writeUnorm(time, 1);
+}
+
+void Grenade::readView(ViewReader& reader) {
+	Unit::readView(reader);
+	reader.readPosition(target);
+	reader.readFixed(rotation, 256);
+	reader.readUnorm(time, 1);
 }
@@ -23,13 +23,14 @@ SOFTWARE.
 */
 
 #include "Jet.h"
-#include "globals.h"
+#include "Snapshot.h"
 #include "Gfx.h"
 #include "Game.h"
 #include "utils.h"
 #include "Grenade.h"
 #include "Sfx.h"
 #include "AudioClip.h"
+#include <algorithm>
 
 Sprite Jet::sprites[2];
 
@@ -51,17 +52,57 @@ void Jet::update(float dt, Game& game, Sfx& sfx) {
 		grenade->time = 0.5f;
 	}
 
-	if (pos.x < 0 || pos.y < 0 || pos.x > 3000 || pos.y > 3000) {
+	// Generated levels can be much larger than the default one
+	float maxX = std::max(3000.0f, game.level.width() * 32.0f);
+	float maxY = std::max(3000.0f, game.level.height() * 32.0f);
+	if (pos.x < 0 || pos.y < 0 || pos.x > maxX || pos.y > maxY) {
 		alive = false;
 	}
 }
 
-void Jet::draw_top(Gfx& gfx) {
+void Jet::draw(Gfx& gfx, const Vec2& camera) {
+	gfx.setLayer(LAYER_TOP);
 	int frame = int(time * 10) % 2;
-	gfx.drawRotatedSprite(sprites[frame], pos - floor(cameraPosition) + Vec2(0, -32), atan2(dir.y, dir.x));
+	gfx.drawShadowedSprite(sprites[frame], pos - camera, atan2(dir.y, dir.x), 32);
 }
 
-void Jet::draw_bottom(Gfx& gfx) {
-	int frame = int(time * 10) % 2;
-	gfx.drawRotatedSprite(sprites[frame], pos - floor(cameraPosition), atan2(dir.y, dir.x), Vec4(0, 0, 0, 0.5f));
+void Jet::hash(StateHash& hash) const {
+	Unit::hash(hash);
+	hash.add(dir);
+	hash.add(target);
+	hash.add(speed);
+	hash.add(drop);
+	hash.add(time);
+}
+
+void Jet::write(SnapshotWriter& writer) const {
+	Unit::write(writer);
+	writer.write(dir);
+	writer.write(target);
+	writer.write(speed);
+	writer.write(drop);
+	writer.write(time);
+}
+
+void Jet::read(SnapshotReader& reader) {
+	Unit::read(reader);
+	reader.read(dir);
+	reader.read(target);
+	reader.read(speed);
+	reader.read(drop);
+	reader.read(time);
+}
+
+void Jet::writeView(ViewWriter& writer) const {
+	Unit::writeView(writer);
+	writer.writeAngle(atan2(dir.y, dir.x));
+	writer.writeTime(time);
+}
+
+void Jet::readView(ViewReader& reader) {
+	Unit::readView(reader);
+	float angle;
+	reader.readAngle(angle);
+	dir = Vec2(cos(angle), sin(angle));
+	reader.readTime(time);
 }
@@ -24,19 +24,114 @@ SOFTWARE.
 
 #include "Level.h"
 #include "sys.h"
+#include "StateHash.h"
+#include "Snapshot.h"
+#include "MappedFile.h"
+#include "Compress.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <fstream>
 
-std::vector<Unit*> emptyVector;
+// Handed out by reference for cells outside the level, one per thread since games may run in parallel
+static thread_local std::vector<Unit*> emptyVector;
 
-Level::Level(int width, int height) : width_(width), height_(height), tiles(new int[width * height]), structures(new int[width * height]), unitsOnTile(new std::vector<Unit*>[width * height]) {
+// Generations are unique across levels so a renderer never mistakes one level for another
+static std::atomic<uint32_t> nextGeneration{ 1 };
+
+// Level file layout: header, chunk table, then 16 byte aligned chunk data.
+// Uncompressed chunks in native byte order are used straight from the mapping.
+static const char levelMagic[4]{ 'O', 'L', 'C', 'L' };
+static const uint32_t levelVersion = 1;
+static const uint32_t levelByteOrder = 0x01020304;
+
+enum LevelCompression : uint32_t {
+	LEVEL_COMPRESSION_NONE = 0,
+	LEVEL_COMPRESSION_LZ = 1,
+};
+
+struct LevelFileHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t byteOrder;
+	int32_t width;
+	int32_t height;
+	uint32_t numChunks;
+};
+
+struct LevelChunk {
+	char id[4];
+	uint32_t compression;
+	uint32_t checksum;
+	uint32_t reserved;
+	uint64_t offset;
+	uint64_t storedSize;
+	uint64_t size;
+};
+
+static uint32_t swap32(uint32_t v) {
+	return (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24);
+}
+
+static uint64_t swap64(uint64_t v) {
+	return (uint64_t(swap32(uint32_t(v))) << 32) | swap32(uint32_t(v >> 32));
+}
+
+static uint32_t fnv1a(const char* data, size_t size) {
+	uint32_t h = 2166136261u;
+	for (size_t i = 0; i < size; i++) {
+		h = (h ^ uint8_t(data[i])) * 16777619u;
+	}
+	return h;
+}
+
+Level::Level(int width, int height) {
+	create(width, height);
+}
+
+Level::~Level() {
+	release();
+}
+
+void Level::create(int width, int height) {
+	allocate(width, height);
 	memset(tiles, 0, sizeof(int) * width * height);
 	memset(structures, -1, sizeof(int) * width * height);
 }
 
-Level::~Level() {
+void Level::allocate(int width, int height) {
+	release();
+	width_ = width;
+	height_ = height;
+	tiles = new int[width * height];
+	structures = new int[width * height];
+	unitsOnTile = new std::vector<Unit*>[width * height];
+	hashValid = false;
+	replaced();
+}
+
+void Level::replaced() {
+	generation_ = nextGeneration++;
+	chunksX = (width_ + chunkSize - 1) / chunkSize;
+	chunkRevisions.assign(chunksX * ((height_ + chunkSize - 1) / chunkSize), 0);
+}
+
+uint32_t Level::chunkRevision(int chunkX, int chunkY) const {
+	if (chunkX < 0 || chunkY < 0 || chunkX >= chunksX || chunkY * chunksX >= int(chunkRevisions.size())) return 0;
+	return chunkRevisions[chunkY * chunksX + chunkX];
+}
+
+void Level::release() {
 	delete[] unitsOnTile;
-	delete[] tiles;
-	delete[] structures;
+	if (!tilesMapped) delete[] tiles;
+	if (!structuresMapped) delete[] structures;
+	delete mapping;
+	unitsOnTile = nullptr;
+	tiles = nullptr;
+	structures = nullptr;
+	mapping = nullptr;
+	tilesMapped = false;
+	structuresMapped = false;
 }
 
 int Level::getTile(int x, int y) const {
@@ -47,7 +142,10 @@ int Level::getTile(int x, int y) const {
 void Level::setTile(int x, int y, int tile) {
 	if (x < 0 || y < 0 || x >= width_ || y >= height_) return;
 
-	tiles[y * width_ + x] = tile;
+	int index = y * width_ + x;
+	if (hashValid) stateHash ^= cellHash(index, 0, tiles[index]) ^ cellHash(index, 0, tile);
+	tiles[index] = tile;
+	touch(x, y);
 }
 
 int Level::getStructure(int x, int y) const {
@@ -58,7 +156,10 @@ int Level::getStructure(int x, int y) const {
 void Level::setStructure(int x, int y, int tile) {
 	if (x < 0 || y < 0 || x >= width_ || y >= height_) return;
 
-	structures[y * width_ + x] = tile;
+	int index = y * width_ + x;
+	if (hashValid) stateHash ^= cellHash(index, 1, structures[index]) ^ cellHash(index, 1, tile);
+	structures[index] = tile;
+	touch(x, y);
 }
 
 std::vector<Unit*>& Level::getUnits(int x, int y) const
@@ -75,6 +176,25 @@ void Level::addUnit(int x, int y, Unit* unit)
 	unitsOnTile[y * width_ + x].push_back(unit);
 }
 
+void Level::addUnits(std::vector<UnitCell>& cells)
+{
+	std::sort(cells.begin(), cells.end(), [](const UnitCell& a, const UnitCell& b) { return a.y != b.y ? a.y < b.y : a.x < b.x; });
+	for (size_t i = 0; i < cells.size();) {
+		size_t end = i + 1;
+		while (end < cells.size() && cells[end].x == cells[i].x && cells[end].y == cells[i].y) end++;
+		int x = cells[i].x;
+		int y = cells[i].y;
+		if (x >= 0 && y >= 0 && x < width_ && y < height_) {
+			auto& units = unitsOnTile[y * width_ + x];
+			units.reserve(units.size() + end - i);
+			for (; i < end; i++) {
+				units.push_back(cells[i].unit);
+			}
+		}
+		i = end;
+	}
+}
+
 void Level::removeUnit(int x, int y, Unit* unit)
 {
 	if (x < 0 || y < 0 || x >= width_ || y >= height_) return;
@@ -83,25 +203,272 @@ void Level::removeUnit(int x, int y, Unit* unit)
 	vector.erase(std::find(vector.begin(), vector.end(), unit));
 }
 
-void Level::load() {
-	std::ifstream file("media/level.dat");
-	if (!file.good()) {
-		log_error("Could not open level file for reading.");
-		return;
+bool Level::load(const char* filename, bool verify) {
+	auto file = new MappedFile(filename);
+	if (!file->isOpen()) {
+		log_error("Could not open level file %s for reading.", filename);
+		delete file;
+		return false;
+	}
+
+	LevelFileHeader header;
+	if (file->size() < sizeof(header) || memcmp(file->data(), levelMagic, 4) != 0) {
+		bool loaded = loadLegacy(file->data(), file->size());
+		delete file;
+		if (loaded) log("Loaded legacy level file %s, convert it with --convert-level.", filename);
+		return loaded;
+	}
+
+	memcpy(&header, file->data(), sizeof(header));
+	bool swap = header.byteOrder == swap32(levelByteOrder);
+	if (swap) {
+		header.version = swap32(header.version);
+		header.width = swap32(header.width);
+		header.height = swap32(header.height);
+		header.numChunks = swap32(header.numChunks);
+	}
+	if (header.version != levelVersion || (!swap && header.byteOrder != levelByteOrder) || header.width <= 0 || header.height <= 0
+		|| header.numChunks > (file->size() - sizeof(header)) / sizeof(LevelChunk)) {
+		log_error("Unsupported or damaged level file %s.", filename);
+		delete file;
+		return false;
+	}
+
+	const size_t numCells = size_t(header.width) * size_t(header.height);
+	int* newTiles = nullptr;
+	int* newStructures = nullptr;
+	bool newTilesMapped = false;
+	bool newStructuresMapped = false;
+	auto fail = [&](const char* reason) {
+		log_error("Could not load level file %s: %s", filename, reason);
+		if (!newTilesMapped) delete[] newTiles;
+		if (!newStructuresMapped) delete[] newStructures;
+		delete file;
+		return false;
+	};
+
+	for (uint32_t i = 0; i < header.numChunks; i++) {
+		LevelChunk chunk;
+		memcpy(&chunk, file->data() + sizeof(header) + sizeof(LevelChunk) * i, sizeof(chunk));
+		if (swap) {
+			chunk.compression = swap32(chunk.compression);
+			chunk.checksum = swap32(chunk.checksum);
+			chunk.offset = swap64(chunk.offset);
+			chunk.storedSize = swap64(chunk.storedSize);
+			chunk.size = swap64(chunk.size);
+		}
+
+		bool isTiles = memcmp(chunk.id, "TILE", 4) == 0;
+		bool isStructures = memcmp(chunk.id, "STRC", 4) == 0;
+		if (!isTiles && !isStructures) continue;
+		if ((isTiles && newTiles) || (isStructures && newStructures)) return fail("duplicate chunk");
+		// Checked one by one so the sum cannot overflow
+		if (chunk.offset > file->size() || chunk.storedSize > file->size() - chunk.offset) return fail("chunk out of bounds");
+		if (chunk.size != sizeof(int) * numCells) return fail("chunk size does not match level size");
+
+		const char* stored = file->data() + chunk.offset;
+		// Checking raw chunks would touch every page, so only do it on request
+		if ((verify || chunk.compression != LEVEL_COMPRESSION_NONE) && fnv1a(stored, chunk.storedSize) != chunk.checksum) {
+			return fail("checksum mismatch");
+		}
+
+		int* cells = nullptr;
+		bool mapped = false;
+		if (chunk.compression == LEVEL_COMPRESSION_NONE && !swap && chunk.offset % alignof(int) == 0) {
+			if (chunk.storedSize != chunk.size) return fail("bad chunk size");
+			cells = reinterpret_cast<int*>(file->data() + chunk.offset);
+			mapped = true;
+		}
+		else {
+			cells = new int[numCells];
+			bool ok = true;
+			if (chunk.compression == LEVEL_COMPRESSION_LZ) {
+				ok = decompress(stored, chunk.storedSize, reinterpret_cast<char*>(cells), chunk.size);
+			}
+			else if (chunk.compression == LEVEL_COMPRESSION_NONE && chunk.storedSize == chunk.size) {
+				memcpy(cells, stored, chunk.size);
+			}
+			else {
+				ok = false;
+			}
+			if (!ok) {
+				delete[] cells;
+				return fail("could not decode chunk");
+			}
+			if (swap) {
+				for (size_t c = 0; c < numCells; c++) cells[c] = swap32(cells[c]);
+			}
+		}
+
+		if (isTiles) {
+			newTiles = cells;
+			newTilesMapped = mapped;
+		}
+		else {
+			newStructures = cells;
+			newStructuresMapped = mapped;
+		}
+	}
+
+	if (!newTiles || !newStructures) return fail("missing chunk");
+
+	release();
+	width_ = header.width;
+	height_ = header.height;
+	tiles = newTiles;
+	structures = newStructures;
+	tilesMapped = newTilesMapped;
+	structuresMapped = newStructuresMapped;
+	unitsOnTile = new std::vector<Unit*>[numCells];
+	hashValid = false;
+	replaced();
+	if (tilesMapped || structuresMapped) mapping = file;
+	else delete file;
+	return true;
+}
+
+bool Level::loadLegacy(const char* data, size_t size) {
+	// Two raw int arrays without header, dimensions follow from the file size
+	size_t numCells = size / (sizeof(int) * 2);
+	if (numCells == 0 || size % (sizeof(int) * 2) != 0) {
+		log_error("Legacy level file has unexpected size %u.", unsigned(size));
+		return false;
+	}
+
+	int width = width_;
+	int height = height_;
+	if (numCells != size_t(width) * size_t(height)) {
+		width = height = int(std::sqrt(double(numCells)) + 0.5);
+		if (size_t(width) * size_t(height) != numCells) {
+			log_error("Legacy level file is not square and does not match %dx%d.", width_, height_);
+			return false;
+		}
+	}
+
+	allocate(width, height);
+	memcpy(tiles, data, sizeof(int) * numCells);
+	memcpy(structures, data + sizeof(int) * numCells, sizeof(int) * numCells);
+	return true;
+}
+
+void Level::copyFrom(const Level& other) {
+	if (other.width_ != width_ || other.height_ != height_) {
+		allocate(other.width_, other.height_);
 	}
-	file.read(reinterpret_cast<char*>(tiles), sizeof(int) * (size_t)width_ * (size_t)height_);
-	file.read(reinterpret_cast<char*>(structures), sizeof(int) * (size_t)width_ * (size_t)height_);
+	memcpy(tiles, other.tiles, sizeof(int) * width_ * height_);
+	memcpy(structures, other.structures, sizeof(int) * width_ * height_);
+	stateHash = other.stateHash;
+	hashValid = other.hashValid;
+	replaced();
+}
+
+void Level::clearUnits() {
 	for (int i = 0; i < width_ * height_; i++) {
 		unitsOnTile[i].clear();
 	}
 }
 
-void Level::save() const {
-	std::ofstream file("media/level.dat");
+bool Level::save(const char* filename, bool compressed) const {
+	std::ofstream file(filename, std::ios::binary);
+	if (!file.good()) {
+		log_error("Could not open level file %s for writing.", filename);
+		return false;
+	}
+
+	const size_t layerSize = sizeof(int) * width_ * height_;
+	const int* layers[2]{ tiles, structures };
+	const char* ids[2]{ "TILE", "STRC" };
+	std::vector<char> packed[2];
+	LevelChunk chunks[2]{};
+
+	uint64_t offset = sizeof(LevelFileHeader) + sizeof(chunks);
+	for (int i = 0; i < 2; i++) {
+		auto raw = reinterpret_cast<const char*>(layers[i]);
+		if (compressed) packed[i] = compress(raw, layerSize);
+
+		// Keep the raw layer if compression does not pay off, it can then be mapped directly
+		bool useCompressed = compressed && packed[i].size() < layerSize;
+		if (!useCompressed) packed[i].assign(raw, raw + layerSize);
+
+		offset = (offset + 15) & ~uint64_t(15);
+		memcpy(chunks[i].id, ids[i], 4);
+		chunks[i].compression = useCompressed ? LEVEL_COMPRESSION_LZ : LEVEL_COMPRESSION_NONE;
+		chunks[i].checksum = fnv1a(packed[i].data(), packed[i].size());
+		chunks[i].offset = offset;
+		chunks[i].storedSize = packed[i].size();
+		chunks[i].size = layerSize;
+		offset += packed[i].size();
+	}
+
+	LevelFileHeader header{};
+	memcpy(header.magic, levelMagic, 4);
+	header.version = levelVersion;
+	header.byteOrder = levelByteOrder;
+	header.width = width_;
+	header.height = height_;
+	header.numChunks = 2;
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(chunks), sizeof(chunks));
+
+	uint64_t written = sizeof(header) + sizeof(chunks);
+	for (int i = 0; i < 2; i++) {
+		static const char padding[16]{};
+		file.write(padding, chunks[i].offset - written);
+		file.write(packed[i].data(), packed[i].size());
+		written = chunks[i].offset + packed[i].size();
+	}
+
 	if (!file.good()) {
-		log_error("Could not open level file for writing.");
-		return;
+		log_error("Could not write level file %s.", filename);
+		return false;
+	}
+	return true;
+}
+
+void Level::write(SnapshotWriter& writer) const {
+	writer.write(width_);
+	writer.write(height_);
+	writer.writeBytes(tiles, sizeof(int) * width_ * height_);
+	writer.writeBytes(structures, sizeof(int) * width_ * height_);
+}
+
+bool Level::read(SnapshotReader& reader) {
+	int width, height;
+	reader.read(width);
+	reader.read(height);
+	if (!reader.good() || width <= 0 || height <= 0 || int64_t(width) * height > (int64_t(1) << 28)) return false;
+
+	// Decode before touching the level so a truncated snapshot leaves it as it was
+	std::vector<int> newTiles(size_t(width) * height);
+	std::vector<int> newStructures(size_t(width) * height);
+	reader.readBytes(newTiles.data(), sizeof(int) * newTiles.size());
+	reader.readBytes(newStructures.data(), sizeof(int) * newStructures.size());
+	if (!reader.good()) return false;
+
+	if (width != width_ || height != height_) {
+		allocate(width, height);
+	}
+	memcpy(tiles, newTiles.data(), sizeof(int) * width_ * height_);
+	memcpy(structures, newStructures.data(), sizeof(int) * width_ * height_);
+	clearUnits();
+	hashValid = false;
+	replaced();
+	return true;
+}
+
+uint64_t Level::hash() const {
+	if (!hashValid) rehash();
+	return stateHash;
+}
+
+uint64_t Level::cellHash(int index, int layer, int value) {
+	return StateHash::mix((uint64_t(index) << 33) ^ (uint64_t(layer) << 32) ^ uint32_t(value));
+}
+
+void Level::rehash() const {
+	stateHash = 0;
+	for (int i = 0; i < width_ * height_; i++) {
+		stateHash ^= cellHash(i, 0, tiles[i]) ^ cellHash(i, 1, structures[i]);
 	}
-	file.write(reinterpret_cast<const char*>(tiles), sizeof(int) * width_ * height_);
-	file.write(reinterpret_cast<const char*>(structures), sizeof(int) * width_ * height_);
+	hashValid = true;
 }
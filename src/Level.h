@@ -25,14 +25,49 @@ SOFTWARE.
 #pragma once
 
 #include <vector>
+#include <cstdint>
 
 class Unit;
+class SnapshotWriter;
+class SnapshotReader;
+class MappedFile;
+
+enum Structure {
+	STRUCTURE_WALL = 0,
+	STRUCTURE_HOUSE,
+	STRUCTURE_ROAD_CROSS,
+	STRUCTURE_ROAD_HORIZ,
+	STRUCTURE_ROAD_VERT,
+	STRUCTURE_ROAD_TOP_LEFT,
+	STRUCTURE_ROAD_TOP_RIGHT,
+	STRUCTURE_ROAD_BOTTOM_RIGHT,
+	STRUCTURE_ROAD_BOTTOM_LEFT,
+	STRUCTURE_ROAD_T_LEFT,
+	STRUCTURE_ROAD_T_TOP,
+	STRUCTURE_ROAD_T_RIGHT,
+	STRUCTURE_ROAD_T_BOTTOM,
+	STRUCTURE_CRATER,
+	STRUCTURE_COMPUTE_CORE,
+	STRUCTURE_SILICON_REFINERY,
+	STRUCTURE_DRONE_DEPLOYER,
+	STRUCTURE_REPAIR_DRONE_DEPLOYER,
+	STRUCTURE_COUNT,
+};
+
+struct UnitCell {
+	int x;
+	int y;
+	Unit* unit;
+};
 
 class Level {
 public:
 	Level(int width, int height);
 	~Level();
 
+	// Resizes to an empty level, cells may then be filled from several threads as long as they do not overlap
+	void create(int width, int height);
+
 	int width() const { return width_; }
 	int height() const { return height_; }
 
@@ -43,15 +78,47 @@ public:
 	std::vector<Unit*>& getUnits(int x, int y) const;
 	void addUnit(int x, int y, Unit* unit);
 	void removeUnit(int x, int y, Unit* unit);
+	// Sorts cells and grows every touched cell once
+	void addUnits(std::vector<UnitCell>& cells);
+	void clearUnits();
 
-	void load();
-	void save() const;
+	bool load(const char* filename = "media/level.dat", bool verify = false);
+	void copyFrom(const Level& other);
+	bool save(const char* filename = "media/level.dat", bool compressed = false) const;
+	void write(SnapshotWriter& writer) const;
+	bool read(SnapshotReader& reader);
+
+	// Hash over tiles and structures, computed on first use and then kept up to date on every change
+	uint64_t hash() const;
+
+	// Change tracking for renderers that cache cells. The generation changes when the whole level
+	// is replaced, the revision of a chunk whenever a tile or structure inside it changes.
+	static const int chunkSize = 16;
+	uint32_t generation() const { return generation_; }
+	uint32_t chunkRevision(int chunkX, int chunkY) const;
+
+private:
+	void allocate(int width, int height);
+	void release();
+	bool loadLegacy(const char* data, size_t size);
+	static uint64_t cellHash(int index, int layer, int value);
+	void rehash() const;
+	void replaced();
+	void touch(int x, int y) { chunkRevisions[(y / chunkSize) * chunksX + x / chunkSize]++; }
 
 private:
-	int width_;
-	int height_;
-	int* tiles;
-	int* structures;
-	std::vector<Unit*>* unitsOnTile;
+	int width_{ 0 };
+	int height_{ 0 };
+	int* tiles{ nullptr };
+	int* structures{ nullptr };
+	std::vector<Unit*>* unitsOnTile{ nullptr };
+	MappedFile* mapping{ nullptr };
+	bool tilesMapped{ false };
+	bool structuresMapped{ false };
+	mutable uint64_t stateHash{ 0 };
+	mutable bool hashValid{ false };
+	uint32_t generation_{ 0 };
+	int chunksX{ 0 };
+	std::vector<uint32_t> chunkRevisions;
 };
 
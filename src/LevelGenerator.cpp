@@ -0,0 +1,222 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "LevelGenerator.h"
+#include "Level.h"
+#include "StateHash.h"
+#include "sys.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+static const int chunkSize = 64;
+
+namespace {
+	// Random streams of the generator, kept apart from the render layers
+	enum LevelGeneratorLayer {
+		GEN_ROAD_X,
+		GEN_ROAD_Y,
+		GEN_VERTICAL_SEGMENT,
+		GEN_HORIZONTAL_SEGMENT,
+		GEN_PLAZA,
+		GEN_HOUSE,
+		GEN_FLOOR,
+	};
+}
+
+static uint32_t cellRandom(uint32_t seed, int layer, int x, int y) {
+	return uint32_t(StateHash::mix((uint64_t(seed) << 32 | uint32_t(layer)) ^ StateHash::mix(uint64_t(uint32_t(x)) << 32 | uint32_t(y))));
+}
+
+// Road pieces by connected neighbours, bit 0 north, 1 east, 2 south, 3 west
+static const int roadPieces[16]{
+	STRUCTURE_ROAD_CROSS,
+	STRUCTURE_ROAD_VERT,
+	STRUCTURE_ROAD_HORIZ,
+	STRUCTURE_ROAD_TOP_RIGHT,
+	STRUCTURE_ROAD_VERT,
+	STRUCTURE_ROAD_VERT,
+	STRUCTURE_ROAD_BOTTOM_RIGHT,
+	STRUCTURE_ROAD_T_RIGHT,
+	STRUCTURE_ROAD_HORIZ,
+	STRUCTURE_ROAD_TOP_LEFT,
+	STRUCTURE_ROAD_HORIZ,
+	STRUCTURE_ROAD_T_TOP,
+	STRUCTURE_ROAD_BOTTOM_LEFT,
+	STRUCTURE_ROAD_T_LEFT,
+	STRUCTURE_ROAD_T_BOTTOM,
+	STRUCTURE_ROAD_CROSS,
+};
+
+// Roads run along a jittered grid. Line positions and which segments between two
+// crossings exist are decided once up front, cells then only look them up.
+struct RoadGrid {
+	int blockSize;
+	int columns;
+	int rows;
+	// Per cell coordinate: index of the last road line at or before it, -1 before the first
+	std::vector<int> lineX;
+	std::vector<int> lineY;
+	std::vector<uint8_t> onLineX;
+	std::vector<uint8_t> onLineY;
+	// Segments are indexed by the line they lie on and the line they start at
+	std::vector<uint8_t> verticalSegments;
+	std::vector<uint8_t> horizontalSegments;
+	std::vector<uint8_t> plazas;
+
+	RoadGrid(const LevelGeneratorOptions& options) : blockSize(std::max(options.blockSize, 4)) {
+		columns = options.width / blockSize + 1;
+		rows = options.height / blockSize + 1;
+		lineX = lines(options.seed, GEN_ROAD_X, options.width, onLineX);
+		lineY = lines(options.seed, GEN_ROAD_Y, options.height, onLineY);
+
+		verticalSegments.resize(columns * rows);
+		horizontalSegments.resize(columns * rows);
+		plazas.resize(columns * rows);
+		for (int j = 0; j < rows; j++) {
+			for (int i = 0; i < columns; i++) {
+				verticalSegments[j * columns + i] = int(cellRandom(options.seed, GEN_VERTICAL_SEGMENT, i, j) % 100) < options.roadPercent;
+				horizontalSegments[j * columns + i] = int(cellRandom(options.seed, GEN_HORIZONTAL_SEGMENT, i, j) % 100) < options.roadPercent;
+				plazas[j * columns + i] = int(cellRandom(options.seed, GEN_PLAZA, i, j) % 100) < options.plazaPercent;
+			}
+		}
+	}
+
+	std::vector<int> lines(uint32_t seed, int layer, int size, std::vector<uint8_t>& onLine) {
+		std::vector<int> index(size);
+		onLine.resize(size);
+		int line = -1;
+		int next = 0;
+		for (int v = 0; v < size; v++) {
+			if (v == next + int(cellRandom(seed, layer, line + 1, 0) % (blockSize / 4))) {
+				line++;
+				next += blockSize;
+				onLine[v] = true;
+			}
+			index[v] = line;
+		}
+		return index;
+	}
+
+	bool vertical(int i, int j) const {
+		return i >= 0 && j >= 0 && i < columns && j < rows && verticalSegments[j * columns + i];
+	}
+
+	bool horizontal(int i, int j) const {
+		return i >= 0 && j >= 0 && i < columns && j < rows && horizontalSegments[j * columns + i];
+	}
+
+	bool isRoad(int x, int y) const {
+		if (x < 0 || y < 0 || x >= int(lineX.size()) || y >= int(lineY.size())) return false;
+		int i = lineX[x];
+		int j = lineY[y];
+		if (onLineX[x] && onLineY[y]) return vertical(i, j) || vertical(i, j - 1) || horizontal(i, j) || horizontal(i - 1, j);
+		if (onLineX[x]) return vertical(i, j);
+		if (onLineY[y]) return horizontal(i, j);
+		return false;
+	}
+
+	int roadPiece(int x, int y) const {
+		int mask = (isRoad(x, y - 1) ? 1 : 0) | (isRoad(x + 1, y) ? 2 : 0) | (isRoad(x, y + 1) ? 4 : 0) | (isRoad(x - 1, y) ? 8 : 0);
+		return roadPieces[mask];
+	}
+
+	bool isPlaza(int x, int y) const {
+		int i = lineX[x];
+		int j = lineY[y];
+		return i >= 0 && j >= 0 && plazas[j * columns + i];
+	}
+};
+
+static void generateChunk(Level& level, const RoadGrid& grid, const LevelGeneratorOptions& options, int chunkX, int chunkY, int coreX, int coreY) {
+	int endX = std::min(chunkX + chunkSize, options.width);
+	int endY = std::min(chunkY + chunkSize, options.height);
+	for (int y = chunkY; y < endY; y++) {
+		for (int x = chunkX; x < endX; x++) {
+			if (grid.isRoad(x, y)) {
+				level.setStructure(x, y, grid.roadPiece(x, y));
+				continue;
+			}
+
+			// The block around the core is always open floor so the player can start building
+			bool core = grid.lineX[x] == grid.lineX[coreX] && grid.lineY[y] == grid.lineY[coreY];
+			if (core || grid.isPlaza(x, y)) {
+				level.setTile(x, y, 1 + cellRandom(options.seed, GEN_FLOOR, x, y) % 4);
+				if (x == coreX && y == coreY) level.setStructure(x, y, STRUCTURE_COMPUTE_CORE);
+				continue;
+			}
+
+			bool nextToRoad = grid.isRoad(x, y - 1) || grid.isRoad(x + 1, y) || grid.isRoad(x, y + 1) || grid.isRoad(x - 1, y);
+			if (nextToRoad && int(cellRandom(options.seed, GEN_HOUSE, x, y) % 100) < options.housePercent) {
+				level.setStructure(x, y, STRUCTURE_HOUSE);
+			}
+		}
+	}
+}
+
+bool generateLevel(Level& level, const LevelGeneratorOptions& options) {
+	if (options.width <= 0 || options.height <= 0) {
+		log_error("Can not generate a %dx%d level.", options.width, options.height);
+		return false;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	level.create(options.width, options.height);
+	RoadGrid grid(options);
+
+	// Keep the core off the road so it stays reachable from every side
+	int coreX = options.width / 2;
+	int coreY = options.height / 2;
+	while (coreX > 0 && grid.onLineX[coreX]) coreX--;
+	while (coreY > 0 && grid.onLineY[coreY]) coreY--;
+
+	int chunksX = (options.width + chunkSize - 1) / chunkSize;
+	int chunksY = (options.height + chunkSize - 1) / chunkSize;
+	int numChunks = chunksX * chunksY;
+	int threadCount = options.threads > 0 ? options.threads : int(std::thread::hardware_concurrency());
+	threadCount = std::max(1, std::min(threadCount, numChunks));
+
+	std::atomic<int> nextChunk{ 0 };
+	auto worker = [&]() {
+		int index;
+		while ((index = nextChunk++) < numChunks) {
+			generateChunk(level, grid, options, (index % chunksX) * chunkSize, (index / chunksX) * chunkSize, coreX, coreY);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int i = 1; i < threadCount; i++) {
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	log("Generated %dx%d level from seed %u on %d threads in %.3f s.", options.width, options.height, options.seed, threadCount, time);
+	return true;
+}
@@ -0,0 +1,46 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+class Level;
+
+struct LevelGeneratorOptions {
+	int width{ 256 };
+	int height{ 256 };
+	uint32_t seed{ 1 };
+	int threads{ 0 };
+	// Average distance between parallel roads in cells
+	int blockSize{ 16 };
+	int roadPercent{ 75 };
+	int housePercent{ 40 };
+	int plazaPercent{ 10 };
+};
+
+// Fills the level with sand, roads, houses and floor plazas around a compute core in the center.
+// Every cell only depends on the seed and its position, so chunks are generated on all cores and
+// the result does not depend on the thread count.
+bool generateLevel(Level& level, const LevelGeneratorOptions& options);
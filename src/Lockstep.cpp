@@ -0,0 +1,216 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Lockstep.h"
+#include "sys.h"
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <cstring>
+
+static const char lockstepMagic[4]{ 'O', 'L', 'C', 'N' };
+static const uint32_t noChecksum = 0xffffffff;
+
+struct LockstepPacket {
+	char magic[4];
+	uint8_t player;
+	uint8_t tickCount;
+	uint16_t reserved;
+	uint32_t seed;
+	uint32_t firstTick;		// Tick of the first command list that follows
+	uint32_t ack;			// First tick the sender still needs from the receiver
+	uint32_t checksumTick;
+	uint64_t checksum;
+	// Followed by tickCount times a command count byte and the commands
+};
+
+Lockstep::Lockstep(int player, int inputDelay)
+	: localPlayer(player), inputDelay(std::max(1, std::min(inputDelay, maxTicksPerPacket / 2))) {
+	nextLocalTick = this->inputDelay;
+	nextRemoteTick = this->inputDelay;
+	remoteAck = this->inputDelay;
+}
+
+bool Lockstep::open(const char* remoteHost, int port) {
+	if (!socket.open(port + localPlayer)) return false;
+	return resolveAddress(remoteHost, port + 1 - localPlayer, remote);
+}
+
+bool Lockstep::connect(unsigned int& gameSeed, unsigned int timeoutMs) {
+	if (localPlayer == 0) seed = gameSeed;
+
+	auto start = SDL_GetTicks();
+	while (!connected) {
+		if (SDL_GetTicks() - start > timeoutMs) {
+			log_error("Timed out waiting for the other player.");
+			return false;
+		}
+		poll();
+		SDL_Delay(10);
+	}
+
+	gameSeed = seed;
+	log("Connected as player %d with input delay %d, seed %u.", localPlayer, inputDelay, seed);
+	return true;
+}
+
+void Lockstep::poll() {
+	char buffer[1500];
+	NetAddress from;
+	int size;
+	while ((size = socket.receive(buffer, sizeof(buffer), from)) >= 0) {
+		if (from != remote) continue;
+		receive(buffer, size);
+	}
+	send();
+}
+
+bool Lockstep::canAdvance() const {
+	return connected && currentTick < nextRemoteTick;
+}
+
+const std::vector<Command>& Lockstep::advance(std::vector<Command>& local) {
+	// Whatever does not fit into this tick goes into the next one
+	int count = std::min(int(local.size()), maxCommandsPerTick);
+	auto& scheduled = localInputs[nextLocalTick++];
+	scheduled.assign(local.begin(), local.begin() + count);
+	for (auto& command : scheduled) {
+		command.player = uint8_t(localPlayer);
+	}
+	local.erase(local.begin(), local.begin() + count);
+
+	// Same order on every peer
+	tickCommands.clear();
+	auto localIt = localInputs.find(currentTick);
+	auto remoteIt = remoteInputs.find(currentTick);
+	if (localPlayer == 0 && localIt != localInputs.end()) tickCommands.insert(tickCommands.end(), localIt->second.begin(), localIt->second.end());
+	if (remoteIt != remoteInputs.end()) tickCommands.insert(tickCommands.end(), remoteIt->second.begin(), remoteIt->second.end());
+	if (localPlayer == 1 && localIt != localInputs.end()) tickCommands.insert(tickCommands.end(), localIt->second.begin(), localIt->second.end());
+	if (remoteIt != remoteInputs.end()) remoteInputs.erase(remoteIt);
+	return tickCommands;
+}
+
+void Lockstep::recordChecksum(uint64_t checksum) {
+	localChecksums[currentTick] = checksum;
+	lastChecksumTick = currentTick;
+	lastChecksum = checksum;
+	hasChecksum = true;
+	compareChecksums(currentTick);
+
+	// The other peer is never far behind, older checksums will not be compared anymore
+	while (!localChecksums.empty() && localChecksums.begin()->first + checksumInterval * 64 < currentTick) {
+		localChecksums.erase(localChecksums.begin());
+	}
+}
+
+void Lockstep::endTick() {
+	currentTick++;
+}
+
+void Lockstep::send() {
+	// Local commands are needed until the remote has them and we have run them
+	uint32_t keep = std::min(remoteAck, currentTick);
+	while (!localInputs.empty() && localInputs.begin()->first < keep) {
+		localInputs.erase(localInputs.begin());
+	}
+
+	char buffer[sizeof(LockstepPacket) + maxTicksPerPacket * (1 + maxCommandsPerTick * sizeof(Command))];
+	LockstepPacket packet;
+	memcpy(packet.magic, lockstepMagic, 4);
+	packet.player = uint8_t(localPlayer);
+	packet.reserved = 0;
+	packet.seed = seed;
+	packet.firstTick = remoteAck;
+	packet.ack = nextRemoteTick;
+	packet.checksumTick = hasChecksum ? lastChecksumTick : noChecksum;
+	packet.checksum = lastChecksum;
+
+	size_t size = sizeof(packet);
+	uint32_t lastTick = std::min(nextLocalTick, remoteAck + maxTicksPerPacket);
+	packet.tickCount = uint8_t(lastTick > remoteAck ? lastTick - remoteAck : 0);
+	for (uint32_t tick = remoteAck; tick < lastTick; tick++) {
+		auto it = localInputs.find(tick);
+		uint8_t count = it != localInputs.end() ? uint8_t(it->second.size()) : 0;
+		buffer[size++] = char(count);
+		if (count) {
+			memcpy(buffer + size, it->second.data(), count * sizeof(Command));
+			size += count * sizeof(Command);
+		}
+	}
+	memcpy(buffer, &packet, sizeof(packet));
+	socket.send(remote, buffer, size);
+}
+
+void Lockstep::receive(const char* data, int size) {
+	LockstepPacket packet;
+	if (size < int(sizeof(packet))) return;
+	memcpy(&packet, data, sizeof(packet));
+	if (memcmp(packet.magic, lockstepMagic, 4) != 0 || packet.player == localPlayer) return;
+
+	if (!connected) {
+		if (localPlayer != 0) seed = packet.seed;
+		connected = true;
+	}
+	remoteAck = std::max(remoteAck, packet.ack);
+
+	int pos = sizeof(packet);
+	for (uint32_t i = 0; i < packet.tickCount; i++) {
+		if (pos >= size) return;
+		int count = uint8_t(data[pos++]);
+		if (count > maxCommandsPerTick || pos + count * int(sizeof(Command)) > size) return;
+
+		uint32_t tick = packet.firstTick + i;
+		if (tick >= nextRemoteTick && !remoteInputs.count(tick)) {
+			auto& commands = remoteInputs[tick];
+			commands.resize(count);
+			if (count) memcpy(commands.data(), data + pos, count * sizeof(Command));
+		}
+		pos += count * sizeof(Command);
+	}
+	while (remoteInputs.count(nextRemoteTick)) {
+		nextRemoteTick++;
+	}
+
+	// Every packet repeats the latest checksum, only look at new ones
+	if (packet.checksumTick != noChecksum && (!hasRemoteChecksum || packet.checksumTick > lastRemoteChecksumTick)) {
+		hasRemoteChecksum = true;
+		lastRemoteChecksumTick = packet.checksumTick;
+		remoteChecksums[packet.checksumTick] = packet.checksum;
+		compareChecksums(packet.checksumTick);
+	}
+}
+
+void Lockstep::compareChecksums(uint32_t tick) {
+	auto localIt = localChecksums.find(tick);
+	auto remoteIt = remoteChecksums.find(tick);
+	if (localIt == localChecksums.end() || remoteIt == remoteChecksums.end()) return;
+
+	if (localIt->second != remoteIt->second && !desynced) {
+		desynced = true;
+		desyncedAt = tick;
+		log_error("Desync at tick %u: local %016llx, remote %016llx.", tick,
+			(unsigned long long)localIt->second, (unsigned long long)remoteIt->second);
+	}
+	localChecksums.erase(localIt);
+	remoteChecksums.erase(remoteIt);
+}
@@ -0,0 +1,115 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "Socket.h"
+#include <cstdint>
+#include <map>
+#include <vector>
+
+enum CommandType : uint8_t {
+	COMMAND_START,
+	COMMAND_RESTART,
+	COMMAND_NEXT_WAVE,
+	COMMAND_BUILD,
+	COMMAND_PLACE,
+	COMMAND_CAMERA,
+};
+
+// Player input that changes the simulation. Everything else is local.
+struct Command {
+	uint8_t type;
+	uint8_t player;
+	uint8_t build;
+	uint8_t padding;
+	int16_t x;
+	int16_t y;
+};
+
+// Deterministic lockstep between two peers. Only per tick commands travel
+// over the wire, every peer simulates the whole game. Local commands are
+// scheduled inputDelay ticks ahead to hide the round trip, and every packet
+// repeats all commands the other side has not acknowledged yet, so packet
+// size is bounded by the delay and never by the number of units.
+class Lockstep {
+public:
+	static const int maxCommandsPerTick = 4;
+	static const int maxTicksPerPacket = 16;
+	static const int checksumInterval = 30;
+
+	Lockstep(int player, int inputDelay);
+
+	// Player 0 listens on port and sends to port + 1, player 1 the other way round
+	bool open(const char* remoteHost, int port);
+	// Waits for the other peer, player 0 decides the seed
+	bool connect(unsigned int& seed, unsigned int timeoutMs);
+
+	void poll();
+	bool canAdvance() const;
+
+	// Schedules local commands and returns everyone's commands for the current tick
+	const std::vector<Command>& advance(std::vector<Command>& local);
+	bool needsChecksum() const { return currentTick % checksumInterval == 0; }
+	void recordChecksum(uint64_t checksum);
+	void endTick();
+
+	int player() const { return localPlayer; }
+	uint32_t tick() const { return currentTick; }
+	bool isDesynced() const { return desynced; }
+	uint32_t desyncTick() const { return desyncedAt; }
+	uint64_t bytesSent() const { return socket.bytesSent; }
+	uint64_t bytesReceived() const { return socket.bytesReceived; }
+
+private:
+	void send();
+	void receive(const char* data, int size);
+	void compareChecksums(uint32_t tick);
+
+private:
+	UdpSocket socket;
+	NetAddress remote;
+	int localPlayer;
+	int inputDelay;
+	unsigned int seed{ 0 };
+	bool connected{ false };
+
+	uint32_t currentTick{ 0 };
+	std::map<uint32_t, std::vector<Command>> localInputs;
+	std::map<uint32_t, std::vector<Command>> remoteInputs;
+	uint32_t nextLocalTick;		// First tick local commands can still go to
+	uint32_t nextRemoteTick;	// First tick we have no remote input for yet
+	uint32_t remoteAck{ 0 };	// First tick the remote still needs from us
+	std::vector<Command> tickCommands;
+
+	std::map<uint32_t, uint64_t> localChecksums;
+	std::map<uint32_t, uint64_t> remoteChecksums;
+	uint32_t lastChecksumTick{ 0 };
+	uint64_t lastChecksum{ 0 };
+	bool hasChecksum{ false };
+	uint32_t lastRemoteChecksumTick{ 0 };
+	bool hasRemoteChecksum{ false };
+	bool desynced{ false };
+	uint32_t desyncedAt{ 0 };
+};
@@ -0,0 +1,97 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "MappedFile.h"
+#include "sys.h"
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const char* filename) {
+	file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		file = nullptr;
+		log_error("Could not open %s for mapping.", filename);
+		return;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		log_error("Could not map empty file %s.", filename);
+		return;
+	}
+
+	mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+	if (!mapping) {
+		log_error("Could not create file mapping for %s.", filename);
+		return;
+	}
+
+	data_ = reinterpret_cast<char*>(MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0));
+	if (!data_) {
+		log_error("Could not map view of %s.", filename);
+		return;
+	}
+	size_ = size_t(fileSize.QuadPart);
+}
+
+MappedFile::~MappedFile() {
+	if (data_) UnmapViewOfFile(data_);
+	if (mapping) CloseHandle(mapping);
+	if (file) CloseHandle(file);
+}
+#else
+MappedFile::MappedFile(const char* filename) {
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		log_error("Could not open %s for mapping.", filename);
+		return;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		log_error("Could not map empty file %s.", filename);
+		return;
+	}
+
+	void* address = mmap(nullptr, size_t(st.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	if (address == MAP_FAILED) {
+		log_error("Could not map %s.", filename);
+		return;
+	}
+	data_ = reinterpret_cast<char*>(address);
+	size_ = size_t(st.st_size);
+}
+
+MappedFile::~MappedFile() {
+	if (data_) munmap(data_, size_);
+	if (fd >= 0) close(fd);
+}
+#endif
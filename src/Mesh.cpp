@@ -25,46 +25,125 @@ SOFTWARE.
 #include "Mesh.h"
 #include "SpriteVertex.h"
 #include "glad.h"
+#include "sys.h"
+#include <algorithm>
 #include <vector>
 
-Mesh::Mesh() {
-	int numQuads = 65536 / 4;
+// Batches never start in the last few quads of a region
+static const int minBatchVertices = 1024;
+
+template<typename T> static void uploadQuadIndices(int numQuads) {
+	int numIndices = numQuads * 6;
+	std::vector<T> indices(numIndices);
+	for (int i = 0; i < numQuads; i++) {
+		indices[i * 6 + 0] = i * 4 + 0;
+		indices[i * 6 + 1] = i * 4 + 1;
+		indices[i * 6 + 2] = i * 4 + 2;
+		indices[i * 6 + 3] = i * 4 + 2;
+		indices[i * 6 + 4] = i * 4 + 3;
+		indices[i * 6 + 5] = i * 4 + 0;
+	}
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(T) * numIndices, indices.data(), GL_STATIC_DRAW);
+}
+
+static void setVertexAttributes() {
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_SHORT, GL_FALSE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, x));
+
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, u));
+
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, color));
+
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 1, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, layer));
+
+	glEnableVertexAttribArray(4);
+	glVertexAttribPointer(4, 3, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, overbright));
+}
+
+static void enableInstanceAttributes() {
+	for (int i = 0; i < 10; i++) {
+		glEnableVertexAttribArray(i);
+		glVertexAttribDivisor(i, 1);
+	}
+}
+
+// Expects the instance buffer to be bound to GL_ARRAY_BUFFER
+static void drawInstances(int first, int count) {
+	// GL 4.0 has no base instance, so the attributes point at the first instance of the batch
+	const GLsizei stride = sizeof(SpriteInstance);
+	const size_t base = sizeof(SpriteInstance) * size_t(first);
+	glVertexAttribPointer(0, 2, GL_SHORT, GL_FALSE, stride, (void*)(base + offsetof(SpriteInstance, x)));
+	glVertexAttribPointer(1, 2, GL_SHORT, GL_FALSE, stride, (void*)(base + offsetof(SpriteInstance, width)));
+	glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_FALSE, stride, (void*)(base + offsetof(SpriteInstance, u)));
+	glVertexAttribPointer(3, 2, GL_SHORT, GL_FALSE, stride, (void*)(base + offsetof(SpriteInstance, du)));
+	glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)(base + offsetof(SpriteInstance, color)));
+	glVertexAttribPointer(5, 3, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)(base + offsetof(SpriteInstance, overbright)));
+	glVertexAttribPointer(6, 1, GL_UNSIGNED_BYTE, GL_FALSE, stride, (void*)(base + offsetof(SpriteInstance, layer)));
+	glVertexAttribPointer(7, 1, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(SpriteInstance, angle)));
+	glVertexAttribPointer(8, 1, GL_UNSIGNED_BYTE, GL_FALSE, stride, (void*)(base + offsetof(SpriteInstance, mirror)));
+	glVertexAttribPointer(9, 1, GL_SHORT, GL_FALSE, stride, (void*)(base + offsetof(SpriteInstance, shadow)));
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+}
+
+Mesh::Mesh(int maxQuads, bool instanced) : instanced(instanced) {
+	int numQuads = std::max(maxQuads, minBatchVertices / 4);
+	elementSize = instanced ? sizeof(SpriteInstance) : sizeof(SpriteVertex);
+	elementsPerRegion = instanced ? numQuads : numQuads * 4;
+	minBatchElements = instanced ? minBatchVertices / 4 : minBatchVertices;
+	GLsizeiptr ringSize = GLsizeiptr(elementSize) * elementsPerRegion * numRegions;
 
 	glGenVertexArrays(1, &vao);
 	glBindVertexArray(vao);
 
 	glGenBuffers(1, &vbo);
 	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(SpriteVertex) * numQuads * 4, nullptr, GL_DYNAMIC_DRAW);
-
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, position));
+	if (GLAD_GL_VERSION_4_4 && glBufferStorage) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, ringSize, nullptr, flags);
+		persistentData = reinterpret_cast<char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, ringSize, flags));
+		if (!persistentData) {
+			// Storage is immutable, start over with a plain buffer
+			log_error("Could not map sprite buffer persistently, falling back to orphaning.");
+			glDeleteBuffers(1, &vbo);
+			glGenBuffers(1, &vbo);
+			glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		}
+	}
+	if (!persistentData) {
+		glBufferData(GL_ARRAY_BUFFER, ringSize, nullptr, GL_STREAM_DRAW);
+	}
+	log("Sprite mesh uses %s%s.", persistentData ? "a persistently mapped ring buffer" : "buffer orphaning", instanced ? " and instancing" : "");
 
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, uv));
+	if (instanced) {
+		// Attribute offsets depend on the batch and are set when drawing
+		enableInstanceAttributes();
+		return;
+	}
 
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, color));
+	setVertexAttributes();
 
 	glGenBuffers(1, &ebo);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	int numIndices = numQuads * 6;
-	std::vector<unsigned short> indices(numIndices);
-	for (int i = 0; i < numQuads; i++) {
-		indices[i * 6 + 0] = i * 4 + 0;
-		indices[i * 6 + 1] = i * 4 + 1;
-		indices[i * 6 + 2] = i * 4 + 2;
-		indices[i * 6 + 3] = i * 4 + 2;
-		indices[i * 6 + 4] = i * 4 + 3;
-		indices[i * 6 + 5] = i * 4 + 0;
+	if (elementsPerRegion <= 65536) {
+		indexType = GL_UNSIGNED_SHORT;
+		uploadQuadIndices<unsigned short>(numQuads);
+	}
+	else {
+		indexType = GL_UNSIGNED_INT;
+		uploadQuadIndices<unsigned int>(numQuads);
 	}
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned short) * numIndices, indices.data(), GL_DYNAMIC_DRAW);
 }
 
 Mesh::~Mesh() {
+	for (auto fence : fences) {
+		if (fence) glDeleteSync(fence);
+	}
 	glDeleteVertexArrays(1, &vao);
 	glDeleteBuffers(1, &vbo);
-	glDeleteBuffers(1, &ebo);
+	if (ebo) glDeleteBuffers(1, &ebo);
 }
 
 void Mesh::bind() const {
@@ -72,8 +151,102 @@ void Mesh::bind() const {
 	glBindVertexArray(vao);
 }
 
-void Mesh::setVertices(const void* data, size_t elementSize, int num) {
+void Mesh::nextRegion() {
+	if (persistentData) {
+		// Everything drawn from the region we leave has been submitted by now
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	region = (region + 1) % numRegions;
+	cursor = region * elementsPerRegion;
+	if (region == 0 && !persistentData) orphan = true;
+
+	if (fences[region]) {
+		GLenum result;
+		do {
+			result = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		} while (result == GL_TIMEOUT_EXPIRED);
+		glDeleteSync(fences[region]);
+		fences[region] = nullptr;
+	}
+}
+
+void* Mesh::map(int& capacity) {
+	int regionEnd = (region + 1) * elementsPerRegion;
+	if (regionEnd - cursor < minBatchElements) {
+		nextRegion();
+		regionEnd = cursor + elementsPerRegion;
+	}
+	capacity = regionEnd - cursor;
+	if (persistentData) return persistentData + size_t(elementSize) * cursor;
+
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT;
+	flags |= orphan ? GL_MAP_INVALIDATE_BUFFER_BIT : GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+	orphan = false;
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	auto data = glMapBufferRange(GL_ARRAY_BUFFER, GLintptr(elementSize) * cursor, GLsizeiptr(elementSize) * capacity, flags);
+	if (!data) sys_crash("Could not map sprite buffer.");
+	return data;
+}
+
+void Mesh::unmap(int num) {
+	if (!persistentData) {
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		glFlushMappedBufferRange(GL_ARRAY_BUFFER, 0, GLsizeiptr(elementSize) * num);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	}
+	firstElement = cursor;
+	numElements_ = num;
+	cursor += num;
+}
+
+void Mesh::drawQuads() const {
+	if (!instanced) {
+		glDrawElementsBaseVertex(GL_TRIANGLES, numElements_ * 6 / 4, indexType, nullptr, firstElement);
+		return;
+	}
+
 	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, elementSize * num, data);
-	numVertices_ = num;
+	drawInstances(firstElement, numElements_);
+}
+
+StaticMesh::StaticMesh(const Mesh& stream, const void* data, int num) : instanced(stream.instanced), indexType(stream.indexType), maxQuads(stream.maxQuads()), numElements(num) {
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(stream.elementSize) * num, data, GL_STATIC_DRAW);
+
+	if (instanced) {
+		enableInstanceAttributes();
+	}
+	else {
+		setVertexAttributes();
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, stream.ebo);
+	}
+	glBindVertexArray(0);
+}
+
+StaticMesh::~StaticMesh() {
+	glDeleteVertexArrays(1, &vao);
+	glDeleteBuffers(1, &vbo);
+}
+
+int StaticMesh::draw(int first, int num) const {
+	glBindVertexArray(vao);
+	if (instanced) {
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		drawInstances(first, num);
+		return 1;
+	}
+	int drawCalls = 0;
+	// The shared index buffer covers one streaming batch at most
+	for (int quads = num / 4; quads > 0; quads -= maxQuads) {
+		int count = std::min(quads, maxQuads);
+		glDrawElementsBaseVertex(GL_TRIANGLES, count * 6, indexType, nullptr, first);
+		first += count * 4;
+		drawCalls++;
+	}
+	return drawCalls;
 }
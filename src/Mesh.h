@@ -24,19 +24,74 @@ SOFTWARE.
 
 #pragma once
 
+#include "SpriteVertex.h"
+
+struct __GLsync;
+
+// Quad mesh streamed through a ring of vertex regions. Vertices are written straight
+// into mapped buffer memory, a fence per region keeps the CPU from overwriting
+// vertices the GPU has not drawn yet. Without persistent mapping every batch maps
+// its range unsynchronized and the buffer is orphaned when the ring wraps.
+// Each region holds one full batch, above 16384 quads indices are 32 bit.
+// Instanced meshes stream one SpriteInstance per quad instead of four vertices.
 class Mesh {
 public:
-	Mesh();
+	static const int numRegions = 3;
+
+	Mesh(int maxQuads = 16384, bool instanced = false);
 	~Mesh();
 
 	void bind() const;
-	void setVertices(const void* data, size_t elementSize, int num);
-	int numVertices() const { return numVertices_; }
+	// Returns room for capacity vertices or instances, to be written before unmap
+	SpriteVertex* mapVertices(int& capacity) { return static_cast<SpriteVertex*>(map(capacity)); }
+	SpriteInstance* mapInstances(int& capacity) { return static_cast<SpriteInstance*>(map(capacity)); }
+	void unmap(int num);
+	// Draws the vertices or instances of the last unmap as quads
+	void drawQuads() const;
+	int numElements() const { return numElements_; }
+	int maxQuads() const { return instanced ? elementsPerRegion : elementsPerRegion / 4; }
+	bool isInstanced() const { return instanced; }
+	bool isPersistent() const { return persistentData != nullptr; }
+
+private:
+	friend class StaticMesh;
+	void* map(int& capacity);
+	void nextRegion();
 
 private:
 	unsigned int vao{ 0 };
 	unsigned int vbo{ 0 };
 	unsigned int ebo{ 0 };
-	int numVertices_{ 0 };
+	unsigned int indexType{ 0 };
+	bool instanced{ false };
+	int elementSize{ 0 };
+	int elementsPerRegion{ 0 };
+	int minBatchElements{ 0 };
+	char* persistentData{ nullptr };
+	__GLsync* fences[numRegions]{};
+	bool orphan{ false };
+	int region{ 0 };
+	int cursor{ 0 };
+	int firstElement{ 0 };
+	int numElements_{ 0 };
 };
 
+// Vertices or instances uploaded once, in the format of the streaming mesh whose quad indices it shares
+class StaticMesh {
+public:
+	StaticMesh(const Mesh& stream, const void* data, int num);
+	~StaticMesh();
+
+	// Binds its own vertex array, first and num count vertices or instances. Returns the
+	// number of draw calls it took.
+	int draw(int first, int num) const;
+	int size() const { return numElements; }
+
+private:
+	unsigned int vao{ 0 };
+	unsigned int vbo{ 0 };
+	bool instanced{ false };
+	unsigned int indexType{ 0 };
+	int maxQuads{ 0 };
+	int numElements{ 0 };
+};
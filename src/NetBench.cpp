@@ -0,0 +1,144 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "NetBench.h"
+#include "Server.h"
+#include "Client.h"
+#include "Game.h"
+#include "Gfx.h"
+#include "Sfx.h"
+#include "Timer.h"
+#include "sys.h"
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+namespace {
+	struct BenchClient {
+		BenchClient() : gfx("", 1280, 800, false, true), sfx(true), game(gfx, sfx, timer) {}
+
+		Timer timer;
+		Gfx gfx;
+		Sfx sfx;
+		Game game;
+		Client client;
+		uint64_t lastReceived{ 0 };
+		uint64_t lastSent{ 0 };
+	};
+
+	struct WaveBandwidth {
+		int wave{ 0 };
+		int peakUnits{ 0 };
+		int peakViewUnits{ 0 };
+		uint64_t peakDown{ 0 };
+		uint64_t totalDown{ 0 };
+		uint64_t peakUp{ 0 };
+		int seconds{ 0 };
+		size_t peakPacket{ 0 };
+	};
+}
+
+int runNetBench(const NetBenchOptions& options) {
+	Timer timer;
+	Gfx gfx("", 1280, 800, false, true);
+	Sfx sfx(true);
+	Game game(gfx, sfx, timer);
+	game.start(1);
+
+	Server server;
+	if (!server.open(options.port)) return 1;
+
+	std::vector<std::unique_ptr<BenchClient>> clients;
+	for (int i = 0; i < options.clients; i++) {
+		auto bench = std::make_unique<BenchClient>();
+		if (!bench->client.open("127.0.0.1", options.port)) return 1;
+		bench->game.client = &bench->client;
+		bench->game.start(i + 1);
+
+		// Look at the compute core from slightly different places
+		auto view = Vec2(bench->gfx.width(), bench->gfx.height()) / bench->gfx.getPixelScale();
+		bench->game.cameraPosition = game.mainCPUPosition - view / 2 + Vec2(float(i % 3 - 1), float(i / 3 % 3 - 1)) * 160;
+		clients.push_back(std::move(bench));
+	}
+	if (!clients.empty()) clients[0]->game.issue({ COMMAND_START });
+
+	std::vector<WaveBandwidth> waves(1);
+	int ticks = int(options.seconds / options.tickTime);
+	int ticksPerSecond = int(1 / options.tickTime + 0.5f);
+	double nextWave = 5;
+	for (int tick = 1; tick <= ticks; tick++) {
+		double time = tick * double(options.tickTime);
+		timer.set(options.tickTime, time);
+		server.receive(game);
+		if (time >= nextWave) {
+			Random::Use use(game.random);
+			game.spawnSquad(options.waveSize, 0);
+			nextWave += options.waveSpacing;
+			waves.push_back(WaveBandwidth());
+			waves.back().wave = int(waves.size()) - 1;
+		}
+		game.update();
+		if (tick % Server::ticksPerSnapshot == 0) server.send(game);
+
+		for (auto& bench : clients) {
+			bench->timer.set(options.tickTime, time);
+			bench->game.update();
+		}
+
+		auto& wave = waves.back();
+		wave.peakUnits = std::max(wave.peakUnits, int(game.units.size()));
+		for (auto& connection : server.connections()) {
+			wave.peakPacket = std::max(wave.peakPacket, connection.lastPacketSize);
+		}
+		if (tick % ticksPerSecond) continue;
+
+		wave.seconds++;
+		for (auto& bench : clients) {
+			uint64_t down = bench->client.bytesReceived() - bench->lastReceived;
+			uint64_t up = bench->client.bytesSent() - bench->lastSent;
+			bench->lastReceived = bench->client.bytesReceived();
+			bench->lastSent = bench->client.bytesSent();
+			wave.peakViewUnits = std::max(wave.peakViewUnits, int(bench->game.units.size()));
+			wave.peakDown = std::max(wave.peakDown, down);
+			wave.peakUp = std::max(wave.peakUp, up);
+			wave.totalDown += down;
+		}
+	}
+
+	int bound = Server::maxPacketSize * ticksPerSecond / Server::ticksPerSnapshot;
+	printf("%d clients on loopback for %.0f s, waves of %d soldiers, bound %d bytes/s per client\n",
+		options.clients, options.seconds, options.waveSize, bound);
+	printf("%5s %8s %8s %12s %12s %10s %10s\n", "wave", "units", "in view", "peak down", "avg down", "peak up", "packet");
+	bool bounded = true;
+	for (auto& wave : waves) {
+		if (!wave.seconds) continue;
+		printf("%5d %8d %8d %10llu/s %10llu/s %8llu/s %10d\n", wave.wave, wave.peakUnits, wave.peakViewUnits,
+			(unsigned long long)wave.peakDown, (unsigned long long)(wave.totalDown / (wave.seconds * std::max(options.clients, 1))),
+			(unsigned long long)wave.peakUp, int(wave.peakPacket));
+		if (wave.peakDown > uint64_t(bound)) bounded = false;
+	}
+	log("Net bench finished, bandwidth %s.", bounded ? "stayed bounded" : "exceeded the bound");
+	return bounded ? 0 : 1;
+}
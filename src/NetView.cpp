@@ -0,0 +1,202 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "NetView.h"
+#include "Unit.h"
+#include <algorithm>
+
+enum ViewChange : uint32_t {
+	VIEW_REMOVED,
+	VIEW_ADDED,
+	VIEW_CHANGED,
+};
+
+UnitView captureView(uint32_t id, const Unit& unit) {
+	UnitView view;
+	view.id = id;
+	view.type = uint8_t(unit.type());
+	ViewWriter writer(view.data);
+	unit.writeView(writer);
+	view.size = uint8_t(writer.size);
+	return view;
+}
+
+void applyView(const UnitView& view, Unit& unit) {
+	ViewReader reader(view.data, view.size);
+	unit.readView(reader);
+}
+
+Vec2 viewPosition(const UnitView& view) {
+	// Every view starts with the position
+	Vec2 pos;
+	ViewReader reader(view.data, view.size);
+	reader.readPosition(pos);
+	return pos;
+}
+
+const UnitView* findView(const ViewSet& views, uint32_t id) {
+	auto it = std::lower_bound(views.begin(), views.end(), id, [](const UnitView& view, uint32_t id) { return view.id < id; });
+	return it != views.end() && it->id == id ? &*it : nullptr;
+}
+
+static void writeEntry(PacketWriter& out, uint32_t idDelta, const UnitView* base, const UnitView* current) {
+	if (!current) {
+		out.writeVarint(idDelta << 2 | VIEW_REMOVED);
+		return;
+	}
+	if (!base || base->type != current->type || base->size != current->size) {
+		out.writeVarint(idDelta << 2 | VIEW_ADDED);
+		out.write(current->type);
+		out.write(current->size);
+		out.writeBytes(current->data, current->size);
+		return;
+	}
+
+	// Only the bytes that differ from what the client already has
+	uint32_t mask = 0;
+	for (int i = 0; i < current->size; i++) {
+		if (current->data[i] != base->data[i]) mask |= 1u << i;
+	}
+	out.writeVarint(idDelta << 2 | VIEW_CHANGED);
+	out.writeVarint(mask);
+	for (int i = 0; i < current->size; i++) {
+		if (mask & (1u << i)) out.write(current->data[i]);
+	}
+}
+
+void writeViewDelta(PacketWriter& out, const ViewSet& baseline, const ViewSet& current, uint32_t& cursor, ViewSet& sent) {
+	struct Change {
+		const UnitView* base;
+		const UnitView* current;
+		bool selected;
+	};
+	std::vector<Change> changes;
+	changes.reserve(baseline.size() + current.size());
+	size_t i = 0;
+	size_t j = 0;
+	while (i < baseline.size() || j < current.size()) {
+		if (j == current.size() || (i < baseline.size() && baseline[i].id < current[j].id)) {
+			changes.push_back({ &baseline[i++], nullptr, false });
+		}
+		else if (i == baseline.size() || current[j].id < baseline[i].id) {
+			changes.push_back({ nullptr, &current[j++], false });
+		}
+		else {
+			// Unchanged units cost nothing
+			bool same = baseline[i].sameAs(current[j]);
+			changes.push_back({ &baseline[i++], &current[j], same });
+			j++;
+		}
+	}
+
+	// Pick changes by their size with the whole id, which is never smaller than the real entry
+	char scratch[64];
+	size_t budget = out.capacity - out.size;
+	auto select = [&](Change& change) {
+		PacketWriter estimate(scratch, sizeof(scratch));
+		writeEntry(estimate, change.current ? change.current->id : change.base->id, change.base, change.current);
+		if (estimate.size > budget) return false;
+		budget -= estimate.size;
+		change.selected = true;
+		return true;
+	};
+
+	// Removals are cheap and free up the client, then round robin over everything else
+	bool full = false;
+	for (auto& change : changes) {
+		if (!change.current && !select(change)) {
+			full = true;
+			break;
+		}
+	}
+	size_t start = 0;
+	while (start < changes.size() && (changes[start].current ? changes[start].current->id : changes[start].base->id) < cursor) start++;
+	for (size_t n = 0; n < changes.size() && !full; n++) {
+		auto& change = changes[(start + n) % changes.size()];
+		if (change.selected || !change.current) continue;
+		if (!select(change)) {
+			cursor = change.current->id;
+			full = true;
+		}
+	}
+	if (!full) cursor = 0;
+
+	uint32_t lastId = 0;
+	sent.clear();
+	for (auto& change : changes) {
+		if (!change.selected) {
+			if (change.base) sent.push_back(*change.base);
+			continue;
+		}
+		if (change.base && change.current && change.base->sameAs(*change.current)) {
+			sent.push_back(*change.current);
+			continue;
+		}
+		uint32_t id = change.current ? change.current->id : change.base->id;
+		writeEntry(out, id - lastId, change.base, change.current);
+		lastId = id;
+		if (change.current) sent.push_back(*change.current);
+	}
+}
+
+bool readViewDelta(PacketReader& in, const ViewSet& baseline, ViewSet& result) {
+	result.clear();
+	size_t i = 0;
+	uint32_t id = 0;
+	while (!in.atEnd() && in.good()) {
+		uint32_t key = in.readVarint();
+		id += key >> 2;
+		while (i < baseline.size() && baseline[i].id < id) result.push_back(baseline[i++]);
+		const UnitView* base = i < baseline.size() && baseline[i].id == id ? &baseline[i++] : nullptr;
+
+		switch (key & 3) {
+		case VIEW_REMOVED:
+			break;
+		case VIEW_ADDED: {
+			UnitView view;
+			view.id = id;
+			in.read(view.type);
+			in.read(view.size);
+			if (view.size > maxViewSize) return false;
+			in.readBytes(view.data, view.size);
+			result.push_back(view);
+			break;
+		}
+		case VIEW_CHANGED: {
+			if (!base) return false;
+			UnitView view = *base;
+			uint32_t mask = in.readVarint();
+			for (int b = 0; b < view.size; b++) {
+				if (mask & (1u << b)) in.read(view.data[b]);
+			}
+			result.push_back(view);
+			break;
+		}
+		default:
+			return false;
+		}
+	}
+	while (i < baseline.size()) result.push_back(baseline[i++]);
+	return in.good();
+}
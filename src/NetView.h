@@ -0,0 +1,209 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "Vec2.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// Quantized state a client needs to draw a unit, in a fixed size buffer
+static const int maxViewSize = 24;
+
+class ViewWriter {
+public:
+	ViewWriter(uint8_t* data) : data(data) {}
+
+	template<typename T> void write(const T& v) {
+		static_assert(std::is_trivially_copyable<T>::value, "Write members individually");
+		if (size + sizeof(T) > maxViewSize) return;
+		memcpy(data + size, &v, sizeof(T));
+		size += sizeof(T);
+	}
+
+	void writeFixed(float v, float scale) {
+		float q = std::round(v * scale);
+		write(int16_t(q < -32768 ? -32768 : q > 32767 ? 32767 : q));
+	}
+	void writePosition(const Vec2& v) {
+		writeFixed(v.x, 4);
+		writeFixed(v.y, 4);
+	}
+	void writeAngle(float angle) {
+		write(uint8_t(int(std::floor(angle * 256 / 6.2831853f)) & 255));
+	}
+	// Animation time, wraps after 1024 seconds
+	void writeTime(float t) {
+		write(uint16_t(int64_t(t * 64) & 0xffff));
+	}
+	void writeUnorm(float v, float max) {
+		float q = v / max;
+		write(uint8_t((q < 0 ? 0 : q > 1 ? 1 : q) * 255 + 0.5f));
+	}
+
+	size_t size{ 0 };
+
+private:
+	uint8_t* data;
+};
+
+class ViewReader {
+public:
+	ViewReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+	template<typename T> void read(T& v) {
+		static_assert(std::is_trivially_copyable<T>::value, "Read members individually");
+		if (pos + sizeof(T) > size) {
+			memset(&v, 0, sizeof(T));
+			return;
+		}
+		memcpy(&v, data + pos, sizeof(T));
+		pos += sizeof(T);
+	}
+
+	void readFixed(float& v, float scale) {
+		int16_t q;
+		read(q);
+		v = q / scale;
+	}
+	void readPosition(Vec2& v) {
+		readFixed(v.x, 4);
+		readFixed(v.y, 4);
+	}
+	void readAngle(float& angle) {
+		uint8_t q;
+		read(q);
+		angle = q * 6.2831853f / 256;
+	}
+	void readTime(float& t) {
+		uint16_t q;
+		read(q);
+		t = q / 64.0f;
+	}
+	void readUnorm(float& v, float max) {
+		uint8_t q;
+		read(q);
+		v = q * max / 255;
+	}
+
+private:
+	const uint8_t* data;
+	size_t size;
+	size_t pos{ 0 };
+};
+
+class Unit;
+
+struct UnitView {
+	uint32_t id;
+	uint8_t type;
+	uint8_t size;
+	uint8_t data[maxViewSize];
+
+	bool sameAs(const UnitView& other) const {
+		return type == other.type && size == other.size && memcmp(data, other.data, size) == 0;
+	}
+};
+
+// Everything one client knows about, sorted by id
+typedef std::vector<UnitView> ViewSet;
+
+UnitView captureView(uint32_t id, const Unit& unit);
+void applyView(const UnitView& view, Unit& unit);
+Vec2 viewPosition(const UnitView& view);
+const UnitView* findView(const ViewSet& views, uint32_t id);
+
+// Byte buffer for datagrams, drops writes once full
+class PacketWriter {
+public:
+	PacketWriter(char* data, size_t capacity) : data(data), capacity(capacity) {}
+
+	template<typename T> void write(const T& v) { writeBytes(&v, sizeof(T)); }
+	void writeBytes(const void* bytes, size_t count) {
+		if (size + count > capacity) {
+			overflow = true;
+			return;
+		}
+		memcpy(data + size, bytes, count);
+		size += count;
+	}
+	void writeVarint(uint32_t v) {
+		while (v >= 0x80) {
+			write(uint8_t(v | 0x80));
+			v >>= 7;
+		}
+		write(uint8_t(v));
+	}
+
+	char* data;
+	size_t capacity;
+	size_t size{ 0 };
+	bool overflow{ false };
+};
+
+class PacketReader {
+public:
+	PacketReader(const char* data, size_t size) : data(data), size(size) {}
+
+	template<typename T> void read(T& v) { readBytes(&v, sizeof(T)); }
+	void readBytes(void* out, size_t count) {
+		if (pos + count > size) {
+			failed = true;
+			memset(out, 0, count);
+			return;
+		}
+		memcpy(out, data + pos, count);
+		pos += count;
+	}
+	uint32_t readVarint() {
+		uint32_t v = 0;
+		for (int shift = 0; shift < 35; shift += 7) {
+			uint8_t b;
+			read(b);
+			v |= uint32_t(b & 0x7f) << shift;
+			if (!(b & 0x80)) return v;
+		}
+		failed = true;
+		return 0;
+	}
+
+	bool atEnd() const { return pos >= size; }
+	bool good() const { return !failed; }
+
+private:
+	const char* data;
+	size_t size;
+	size_t pos{ 0 };
+	bool failed{ false };
+};
+
+// Writes what changed from baseline to current until the packet is full. Changes
+// that do not fit are picked up first next time, sent receives what the client
+// will know once it has the packet.
+void writeViewDelta(PacketWriter& out, const ViewSet& baseline, const ViewSet& current, uint32_t& cursor, ViewSet& sent);
+bool readViewDelta(PacketReader& in, const ViewSet& baseline, ViewSet& result);
@@ -0,0 +1,163 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "OffscreenContext.h"
+#include "sys.h"
+#include "glad.h"
+#include <SDL2/SDL.h>
+#include <cstdint>
+
+// The few EGL declarations needed, so no EGL headers are required to build
+typedef int32_t EGLint;
+typedef unsigned int EGLBoolean;
+typedef unsigned int EGLenum;
+typedef void* EGLDisplay;
+typedef void* EGLConfig;
+typedef void* EGLContext;
+typedef void* EGLSurface;
+
+static const EGLint EGL_NONE = 0x3038;
+static const EGLint EGL_SURFACE_TYPE = 0x3033;
+static const EGLint EGL_PBUFFER_BIT = 0x0001;
+static const EGLint EGL_RENDERABLE_TYPE = 0x3040;
+static const EGLint EGL_OPENGL_BIT = 0x0008;
+static const EGLenum EGL_OPENGL_API = 0x30A2;
+static const EGLint EGL_CONTEXT_MAJOR_VERSION = 0x3098;
+static const EGLint EGL_CONTEXT_MINOR_VERSION = 0x30FB;
+static const EGLint EGL_CONTEXT_OPENGL_PROFILE_MASK = 0x30FD;
+static const EGLint EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT = 0x0001;
+static const EGLenum EGL_PLATFORM_SURFACELESS_MESA = 0x31DD;
+
+static void* (*eglGetProcAddress)(const char*);
+static EGLDisplay (*eglGetDisplay)(void*);
+static EGLDisplay (*eglGetPlatformDisplayEXT)(EGLenum, void*, const EGLint*);
+static EGLBoolean (*eglInitialize)(EGLDisplay, EGLint*, EGLint*);
+static EGLBoolean (*eglTerminate)(EGLDisplay);
+static EGLBoolean (*eglBindAPI)(EGLenum);
+static EGLBoolean (*eglChooseConfig)(EGLDisplay, const EGLint*, EGLConfig*, EGLint, EGLint*);
+static EGLContext (*eglCreateContext)(EGLDisplay, EGLConfig, EGLContext, const EGLint*);
+static EGLBoolean (*eglDestroyContext)(EGLDisplay, EGLContext);
+static EGLBoolean (*eglMakeCurrent)(EGLDisplay, EGLSurface, EGLSurface, EGLContext);
+
+template<typename T> static bool loadFunction(void* library, T& function, const char* name) {
+	function = reinterpret_cast<T>(SDL_LoadFunction(library, name));
+	return function != nullptr;
+}
+
+OffscreenContext::OffscreenContext() {
+#ifdef _WIN32
+	library = SDL_LoadObject("libEGL.dll");
+#else
+	library = SDL_LoadObject("libEGL.so.1");
+#endif
+	if (!library) {
+		log_error("Could not load libEGL.");
+		return;
+	}
+	if (!loadFunction(library, eglGetProcAddress, "eglGetProcAddress") ||
+		!loadFunction(library, eglGetDisplay, "eglGetDisplay") ||
+		!loadFunction(library, eglInitialize, "eglInitialize") ||
+		!loadFunction(library, eglTerminate, "eglTerminate") ||
+		!loadFunction(library, eglBindAPI, "eglBindAPI") ||
+		!loadFunction(library, eglChooseConfig, "eglChooseConfig") ||
+		!loadFunction(library, eglCreateContext, "eglCreateContext") ||
+		!loadFunction(library, eglDestroyContext, "eglDestroyContext") ||
+		!loadFunction(library, eglMakeCurrent, "eglMakeCurrent")) {
+		log_error("libEGL is missing functions.");
+		return;
+	}
+	eglGetPlatformDisplayEXT = reinterpret_cast<EGLDisplay (*)(EGLenum, void*, const EGLint*)>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+
+	// Mesa's surfaceless platform needs neither a display server nor a GPU
+	if (eglGetPlatformDisplayEXT) display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, nullptr, nullptr);
+	if (!display) display = eglGetDisplay(nullptr);
+	EGLint major, minor;
+	if (!display || !eglInitialize(display, &major, &minor)) {
+		log_error("Could not initialize an EGL display.");
+		display = nullptr;
+		return;
+	}
+	log("EGL %d.%d", major, minor);
+
+	const EGLint configAttributes[]{ EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	EGLConfig config;
+	EGLint numConfigs = 0;
+	if (!eglBindAPI(EGL_OPENGL_API) || !eglChooseConfig(display, configAttributes, &config, 1, &numConfigs) || numConfigs < 1) {
+		log_error("No EGL config for desktop OpenGL.");
+		return;
+	}
+
+	const EGLint contextAttributes[]{
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 0,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	context = eglCreateContext(display, config, nullptr, contextAttributes);
+	if (!context) {
+		log_error("Could not create an OpenGL 4.0 core context.");
+		return;
+	}
+	if (!eglMakeCurrent(display, nullptr, nullptr, context)) {
+		log_error("Could not make the context current without a surface.");
+		eglDestroyContext(display, context);
+		context = nullptr;
+	}
+}
+
+OffscreenContext::~OffscreenContext() {
+	if (context) {
+		if (framebuffer) glDeleteFramebuffers(1, &framebuffer);
+		if (colorBuffer) glDeleteRenderbuffers(1, &colorBuffer);
+		if (depthBuffer) glDeleteRenderbuffers(1, &depthBuffer);
+		eglMakeCurrent(display, nullptr, nullptr, nullptr);
+		eglDestroyContext(display, context);
+	}
+	if (display) eglTerminate(display);
+	if (library) SDL_UnloadObject(library);
+}
+
+void* OffscreenContext::getProcAddress(const char* name) {
+	return eglGetProcAddress ? eglGetProcAddress(name) : nullptr;
+}
+
+void OffscreenContext::resize(int width, int height) {
+	if (framebuffer && width == this->width && height == this->height) return;
+	this->width = width;
+	this->height = height;
+
+	if (!framebuffer) {
+		glGenFramebuffers(1, &framebuffer);
+		glGenRenderbuffers(1, &colorBuffer);
+		glGenRenderbuffers(1, &depthBuffer);
+	}
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) log_error("Offscreen framebuffer is incomplete.");
+}
@@ -0,0 +1,51 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// OpenGL 4 core context on a surfaceless EGL display, rendering into a framebuffer
+// object instead of a window. libEGL is loaded at runtime, so builds without it
+// only fail when the mode is used. Works with Mesa's software drivers.
+class OffscreenContext {
+public:
+	OffscreenContext();
+	~OffscreenContext();
+
+	bool isValid() const { return context != nullptr; }
+	// For gladLoadGLLoader, valid once a context exists
+	static void* getProcAddress(const char* name);
+
+	// Creates or resizes the framebuffer and binds it, needs the GL functions to be loaded
+	void resize(int width, int height);
+
+private:
+	void* library{ nullptr };
+	void* display{ nullptr };
+	void* context{ nullptr };
+	unsigned int framebuffer{ 0 };
+	unsigned int colorBuffer{ 0 };
+	unsigned int depthBuffer{ 0 };
+	int width{ 0 };
+	int height{ 0 };
+};
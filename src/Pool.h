@@ -0,0 +1,89 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+// Free list allocator for units that are spawned by the thousands. Memory is
+// taken in chunks, so reserving before a big batch means one allocation
+// instead of one per unit. Every thread has its own pool, objects must be
+// deleted on the thread that created them.
+template<typename T> class Pool {
+public:
+	static Pool& local() {
+		thread_local Pool pool;
+		return pool;
+	}
+
+	void* allocate() {
+		if (!freeList) grow(chunkSize);
+		auto node = freeList;
+		freeList = node->next;
+		available--;
+		return node;
+	}
+
+	void release(void* p) {
+		auto node = static_cast<Node*>(p);
+		node->next = freeList;
+		freeList = node;
+		available++;
+	}
+
+	void reserve(size_t count) {
+		if (available < count) grow(count - available);
+	}
+
+	size_t capacity() const { return total; }
+
+private:
+	union Node {
+		Node* next;
+		alignas(T) char storage[sizeof(T)];
+	};
+
+	static const size_t chunkSize = 256;
+
+	void grow(size_t count) {
+		if (count < chunkSize) count = chunkSize;
+		chunks.emplace_back(new Node[count]);
+		auto chunk = chunks.back().get();
+		for (size_t i = count; i-- > 0;) {
+			chunk[i].next = freeList;
+			freeList = &chunk[i];
+		}
+		available += count;
+		total += count;
+	}
+
+private:
+	std::vector<std::unique_ptr<Node[]>> chunks;
+	Node* freeList{ nullptr };
+	size_t available{ 0 };
+	size_t total{ 0 };
+};
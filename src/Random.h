@@ -0,0 +1,81 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "sys.h"
+#include <cstdint>
+
+// Deterministic xorshift generator. Every game owns one so several games can
+// share a process, frand() draws from the one bound to the current thread.
+class Random {
+public:
+	Random(uint64_t seed = 1) { this->seed(seed); }
+
+	void seed(uint64_t seed) {
+		state = seed ^ 0x9E3779B97F4A7C15ull;
+		if (!state) state = 1;
+	}
+
+	uint32_t next() {
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return uint32_t((state * 0x2545F4914F6CDD1Dull) >> 32);
+	}
+
+	float range(float min, float max) {
+		return min + (max - min) * float(next() >> 8) / float(1 << 24);
+	}
+
+	int below(int n) {
+		return int(next() % uint32_t(n));
+	}
+
+	static Random& current() {
+		auto bound = binding();
+		// A fallback generator would make results depend on what the thread ran before
+		if (!bound) sys_crash("No random generator bound to this thread.");
+		return *bound;
+	}
+
+	// Binds a generator to the current thread for the lifetime of the scope
+	class Use {
+	public:
+		Use(Random& random) : previous(binding()) { binding() = &random; }
+		~Use() { binding() = previous; }
+
+	private:
+		Random* previous;
+	};
+
+public:
+	uint64_t state;
+
+private:
+	static Random*& binding() {
+		thread_local Random* bound = nullptr;
+		return bound;
+	}
+};
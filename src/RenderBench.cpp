@@ -0,0 +1,97 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "RenderBench.h"
+#include "Game.h"
+#include "Gfx.h"
+#include "Sfx.h"
+#include "Timer.h"
+#include "sys.h"
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+int runRenderBench(const RenderBenchOptions& options) {
+	if (!Gfx::useSoftwareRenderer) Gfx::useOffscreen = true;
+	Timer timer;
+	Gfx gfx("", options.width, options.height, false, false);
+	Sfx sfx(true);
+	Game game(gfx, sfx, timer);
+	game.start(options.seed);
+	game.issue({ COMMAND_START });
+
+	// Lissajous figure over most of the level, so the path passes through busy and empty parts
+	auto view = Vec2(gfx.width(), gfx.height()) / gfx.getPixelScale();
+	auto levelSize = Vec2(game.level.width(), game.level.height()) * 32;
+	auto center = levelSize / 2;
+	auto radius = Vec2(std::max(0.0f, levelSize.x - view.x), std::max(0.0f, levelSize.y - view.y)) * 0.45f;
+
+	std::vector<double> frameTimes;
+	frameTimes.reserve(options.frames);
+	double totalDrawCalls = 0;
+	double totalSprites = 0;
+	int maxDrawCalls = 0;
+	int maxSprites = 0;
+	double nextWave = 5;
+	const double frequency = double(SDL_GetPerformanceFrequency());
+	for (int frame = 0; frame < options.warmup + options.frames; frame++) {
+		double time = (frame + 1) * double(options.tickTime);
+		timer.set(options.tickTime, time);
+		if (options.waveSize > 0 && time >= nextWave) {
+			Random::Use use(game.random);
+			game.spawnSquad(options.waveSize, 10);
+			nextWave += options.waveSpacing;
+		}
+		game.update();
+
+		float t = float(frame) / std::max(options.frames, 1) * 2 * 3.14159265f;
+		game.cameraPosition = center + Vec2(sin(t) * radius.x, sin(2 * t) * radius.y) - view / 2;
+
+		auto start = SDL_GetPerformanceCounter();
+		gfx.beginFrame();
+		game.drawFrame();
+		gfx.endFrame();
+		if (frame < options.warmup) continue;
+		frameTimes.push_back(double(SDL_GetPerformanceCounter() - start) / frequency * 1000);
+		totalDrawCalls += gfx.drawCalls();
+		totalSprites += gfx.spritesDrawn();
+		maxDrawCalls = std::max(maxDrawCalls, gfx.drawCalls());
+		maxSprites = std::max(maxSprites, gfx.spritesDrawn());
+	}
+	if (frameTimes.empty()) return 1;
+
+	double total = 0;
+	for (auto ms : frameTimes) total += ms;
+	std::sort(frameTimes.begin(), frameTimes.end());
+	auto percentile = [&](double p) { return frameTimes[std::min(frameTimes.size() - 1, size_t(p * frameTimes.size()))]; };
+	const double frames = double(frameTimes.size());
+	printf("%d frames at %dx%d, %s\n", int(frameTimes.size()), gfx.width(), gfx.height(), gfx.isSoftware() ? "software" : "offscreen OpenGL");
+	printf("frame ms   avg %.3f  median %.3f  p95 %.3f  p99 %.3f  max %.3f\n", total / frames, percentile(0.5), percentile(0.95), percentile(0.99), frameTimes.back());
+	printf("draw calls avg %.1f  max %d\n", totalDrawCalls / frames, maxDrawCalls);
+	printf("sprites    avg %.0f  max %d\n", totalSprites / frames, maxSprites);
+	log("Render bench finished with %d units.", int(game.units.size()));
+	return 0;
+}
@@ -0,0 +1,42 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+struct RenderBenchOptions {
+	int frames{ 3600 };
+	// Frames before measuring starts, for shader compilation and buffer growth
+	int warmup{ 60 };
+	int width{ 1280 };
+	int height{ 800 };
+	unsigned int seed{ 1 };
+	int waveSize{ 2000 };
+	double waveSpacing{ 10 };
+	float tickTime{ 1.0f / 60 };
+};
+
+// Plays a game in simulated time with the camera on a fixed path over the level and
+// reports render times, draw calls and sprites per frame. Runs offscreen unless the
+// software renderer was chosen.
+int runRenderBench(const RenderBenchOptions& options);
@@ -0,0 +1,145 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "RenderQueue.h"
+#include "Texture.h"
+
+void RenderQueue::clear() {
+	sprites.clear();
+	for (auto& layer : layers) {
+		layer.keys.clear();
+		layer.indices.clear();
+	}
+	sorted = false;
+	order.clear();
+	textures.clear();
+}
+
+void RenderQueue::push(int layer, const QueuedSprite& sprite, float depth) {
+	const uint32_t index = uint32_t(sprites.size());
+	uint32_t key = 0;
+	if (layer >= LAYER_BOTTOM && layer <= LAYER_TOP) {
+		if (depth == DEPTH_BOTTOM_EDGE) {
+			depth = sprite.type == QueuedSpriteType::Rotated ? sprite.pos.y + sprite.clipSize.y / 2 : sprite.pos.y + sprite.size.y;
+		}
+		key = depthKey(depth);
+	}
+	if (layer <= LAYER_TOP && layer != LAYER_FLOOR) {
+		key |= textureId(sprite.texture);
+	}
+	add(layer, key, index);
+	if (sprite.hasShadow) {
+		add(LAYER_BOTTOM, depthKey(sprite.pos.y + sprite.shadow + sprite.clipSize.y / 2) | textureId(sprite.texture), index | SHADOW);
+	}
+	sprites.push_back(sprite);
+}
+
+uint32_t RenderQueue::depthKey(float depth) {
+	// 16.8 fixed point, biased so sprites above the screen still sort correctly
+	depth = (depth + 32768) * 256;
+	if (depth < 0) depth = 0;
+	if (depth > 16777215) depth = 16777215;
+	return uint32_t(depth) << 8;
+}
+
+void RenderQueue::add(int layer, uint32_t key, uint32_t index) {
+	layers[layer].keys.push_back(key);
+	layers[layer].indices.push_back(index);
+}
+
+void RenderQueue::append(const RenderQueue& other) {
+	const uint32_t base = uint32_t(sprites.size());
+	sprites.insert(sprites.end(), other.sprites.begin(), other.sprites.end());
+	for (int layer = 0; layer < LAYER_COUNT; layer++) {
+		auto& source = other.layers[layer];
+		for (size_t i = 0; i < source.keys.size(); i++) {
+			// Texture ids are numbered per queue
+			auto& sprite = other.sprites[source.indices[i] & ~SHADOW];
+			uint32_t key = source.keys[i];
+			if (key & 0xFF) key = (key & ~0xFFu) | textureId(sprite.texture);
+			add(layer, key, source.indices[i] + base);
+		}
+	}
+}
+
+uint32_t RenderQueue::textureId(const Texture* texture) {
+	if (!texture) return 0;
+	texture = texture->storage();
+	for (size_t i = 0; i < textures.size(); i++) {
+		if (textures[i] == texture) return uint32_t(i + 1);
+	}
+	if (textures.size() == 255) return 255;
+	textures.push_back(texture);
+	return uint32_t(textures.size());
+}
+
+void RenderQueue::sort() {
+	order.clear();
+	order.reserve(sprites.size());
+	for (int layer = 0; layer < LAYER_COUNT; layer++) {
+		// These two are drawn in submission order
+		if (layer != LAYER_FLOOR && layer != LAYER_GUI) sortLayer(layers[layer]);
+		order.insert(order.end(), layers[layer].indices.begin(), layers[layer].indices.end());
+	}
+	sorted = true;
+}
+
+void RenderQueue::sortLayer(Layer& layer) {
+	// LSD radix sort over the key bytes, it is stable so equal keys keep their submission order
+	auto& keys = layer.keys;
+	auto& indices = layer.indices;
+	const size_t count = keys.size();
+	if (count < 2) return;
+
+	size_t histograms[4][256]{};
+	for (auto key : keys) {
+		for (int byte = 0; byte < 4; byte++) {
+			histograms[byte][(key >> (byte * 8)) & 0xFF]++;
+		}
+	}
+
+	sortedKeys.resize(count);
+	sortedIndices.resize(count);
+	for (int byte = 0; byte < 4; byte++) {
+		auto& histogram = histograms[byte];
+		const int shift = byte * 8;
+
+		// Skip bytes that are the same in all keys
+		if (histogram[(keys[0] >> shift) & 0xFF] == count) continue;
+
+		size_t offset = 0;
+		for (auto& bucket : histogram) {
+			size_t n = bucket;
+			bucket = offset;
+			offset += n;
+		}
+		for (size_t i = 0; i < count; i++) {
+			size_t dst = histogram[(keys[i] >> shift) & 0xFF]++;
+			sortedKeys[dst] = keys[i];
+			sortedIndices[dst] = indices[i];
+		}
+		keys.swap(sortedKeys);
+		indices.swap(sortedIndices);
+	}
+}
@@ -0,0 +1,126 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "Vec2.h"
+#include "Vec4.h"
+#include <cstdint>
+#include <vector>
+
+class Texture;
+struct StaticBatch;
+struct TileMap;
+
+enum RenderLayer {
+	// Floor tiles never overlap, so they are only grouped by texture
+	LAYER_TILES,
+	// Roads and floor units, drawn in submission order
+	LAYER_FLOOR,
+	// Ground units and the shadows of flying units, sorted by y like the two layers below
+	LAYER_BOTTOM,
+	LAYER_STRUCTURE,
+	// Air units, explosions and health bars
+	LAYER_TOP,
+	// Overlays and GUI, drawn in submission order
+	LAYER_GUI,
+	LAYER_COUNT,
+};
+
+// Sorts sprites of the y sorted layers by the bottom edge of their quad
+const float DEPTH_BOTTOM_EDGE = -1e30f;
+
+enum class QueuedSpriteType : uint8_t {
+	Clip,
+	Rotated,
+	RadialProgress,
+	StaticBatch,
+	TileMap,
+};
+
+struct QueuedSprite {
+	Texture* texture;
+	// Top left corner, or the center of rotated sprites
+	Vec2 pos;
+	Vec2 size;
+	Vec2 clipPos;
+	Vec2 clipSize;
+	Vec4 color;
+	// Angle of rotated sprites, progress of radial indicators
+	float param;
+	QueuedSpriteType type;
+	bool mirror;
+	union {
+		const StaticBatch* batch;
+		const TileMap* tileMap;
+	};
+	// Rotated sprites with a shadow draw it this many pixels below them. The queue lists
+	// the shadow a second time in LAYER_BOTTOM, sorted by the bottom edge of the shadow.
+	float shadow;
+	bool hasShadow;
+};
+
+// Collects the sprites of a frame in one stream per layer, so sprites can be drawn
+// in any layer order and still come out in layer order. Each sprite gets a 32 bit
+// sort key and the layers that need it are radix sorted once before vertices are
+// generated. From high to low the key holds the screen y of the sprite's bottom
+// edge and the texture id.
+class RenderQueue {
+public:
+	void clear();
+	// depth is the screen y to sort by in the y sorted layers
+	void push(int layer, const QueuedSprite& sprite, float depth = DEPTH_BOTTOM_EDGE);
+	// Adds the sprites of an unsorted queue after the ones pushed so far, layer by layer
+	void append(const RenderQueue& other);
+	void sort();
+
+	size_t size() const { return sorted ? order.size() : sprites.size(); }
+	// In submission order until sorted, then layer by layer in key order
+	const QueuedSprite& operator[](size_t i) const { return sprites[sorted ? order[i] & ~SHADOW : i]; }
+	// Whether entry i of the sorted queue is the shadow of a sprite, not the sprite itself
+	bool isShadow(size_t i) const { return sorted && (order[i] & SHADOW); }
+
+private:
+	struct Layer {
+		std::vector<uint32_t> keys;
+		std::vector<uint32_t> indices;
+	};
+
+	// Marks the shadow entries in the per layer sprite indices
+	static const uint32_t SHADOW = 0x80000000u;
+
+	static uint32_t depthKey(float depth);
+	uint32_t textureId(const Texture* texture);
+	void add(int layer, uint32_t key, uint32_t index);
+	void sortLayer(Layer& layer);
+
+private:
+	std::vector<QueuedSprite> sprites;
+	Layer layers[LAYER_COUNT];
+	bool sorted{ false };
+	std::vector<uint32_t> order;
+	std::vector<uint32_t> sortedKeys;
+	std::vector<uint32_t> sortedIndices;
+	std::vector<const Texture*> textures;
+};
@@ -0,0 +1,261 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Replay.h"
+#include "sys.h"
+#include <algorithm>
+#include <cstdint>
+
+static const char replayMagic[4]{ 'O', 'L', 'C', 'R' };
+static const uint32_t replayVersion = 1;
+static const std::streamoff tickCountOffset = 16;
+
+enum TickFlags : uint8_t {
+	TICK_MOUSE = 1,
+	TICK_SIZE = 2,
+	TICK_EVENTS = 4,
+};
+
+template<typename T> static void write(std::fstream& file, const T& value) {
+	file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T> static T read(std::fstream& file) {
+	T value{};
+	file.read(reinterpret_cast<char*>(&value), sizeof(T));
+	return value;
+}
+
+Replay::~Replay() {
+	stop();
+}
+
+bool Replay::startRecording(const char* filename, unsigned int seed, int width, int height) {
+	stop();
+	file.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.good()) {
+		log_error("Could not open replay file %s for writing.", filename);
+		return false;
+	}
+
+	seed_ = seed;
+	width_ = lastSizeX = width;
+	height_ = lastSizeY = height;
+	tickCount_ = 0;
+	currentTick_ = 0;
+
+	file.write(replayMagic, 4);
+	write(file, replayVersion);
+	write(file, uint32_t(seed_));
+	write(file, int32_t(width_));
+	write(file, int32_t(height_));
+	write(file, int32_t(0)); // tick count, patched in stop()
+
+	recording = true;
+	log("Recording replay to %s (seed %u).", filename, seed_);
+	return true;
+}
+
+bool Replay::startPlayback(const char* filename) {
+	stop();
+	file.open(filename, std::ios::in | std::ios::binary);
+	if (!file.good()) {
+		log_error("Could not open replay file %s for reading.", filename);
+		return false;
+	}
+
+	char magic[4];
+	file.read(magic, 4);
+	if (!file.good() || memcmp(magic, replayMagic, 4) != 0) {
+		log_error("%s is not a replay file.", filename);
+		file.close();
+		return false;
+	}
+	auto version = read<uint32_t>(file);
+	if (version != replayVersion) {
+		log_error("Unsupported replay version %u in %s.", version, filename);
+		file.close();
+		return false;
+	}
+
+	seed_ = read<uint32_t>(file);
+	width_ = sizeX = read<int32_t>(file);
+	height_ = sizeY = read<int32_t>(file);
+	tickCount_ = read<int32_t>(file);
+	currentTick_ = 0;
+	mouseX = mouseY = 0;
+	mouseButtons = 0;
+
+	playing = true;
+	log("Playing replay %s (seed %u, %d ticks).", filename, seed_, tickCount_);
+	return true;
+}
+
+void Replay::stop() {
+	if (recording) {
+		file.seekp(tickCountOffset);
+		write(file, int32_t(tickCount_));
+		log("Recorded %d ticks.", tickCount_);
+	}
+	if (file.is_open()) file.close();
+	recording = false;
+	playing = false;
+	events_.clear();
+}
+
+void Replay::recordEvent(const SDL_Event& event) {
+	if (!recording) return;
+	switch (event.type) {
+	case SDL_QUIT:
+	case SDL_KEYDOWN:
+	case SDL_KEYUP:
+		events_.push_back(event);
+		break;
+	}
+}
+
+void Replay::recordTimer(float deltaTime, double elapsedTime) {
+	dt = deltaTime;
+	time = elapsedTime;
+}
+
+void Replay::recordMouse(int x, int y, unsigned int buttons) {
+	mouseX = x;
+	mouseY = y;
+	mouseButtons = buttons;
+}
+
+void Replay::recordSize(int width, int height) {
+	sizeX = width;
+	sizeY = height;
+}
+
+void Replay::endTick() {
+	if (!recording) return;
+
+	uint8_t flags = 0;
+	if (mouseX != lastMouseX || mouseY != lastMouseY || mouseButtons != lastMouseButtons) flags |= TICK_MOUSE;
+	if (sizeX != lastSizeX || sizeY != lastSizeY) flags |= TICK_SIZE;
+	if (!events_.empty()) flags |= TICK_EVENTS;
+
+	write(file, flags);
+	write(file, dt);
+	write(file, time);
+	if (flags & TICK_MOUSE) {
+		write(file, int16_t(mouseX));
+		write(file, int16_t(mouseY));
+		write(file, uint8_t(mouseButtons));
+		lastMouseX = mouseX;
+		lastMouseY = mouseY;
+		lastMouseButtons = mouseButtons;
+	}
+	if (flags & TICK_SIZE) {
+		write(file, int16_t(sizeX));
+		write(file, int16_t(sizeY));
+		lastSizeX = sizeX;
+		lastSizeY = sizeY;
+	}
+	if (flags & TICK_EVENTS) {
+		write(file, uint16_t(events_.size()));
+		for (auto& event : events_) {
+			write(file, uint32_t(event.type));
+			write(file, int32_t(event.type == SDL_QUIT ? 0 : event.key.keysym.sym));
+		}
+	}
+
+	events_.clear();
+	tickCount_++;
+}
+
+bool Replay::nextTick() {
+	if (!playing) return false;
+	events_.clear();
+	if (currentTick_ >= tickCount_) return false;
+
+	auto flags = read<uint8_t>(file);
+	dt = read<float>(file);
+	time = read<double>(file);
+	if (flags & TICK_MOUSE) {
+		mouseX = read<int16_t>(file);
+		mouseY = read<int16_t>(file);
+		mouseButtons = read<uint8_t>(file);
+	}
+	if (flags & TICK_SIZE) {
+		sizeX = read<int16_t>(file);
+		sizeY = read<int16_t>(file);
+	}
+	if (flags & TICK_EVENTS) {
+		int count = read<uint16_t>(file);
+		for (int i = 0; i < count; i++) {
+			SDL_Event event{};
+			event.type = read<uint32_t>(file);
+			auto sym = read<int32_t>(file);
+			if (event.type != SDL_QUIT) event.key.keysym.sym = sym;
+			events_.push_back(event);
+		}
+	}
+
+	if (!file.good()) {
+		log_error("Unexpected end of replay at tick %d.", currentTick_);
+		return false;
+	}
+
+	width_ = sizeX;
+	height_ = sizeY;
+	currentTick_++;
+	return true;
+}
+
+unsigned int Replay::mouseState(int* x, int* y) const {
+	*x = mouseX;
+	*y = mouseY;
+	return mouseButtons;
+}
+
+void Replay::reportTimings(const char* filename) const {
+	if (frameTimes.empty()) return;
+
+	auto sorted = frameTimes;
+	std::sort(sorted.begin(), sorted.end());
+	double total = 0;
+	for (auto t : sorted) total += t;
+	log("Replay timings: %d ticks, avg %.3f ms, p50 %.3f ms, p99 %.3f ms, max %.3f ms, total %.3f s",
+		int(sorted.size()),
+		total / sorted.size() * 1000,
+		sorted[sorted.size() / 2] * 1000,
+		sorted[sorted.size() * 99 / 100] * 1000,
+		sorted.back() * 1000,
+		total);
+
+	if (!filename) return;
+	std::ofstream out(filename);
+	if (!out.good()) {
+		log_error("Could not open timings file %s for writing.", filename);
+		return;
+	}
+	out << "tick,ms\n";
+	for (size_t i = 0; i < frameTimes.size(); i++) {
+		out << i << "," << frameTimes[i] * 1000 << "\n";
+	}
+}
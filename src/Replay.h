@@ -0,0 +1,94 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <fstream>
+#include <vector>
+
+// Records everything the simulation reads from the outside world (events, mouse,
+// timer and window size) so a session can be played back tick by tick.
+class Replay {
+public:
+	~Replay();
+
+	bool startRecording(const char* filename, unsigned int seed, int width, int height);
+	bool startPlayback(const char* filename);
+	void stop();
+
+	bool isRecording() const { return recording; }
+	bool isPlaying() const { return playing; }
+	unsigned int seed() const { return seed_; }
+	int width() const { return width_; }
+	int height() const { return height_; }
+	int tickCount() const { return tickCount_; }
+	int currentTick() const { return currentTick_; }
+
+	// Recording
+	void recordEvent(const SDL_Event& event);
+	void recordTimer(float dt, double time);
+	void recordMouse(int x, int y, unsigned int buttons);
+	void recordSize(int width, int height);
+	void endTick();
+
+	// Playback
+	bool nextTick();
+	const std::vector<SDL_Event>& events() const { return events_; }
+	float deltaTime() const { return dt; }
+	double elapsedTime() const { return time; }
+	unsigned int mouseState(int* x, int* y) const;
+
+	// Frame timings measured during playback
+	void addFrameTime(float seconds) { frameTimes.push_back(seconds); }
+	void reportTimings(const char* filename) const;
+
+private:
+	std::fstream file;
+	bool recording{ false };
+	bool playing{ false };
+	unsigned int seed_{ 0 };
+	int width_{ 0 };
+	int height_{ 0 };
+	int tickCount_{ 0 };
+	int currentTick_{ 0 };
+
+	std::vector<SDL_Event> events_;
+	float dt{ 0 };
+	double time{ 0 };
+	int mouseX{ 0 };
+	int mouseY{ 0 };
+	unsigned int mouseButtons{ 0 };
+	int sizeX{ 0 };
+	int sizeY{ 0 };
+
+	// Last written values, only changes are stored
+	int lastMouseX{ -1 };
+	int lastMouseY{ -1 };
+	unsigned int lastMouseButtons{ 0 };
+	int lastSizeX{ 0 };
+	int lastSizeY{ 0 };
+
+	std::vector<float> frameTimes;
+};
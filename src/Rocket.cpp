@@ -23,7 +23,7 @@ SOFTWARE.
 */
 
 #include "Rocket.h"
-#include "globals.h"
+#include "Snapshot.h"
 #include "Gfx.h"
 #include "Game.h"
 #include "utils.h"
@@ -46,14 +46,47 @@ void Rocket::update(float dt, Game& game, Sfx& sfx) {
 	}
 }
 
-void Rocket::draw_top(Gfx& gfx) {
+void Rocket::draw(Gfx& gfx, const Vec2& camera) {
+	gfx.setLayer(LAYER_TOP);
 	auto distance = target - pos;
 	auto vel = distance.normalized() * speed;
-	gfx.drawRotatedSprite(sprite, pos - floor(cameraPosition) + Vec2(0, -height), atan2(vel.y, vel.x));
+	gfx.drawShadowedSprite(sprite, pos - camera, atan2(vel.y, vel.x), height);
 }
 
-void Rocket::draw_bottom(Gfx& gfx) {
-	auto distance = target - pos;
-	auto vel = distance.normalized() * speed;
-	gfx.drawRotatedSprite(sprite, pos - floor(cameraPosition), atan2(vel.y, vel.x), Vec4(0, 0, 0, 0.5));
+void Rocket::hash(StateHash& hash) const {
+	Unit::hash(hash);
+	hash.add(target);
+	hash.add(speed);
+	hash.add(height);
+	hash.add(faction);
+}
+
+void Rocket::write(SnapshotWriter& writer) const {
+	Unit::write(writer);
+	writer.write(target);
+	writer.write(speed);
+	writer.write(height);
+	writer.write(faction);
+}
+
+void Rocket::read(SnapshotReader& reader) {
+	Unit::read(reader);
+	reader.read(target);
+	reader.read(speed);
+	reader.read(height);
+	reader.read(faction);
+}
+
+void Rocket::writeView(ViewWriter& writer) const {
+	Unit::writeView(writer);
+	writer.writePosition(target);
+	writer.writeFixed(speed, 1);
+	writer.writeUnorm(height, 32);
+}
+
+void Rocket::readView(ViewReader& reader) {
+	Unit::readView(reader);
+	reader.readPosition(target);
+	reader.readFixed(speed, 1);
+	reader.readUnorm(height, 32);
 }
@@ -31,8 +31,13 @@ class Rocket: public Unit {
 public:
 	Rocket(const Vec2& pos, const Vec2& target, float speed, Faction faction): Unit(pos, 0), target(target), speed(speed), faction(faction) {}
 	virtual void update(float dt, Game& game, Sfx& sfx) override;
-	virtual void draw_top(Gfx& gfx) override;
-	virtual void draw_bottom(Gfx& gfx) override;
+	virtual void draw(Gfx& gfx, const Vec2& camera) override;
+	virtual UnitType type() const override { return UnitType::Rocket; }
+	virtual void hash(StateHash& hash) const override;
+	virtual void write(SnapshotWriter& writer) const override;
+	virtual void read(SnapshotReader& reader) override;
+	virtual void writeView(ViewWriter& writer) const override;
+	virtual void readView(ViewReader& reader) override;
 
 public:
 	static Sprite sprite;
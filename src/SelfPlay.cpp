@@ -0,0 +1,269 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "SelfPlay.h"
+#include "sys.h"
+#include "Game.h"
+#include "Gfx.h"
+#include "Sfx.h"
+#include "Timer.h"
+#include "BuildInfo.h"
+#include "Random.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+// Orders buildings at random with per seed preferences and places them in
+// rings around the main compute core, walls on the outside.
+class BuildPolicy {
+public:
+	BuildPolicy(unsigned int seed) : random(seed) {
+		weights[BUILD_WALL] = random.range(1, 4);
+		weights[BUILD_FLOOR] = 0;
+		weights[BUILD_COMPUTE_CORE] = random.range(0.5f, 2);
+		weights[BUILD_SILICON_REFINERY] = random.range(1, 3);
+		weights[BUILD_DRONE_DEPLOYER] = random.range(0.5f, 2);
+		weights[BUILD_REPAIR_DRONE_DEPLOYER] = random.range(0, 1);
+	}
+
+	void update(Game& game) {
+		// Same as clicking "Become Conscious"
+		if (game.splash == 1) game.splash = 0.999f;
+
+		// Decisions are cheap but there is no need to make them every tick
+		if (game.timer.elapsedTime() < nextDecision) return;
+		nextDecision = game.timer.elapsedTime() + 0.5;
+
+		bool needFloor = false;
+		bool busy = false;
+		for (int i = 0; i < BUILD_COUNT; i++) {
+			auto info = game.buildInfos[i];
+			if (info->readyCount > 0 && !place(game, *info, i == BUILD_WALL ? 4 : 1)) {
+				needFloor = i != BUILD_FLOOR;
+			}
+			if (info->inProgressCount > 0) busy = true;
+		}
+
+		if (needFloor && game.buildInfos[BUILD_FLOOR]->inProgressCount == 0) {
+			game.orderBuild(*game.buildInfos[BUILD_FLOOR]);
+			return;
+		}
+		if (busy) return;
+
+		float total = 0;
+		for (int i = 0; i < BUILD_COUNT; i++) {
+			if (game.silicon >= game.buildInfos[i]->siliconToBuild) total += weights[i];
+		}
+		if (total <= 0) return;
+
+		float pick = random.range(0, total);
+		for (int i = 0; i < BUILD_COUNT; i++) {
+			if (game.silicon < game.buildInfos[i]->siliconToBuild) continue;
+			pick -= weights[i];
+			if (pick <= 0) {
+				game.orderBuild(*game.buildInfos[i]);
+				return;
+			}
+		}
+	}
+
+private:
+	bool place(Game& game, BuildInfo& info, int minRing) {
+		int cx = int(game.mainCPUPosition.x) / 32;
+		int cy = int(game.mainCPUPosition.y) / 32;
+		for (int ring = minRing; ring <= 12; ring++) {
+			for (int y = cy - ring; y <= cy + ring; y++) {
+				for (int x = cx - ring; x <= cx + ring; x++) {
+					if (std::max(std::abs(x - cx), std::abs(y - cy)) != ring) continue;
+					if (!info.canPlace(x, y, game)) continue;
+					info.place(x, y, game, game.sfx);
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+private:
+	Random random;
+	float weights[BUILD_COUNT];
+	double nextDecision{ 0 };
+};
+
+static void countUnits(const Game& game, int& structures, int& soldiers) {
+	structures = 0;
+	soldiers = 0;
+	for (auto unit : game.getUnits()) {
+		if (!unit->isAlive()) continue;
+		if (unit->isPlayerStructure()) structures++;
+		if (unit->isSoldier()) soldiers++;
+	}
+}
+
+SelfPlayResult playGame(unsigned int seed, const SelfPlayOptions& options) {
+	auto start = std::chrono::steady_clock::now();
+
+	SelfPlayResult result;
+	result.seed = seed;
+
+	Timer timer;
+	Gfx gfx("", 1280, 800, false, true);
+	Sfx sfx(true);
+	Game game(gfx, sfx, timer);
+	BuildPolicy policy(seed);
+	game.start(seed);
+
+	double time = 0;
+	while (game.gameOver == 0 && time < options.maxGameTime) {
+		time += options.tickTime;
+		timer.set(options.tickTime, time);
+		{
+			// Placing buildings runs unit constructors that draw from the game's generator
+			Random::Use use(game.random);
+			policy.update(game);
+		}
+
+		int structuresBefore, soldiers;
+		countUnits(game, structuresBefore, soldiers);
+		game.update();
+		result.ticks++;
+
+		int structuresAfter;
+		countUnits(game, structuresAfter, soldiers);
+
+		if (game.nextWaveLevel > int(result.waves.size())) {
+			if (!result.waves.empty()) result.waves.back().survived = true;
+			WaveResult wave;
+			wave.wave = game.nextWaveLevel;
+			wave.startTime = time;
+			wave.silicon = game.silicon;
+			wave.computingPower = game.computingPower;
+			wave.structures = structuresAfter;
+			result.waves.push_back(wave);
+		}
+		if (!result.waves.empty()) {
+			auto& wave = result.waves.back();
+			wave.structuresLost += std::max(0, structuresBefore - structuresAfter);
+			wave.peakSoldiers = std::max(wave.peakSoldiers, soldiers);
+		}
+	}
+
+	// A wave counts as survived once it is over and the game is still running
+	result.gameOver = game.gameOver > 0;
+	if (!result.waves.empty() && !result.gameOver && time >= game.waveEnd) {
+		result.waves.back().survived = true;
+	}
+	result.gameTime = time;
+	result.wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return result;
+}
+
+static void report(FILE* out, const std::vector<SelfPlayResult>& results, int threadCount, double wallTime) {
+	long long ticks = 0;
+	double gameTime = 0;
+	int maxWave = 0;
+	std::vector<double> lengths;
+	for (auto& result : results) {
+		ticks += result.ticks;
+		gameTime += result.gameTime;
+		lengths.push_back(result.gameTime);
+		maxWave = std::max(maxWave, int(result.waves.size()));
+	}
+	std::sort(lengths.begin(), lengths.end());
+
+	fprintf(out, "Played %d games on %d threads in %.1f s (%.0f games per hour, %.0f ticks per second)\n",
+		int(results.size()), threadCount, wallTime, results.size() * 3600 / wallTime, ticks / wallTime);
+	fprintf(out, "Game length: avg %.0f s, median %.0f s, max %.0f s\n",
+		gameTime / results.size(), lengths[lengths.size() / 2], lengths.back());
+	fprintf(out, "%5s %8s %8s %8s %10s %10s %10s %8s %8s\n", "wave", "reached", "survived", "rate", "silicon", "gflops", "structures", "lost", "soldiers");
+
+	for (int w = 0; w < maxWave; w++) {
+		int reached = 0;
+		int survived = 0;
+		double silicon = 0, gflops = 0, structures = 0, lost = 0, soldiers = 0;
+		for (auto& result : results) {
+			if (w >= int(result.waves.size())) continue;
+			auto& wave = result.waves[w];
+			reached++;
+			if (wave.survived) survived++;
+			silicon += wave.silicon;
+			gflops += wave.computingPower;
+			structures += wave.structures;
+			lost += wave.structuresLost;
+			soldiers += wave.peakSoldiers;
+		}
+		fprintf(out, "%5d %8d %8d %7.0f%% %10.0f %10.0f %10.1f %8.1f %8.1f\n", w + 1, reached, survived, 100.0 * survived / reached,
+			silicon / reached, gflops / reached, structures / reached, lost / reached, soldiers / reached);
+	}
+}
+
+int runSelfPlay(const SelfPlayOptions& options) {
+	if (options.games <= 0) return 1;
+
+	int threadCount = options.threads > 0 ? options.threads : int(std::thread::hardware_concurrency());
+	if (threadCount <= 0) threadCount = 1;
+	threadCount = std::min(threadCount, options.games);
+
+	std::vector<SelfPlayResult> results(options.games);
+	std::atomic<int> nextGame{ 0 };
+	auto worker = [&]() {
+		int index;
+		while ((index = nextGame++) < options.games) {
+			results[index] = playGame(options.firstSeed + index, options);
+		}
+	};
+
+	log("Starting %d self-play games on %d threads.", options.games, threadCount);
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	for (int i = 0; i < threadCount; i++) {
+		threads.emplace_back(worker);
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	report(stdout, results, threadCount, wallTime);
+
+	// Per game and wave rows for further analysis
+	if (options.reportFile) {
+		FILE* file = fopen(options.reportFile, "w");
+		if (!file) {
+			log_error("Could not open report file %s.", options.reportFile);
+			return 1;
+		}
+		fprintf(file, "seed,wave,start,silicon,gflops,structures,lost,soldiers,survived,wall_ms\n");
+		for (auto& result : results) {
+			for (auto& wave : result.waves) {
+				fprintf(file, "%u,%d,%.2f,%.0f,%.0f,%d,%d,%d,%d,%.2f\n", result.seed, wave.wave, wave.startTime, wave.silicon, wave.computingPower,
+					wave.structures, wave.structuresLost, wave.peakSoldiers, wave.survived ? 1 : 0, result.wallTime * 1000);
+			}
+		}
+		fclose(file);
+	}
+	return 0;
+}
@@ -0,0 +1,62 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <vector>
+
+struct SelfPlayOptions {
+	int games{ 100 };
+	int threads{ 0 };
+	unsigned int firstSeed{ 1 };
+	double maxGameTime{ 3600 };
+	float tickTime{ 1.0f / 60 };
+	const char* reportFile{ nullptr };
+};
+
+struct WaveResult {
+	int wave{ 0 };
+	double startTime{ 0 };
+	float silicon{ 0 };
+	float computingPower{ 0 };
+	int structures{ 0 };
+	int structuresLost{ 0 };
+	int peakSoldiers{ 0 };
+	bool survived{ false };
+};
+
+struct SelfPlayResult {
+	unsigned int seed{ 0 };
+	int ticks{ 0 };
+	double gameTime{ 0 };
+	double wallTime{ 0 };
+	bool gameOver{ false };
+	std::vector<WaveResult> waves;
+};
+
+// Plays one game without window or audio, driven by a scripted build policy
+SelfPlayResult playGame(unsigned int seed, const SelfPlayOptions& options);
+
+// Plays many games on all cores and reports per wave outcomes and timing
+int runSelfPlay(const SelfPlayOptions& options);
@@ -0,0 +1,225 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Server.h"
+#include "Game.h"
+#include "BuildInfo.h"
+#include "Gfx.h"
+#include "Sfx.h"
+#include "Timer.h"
+#include "sys.h"
+#include "utils.h"
+#include <algorithm>
+#include <cstring>
+#include <SDL2/SDL.h>
+
+static const double clientTimeout = 5;
+static const size_t maxSentSnapshots = 32;
+
+bool Server::open(int port) {
+	if (!socket.open(port)) return false;
+	log("Server listening on port %d.", port);
+	return true;
+}
+
+void Server::receive(Game& game) {
+	Random::Use use(game.random);
+	double now = game.timer.elapsedTime();
+	char buffer[1500];
+	NetAddress from;
+	int size;
+	while ((size = socket.receive(buffer, sizeof(buffer), from)) >= 0) {
+		ClientPacket packet;
+		if (size < int(sizeof(packet))) continue;
+		memcpy(&packet, buffer, sizeof(packet));
+		if (memcmp(packet.magic, clientMagic, 4) != 0 || packet.commandCount > maxCommandsPerPacket) continue;
+		if (size < int(sizeof(packet) + packet.commandCount * sizeof(Command))) continue;
+
+		auto client = std::find_if(clients.begin(), clients.end(), [&](const Connection& c) { return c.address == from; });
+		if (client == clients.end()) {
+			if (int(clients.size()) >= maxClients) continue;
+			Connection connection;
+			connection.address = from;
+			connection.player = nextPlayer++;
+			clients.push_back(connection);
+			client = clients.end() - 1;
+			log("Client %d connected.", client->player);
+		}
+
+		client->lastHeard = now;
+		client->ack = std::max(client->ack, packet.ack);
+		client->tileAck = std::max(client->tileAck, std::min(packet.tileAck, uint32_t(tileChanges.size())));
+		client->camera = Vec2(packet.cameraX, packet.cameraY);
+		client->viewSize = Vec2(std::max<int16_t>(packet.viewWidth, 0), std::max<int16_t>(packet.viewHeight, 0));
+
+		// Every packet repeats the commands we have not confirmed yet
+		for (uint32_t i = 0; i < packet.commandCount; i++) {
+			if (packet.firstCommand + i != client->commandsExecuted) continue;
+			Command command;
+			memcpy(&command, buffer + sizeof(packet) + i * sizeof(Command), sizeof(command));
+			command.player = uint8_t(client->player);
+			game.execute(command);
+			client->commandsExecuted++;
+		}
+	}
+
+	for (auto& client : clients) {
+		if (now - client.lastHeard > clientTimeout) log("Client %d timed out.", client.player);
+	}
+	clients.erase(std::remove_if(clients.begin(), clients.end(), [&](const Connection& c) { return now - c.lastHeard > clientTimeout; }), clients.end());
+}
+
+void Server::send(Game& game) {
+	trackTiles(game.level);
+	sequence++;
+	for (auto& client : clients) {
+		captureViews(game, client);
+		sendTo(game, client);
+	}
+}
+
+void Server::trackTiles(const Level& level) {
+	// Tiles only change when something is built or the game restarts
+	if (!knownTiles.empty() && level.hash() == knownTilesHash) return;
+	bool first = knownTiles.empty();
+	knownTiles.resize(level.width() * level.height());
+	for (int y = 0; y < level.height(); y++) {
+		for (int x = 0; x < level.width(); x++) {
+			int tile = level.getTile(x, y);
+			int& known = knownTiles[y * level.width() + x];
+			if (!first && known != tile) tileChanges.push_back({ uint16_t(x), uint16_t(y), int16_t(tile) });
+			known = tile;
+		}
+	}
+	knownTilesHash = level.hash();
+}
+
+void Server::captureViews(Game& game, Connection& client) {
+	int minx = int(floor((client.camera.x - viewMargin) / 32));
+	int miny = int(floor((client.camera.y - viewMargin) / 32));
+	int maxx = int(floor((client.camera.x + client.viewSize.x + viewMargin) / 32));
+	int maxy = int(floor((client.camera.y + client.viewSize.y + viewMargin) / 32));
+	minx = std::max(minx, 0);
+	miny = std::max(miny, 0);
+	maxx = std::min(maxx, game.level.width() - 1);
+	maxy = std::min(maxy, game.level.height() - 1);
+
+	client.current.clear();
+	for (int y = miny; y <= maxy; y++) {
+		for (int x = minx; x <= maxx; x++) {
+			for (auto unit : game.level.getUnits(x, y)) {
+				if (!unit->isAlive()) continue;
+				if (!unit->netId) unit->netId = nextNetId++;
+				client.current.push_back(captureView(unit->netId, *unit));
+			}
+		}
+	}
+	std::sort(client.current.begin(), client.current.end(), [](const UnitView& a, const UnitView& b) { return a.id < b.id; });
+}
+
+void Server::sendTo(Game& game, Connection& client) {
+	char buffer[maxPacketSize];
+	PacketWriter out(buffer, sizeof(buffer));
+
+	// Deltas go against the newest snapshot the client confirmed
+	static const ViewSet noViews;
+	auto baseline = client.sent.find(client.ack);
+	const ViewSet& baselineViews = baseline != client.sent.end() ? baseline->second : noViews;
+
+	uint32_t tileEnd = std::min(uint32_t(tileChanges.size()), client.tileAck + maxTileChanges);
+	ServerPacket packet;
+	memcpy(packet.magic, serverMagic, 4);
+	packet.sequence = sequence;
+	packet.baseline = baseline != client.sent.end() ? client.ack : 0;
+	packet.commandAck = client.commandsExecuted;
+	packet.firstTile = client.tileAck;
+	packet.tileCount = uint16_t(tileEnd - client.tileAck);
+	packet.splash = uint8_t(game.splash * 255);
+	packet.gameOver = uint8_t(game.gameOver * 255);
+	packet.time = float(game.timer.elapsedTime());
+	packet.computingPower = game.computingPower;
+	packet.silicon = game.silicon;
+	out.write(packet);
+
+	for (auto info : game.buildInfos) {
+		BuildState state;
+		state.ready = uint8_t(std::min(info->readyCount, 255));
+		state.inProgress = uint8_t(std::min(info->inProgressCount, 255));
+		state.progress = uint8_t(info->opsToBuild > 0 ? clamp(info->buildOpsRemaining / info->opsToBuild, 0, 1) * 255 : 0);
+		out.write(state);
+	}
+	for (uint32_t i = client.tileAck; i < tileEnd; i++) {
+		out.write(tileChanges[i]);
+	}
+
+	ViewSet sent;
+	writeViewDelta(out, baselineViews, client.current, client.cursor, sent);
+	client.sent[sequence] = std::move(sent);
+
+	// Older snapshots will never be a baseline again
+	while (!client.sent.empty() && (client.sent.begin()->first < client.ack || client.sent.size() > maxSentSnapshots)) {
+		client.sent.erase(client.sent.begin());
+	}
+
+	socket.send(client.address, buffer, out.size);
+	client.bytesSent += out.size;
+	client.lastPacketSize = out.size;
+}
+
+int runServer(int port, unsigned int seed) {
+	Timer timer;
+	Gfx gfx("", 1280, 800, false, true);
+	Sfx sfx(true);
+	Game game(gfx, sfx, timer);
+	Server server;
+	if (!server.open(port)) return 1;
+	game.start(seed);
+
+	const float tickTime = 1.0f / 60;
+	float accumulated = 0;
+	uint32_t tick = 0;
+	Timer clock;
+	SDL_Event event;
+	while (game.shouldKeepRunning()) {
+		while (SDL_PollEvent(&event)) {
+			if (event.type == SDL_QUIT) game.keepRunning = false;
+		}
+		clock.lap();
+		accumulated = std::min(accumulated + clock.deltaTime(), 0.25f);
+		while (accumulated >= tickTime) {
+			accumulated -= tickTime;
+			tick++;
+			timer.set(tickTime, tick * double(tickTime));
+			server.receive(game);
+			game.update();
+			if (tick % Server::ticksPerSnapshot == 0) server.send(game);
+		}
+		SDL_Delay(1);
+	}
+
+	if (clock.elapsedTime() > 0) {
+		log("Server sent %.0f and received %.0f bytes per second.", server.bytesSent() / clock.elapsedTime(), server.bytesReceived() / clock.elapsedTime());
+	}
+	return 0;
+}
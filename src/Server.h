@@ -0,0 +1,136 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "Socket.h"
+#include "NetView.h"
+#include "Lockstep.h"
+#include <map>
+#include <vector>
+
+class Game;
+class Level;
+
+static const char serverMagic[4]{ 'O', 'L', 'C', 'V' };
+static const char clientMagic[4]{ 'O', 'L', 'C', 'I' };
+
+struct ServerPacket {
+	char magic[4];
+	uint32_t sequence;
+	uint32_t baseline;		// Sequence the unit views are relative to, 0 for none
+	uint32_t commandAck;	// Number of client commands executed so far
+	uint32_t firstTile;		// Index of the first tile change that follows
+	uint16_t tileCount;
+	uint8_t splash;
+	uint8_t gameOver;
+	float time;
+	float computingPower;
+	float silicon;
+	// Followed by build states, tile changes and unit views
+};
+
+struct ClientPacket {
+	char magic[4];
+	uint32_t ack;			// Latest snapshot the client has
+	uint32_t tileAck;		// Number of tile changes the client has applied
+	uint32_t firstCommand;
+	int16_t cameraX;
+	int16_t cameraY;
+	int16_t viewWidth;
+	int16_t viewHeight;
+	uint8_t commandCount;
+	uint8_t reserved[3];
+	// Followed by the commands the server has not acknowledged yet
+};
+
+struct BuildState {
+	uint8_t ready;
+	uint8_t inProgress;
+	uint8_t progress;
+};
+
+struct TileChange {
+	uint16_t x;
+	uint16_t y;
+	int16_t tile;
+};
+
+// Authoritative server for thin clients. Clients send commands and their
+// camera, the server answers with the units in view, delta compressed against
+// the last snapshot the client acknowledged and capped at one datagram.
+class Server {
+public:
+	static const int maxClients = 8;
+	static const int maxPacketSize = 1200;
+	static const int maxTileChanges = 64;
+	static const int maxCommandsPerPacket = 16;
+	static const int viewMargin = 64;
+	static const int ticksPerSnapshot = 3;
+
+	struct Connection {
+		NetAddress address;
+		int player;
+		double lastHeard;
+		uint32_t ack{ 0 };
+		uint32_t tileAck{ 0 };
+		uint32_t commandsExecuted{ 0 };
+		Vec2 camera;
+		Vec2 viewSize{ 640, 400 };
+		uint32_t cursor{ 0 };
+		std::map<uint32_t, ViewSet> sent;
+		ViewSet current;
+		uint64_t bytesSent{ 0 };
+		size_t lastPacketSize{ 0 };
+	};
+
+	bool open(int port);
+	// Executes client commands, call before Game::update
+	void receive(Game& game);
+	// Sends a snapshot to every client, call after Game::update
+	void send(Game& game);
+
+	const std::vector<Connection>& connections() const { return clients; }
+	uint64_t bytesSent() const { return socket.bytesSent; }
+	uint64_t bytesReceived() const { return socket.bytesReceived; }
+
+private:
+	void trackTiles(const Level& level);
+	void captureViews(Game& game, Connection& client);
+	void sendTo(Game& game, Connection& client);
+
+private:
+	UdpSocket socket;
+	std::vector<Connection> clients;
+	uint32_t sequence{ 0 };
+	uint32_t nextNetId{ 1 };
+	int nextPlayer{ 0 };
+
+	std::vector<int> knownTiles;
+	uint64_t knownTilesHash{ 0 };
+	std::vector<TileChange> tileChanges;
+};
+
+// Runs a game without window or audio at 60 ticks per second and serves it on port
+int runServer(int port, unsigned int seed);
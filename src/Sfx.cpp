@@ -28,7 +28,9 @@ SOFTWARE.
 #include "AudioTrack.h"
 #include <SDL2/SDL.h>
 
-Sfx::Sfx() {
+Sfx::Sfx(bool headless): headless(headless) {
+	if (headless) return;
+
 	const char* deviceName = nullptr;
 	SDL_AudioSpec desired{};
 	desired.callback = audioCallback;
@@ -46,11 +48,14 @@ Sfx::Sfx() {
 }
 
 Sfx::~Sfx() {
+	if (headless) return;
 	SDL_PauseAudioDevice(device, 1);
 	SDL_CloseAudioDevice(device);
 }
 
 AudioClip* Sfx::getAudioClip(const char* filename, int maxRef) {
+	if (headless) return nullptr;
+
 	auto it = audioClips.find(filename);
 	if (it != audioClips.end()) return it->second;
 
@@ -60,6 +65,8 @@ AudioClip* Sfx::getAudioClip(const char* filename, int maxRef) {
 }
 
 AudioTrack* Sfx::play(AudioSource* clip, float volume, float pan, float pitch, bool loop) {
+	if (headless) return &silentTrack;
+
 	SDL_LockAudioDevice(device);
 	
 	AudioTrack* track = nullptr;
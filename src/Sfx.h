@@ -28,14 +28,14 @@ SOFTWARE.
 #include <map>
 #include <string>
 #include <vector>
+#include "AudioTrack.h"
 
 class AudioSource;
 class AudioClip;
-class AudioTrack;
 
 class Sfx {
 public:
-	Sfx();
+	Sfx(bool headless = false);
 	~Sfx();
 
 	AudioClip* getAudioClip(const char* filename, int maxRef = -1);
@@ -50,4 +50,6 @@ private:
 	std::map<std::string, AudioClip*> audioClips;
 	SDL_AudioDeviceID device{ 0 };
 	SDL_AudioSpec spec{};
+	bool headless{ false };
+	AudioTrack silentTrack{ nullptr, 0, 0, 1, false };
 };
@@ -104,7 +104,8 @@ Shader::Shader(const char* vsfile, const char* fsfile) {
 		int size;
 		GLenum type;
 		glGetActiveUniform(program, (GLuint)i, 256, &length, &size, &type, uniformName);
-		uniformLocations[uniformName] = i;
+		// Locations are not the same as active uniform indices
+		uniformLocations[uniformName] = glGetUniformLocation(program, uniformName);
 	}
 }
 
@@ -146,6 +147,12 @@ void Shader::uniform(const char* name, const Vec4& v) {
 	glUniform4fv(location, 1, &v.x);
 }
 
+void Shader::uniform(const char* name, const Vec2* values, int count) {
+	auto location = getUniformLocation(name);
+	if (location < 0) return;
+	glUniform2fv(location, count, &values->x);
+}
+
 void Shader::texture(const char* name, const Texture& t) {
 	auto location = getUniformLocation(name);
 	if (location < 0) return;
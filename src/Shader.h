@@ -44,6 +44,8 @@ public:
 	void uniform(const char*, const Vec2&);
 	void uniform(const char*, const Vec3&);
 	void uniform(const char*, const Vec4&);
+	// Name the first element, like "clips[0]"
+	void uniform(const char*, const Vec2* values, int count);
 	void texture(const char*, const Texture&);
 
 private:
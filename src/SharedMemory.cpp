@@ -0,0 +1,116 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "SharedMemory.h"
+#include "sys.h"
+#include <new>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+SharedMemory::SharedMemory(const char* name, size_t size) : name(name) {
+	mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, DWORD(uint64_t(size) >> 32), DWORD(size), name);
+	if (!mapping) {
+		log_error("Could not create shared memory %s.", name);
+		return;
+	}
+
+	data_ = reinterpret_cast<char*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size));
+	if (!data_) {
+		log_error("Could not map shared memory %s.", name);
+		return;
+	}
+	size_ = size;
+}
+
+SharedMemory::~SharedMemory() {
+	if (data_) UnmapViewOfFile(data_);
+	if (mapping) CloseHandle(mapping);
+}
+#else
+SharedMemory::SharedMemory(const char* name, size_t size) : name(name[0] == '/' ? name : std::string("/") + name) {
+	fd = shm_open(this->name.c_str(), O_CREAT | O_RDWR, 0600);
+	if (fd < 0) {
+		log_error("Could not create shared memory %s.", name);
+		return;
+	}
+
+	if (ftruncate(fd, off_t(size)) != 0) {
+		log_error("Could not resize shared memory %s.", name);
+		return;
+	}
+
+	void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (address == MAP_FAILED) {
+		log_error("Could not map shared memory %s.", name);
+		return;
+	}
+	data_ = reinterpret_cast<char*>(address);
+	size_ = size;
+}
+
+SharedMemory::~SharedMemory() {
+	if (data_) munmap(data_, size_);
+	if (fd >= 0) {
+		close(fd);
+		shm_unlink(name.c_str());
+	}
+}
+#endif
+
+SharedRing::SharedRing(char* memory, uint32_t slotSize, uint32_t slotCount, bool initialize)
+	: header(reinterpret_cast<Header*>(memory)), slots(memory + sizeof(Header)), slotSize(slotSize), slotCount(slotCount) {
+	if (initialize) {
+		new (header) Header();
+		header->head.store(0, std::memory_order_relaxed);
+		header->tail.store(0, std::memory_order_relaxed);
+	}
+}
+
+void* SharedRing::beginWrite() {
+	auto head = header->head.load(std::memory_order_relaxed);
+	auto tail = header->tail.load(std::memory_order_acquire);
+	if (head - tail >= slotCount) return nullptr;
+	return slots + size_t(head % slotCount) * slotSize;
+}
+
+void SharedRing::endWrite() {
+	header->head.store(header->head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+const void* SharedRing::beginRead() {
+	auto tail = header->tail.load(std::memory_order_relaxed);
+	auto head = header->head.load(std::memory_order_acquire);
+	if (head == tail) return nullptr;
+	return slots + size_t(tail % slotCount) * slotSize;
+}
+
+void SharedRing::endRead() {
+	header->tail.store(header->tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
@@ -0,0 +1,85 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Named memory region shared with other processes
+class SharedMemory {
+public:
+	SharedMemory(const char* name, size_t size);
+	~SharedMemory();
+
+	bool isOpen() const { return data_ != nullptr; }
+	char* data() const { return data_; }
+	size_t size() const { return size_; }
+
+private:
+	char* data_{ nullptr };
+	size_t size_{ 0 };
+	std::string name;
+#ifdef _WIN32
+	void* mapping{ nullptr };
+#else
+	int fd{ -1 };
+#endif
+};
+
+// Lock-free single producer, single consumer queue of fixed size slots.
+// Only head and tail are shared, each is written by one side only.
+class SharedRing {
+public:
+	struct Header {
+		std::atomic<uint64_t> head;
+		char padding0[56];
+		std::atomic<uint64_t> tail;
+		char padding1[56];
+	};
+	static_assert(std::atomic<uint64_t>::is_always_lock_free, "Ring needs lock-free 64 bit atomics");
+
+	static size_t bytes(uint32_t slotSize, uint32_t slotCount) {
+		return sizeof(Header) + size_t(slotSize) * slotCount;
+	}
+
+	SharedRing() {}
+	SharedRing(char* memory, uint32_t slotSize, uint32_t slotCount, bool initialize);
+
+	// Returns nullptr while the ring is full
+	void* beginWrite();
+	void endWrite();
+
+	// Returns nullptr while the ring is empty
+	const void* beginRead();
+	void endRead();
+
+private:
+	Header* header{ nullptr };
+	char* slots{ nullptr };
+	uint32_t slotSize{ 0 };
+	uint32_t slotCount{ 0 };
+};
@@ -0,0 +1,108 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "SimThread.h"
+#include "Game.h"
+#include "Gfx.h"
+#include "Timer.h"
+#include "Replay.h"
+#include "StateHash.h"
+
+SimThread::SimThread(Game& game, Timer& timer, Replay* replay, ChecksumLog* checksums) :
+	game(game), timer(timer), replay(replay), checksums(checksums) {
+	game.deferTextureReload = true;
+	thread = std::thread(&SimThread::run, this);
+}
+
+SimThread::~SimThread() {
+	quit = true;
+	thread.join();
+	game.deferTextureReload = false;
+}
+
+void SimThread::handleEvent(const SDL_Event& event) {
+	std::lock_guard<std::mutex> lock(eventMutex);
+	events.push_back(event);
+}
+
+void SimThread::setMouseState(int x, int y, uint32_t buttons) {
+	std::lock_guard<std::mutex> lock(eventMutex);
+	mouseX = x;
+	mouseY = y;
+	mouseButtons = buttons;
+}
+
+bool SimThread::takeTextureReload() {
+	return game.texturesOutdated.exchange(false);
+}
+
+const RenderSnapshot* SimThread::next() {
+	return snapshots.update() ? &snapshots.front() : nullptr;
+}
+
+void SimThread::run() {
+	const uint64_t frequency = SDL_GetPerformanceFrequency();
+	const uint64_t tickLength = frequency / ticksPerSecond;
+	uint64_t nextTick = SDL_GetPerformanceCounter();
+	int tick = 0;
+	while (!quit && game.shouldKeepRunning()) {
+		{
+			std::lock_guard<std::mutex> lock(eventMutex);
+			tickEvents.swap(events);
+			game.setMouseState(mouseX, mouseY, mouseButtons);
+		}
+		for (auto& event : tickEvents) {
+			if (replay) replay->recordEvent(event);
+			game.handleEvent(event);
+		}
+		tickEvents.clear();
+
+		timer.lap();
+		if (replay) replay->recordTimer(timer.deltaTime(), timer.elapsedTime());
+		game.update();
+		if (checksums && checksums->isOpen()) checksums->write(tick, game.checksum());
+
+		auto& snapshot = snapshots.back();
+		snapshot.sprites.clear();
+		snapshot.tick = tick++;
+		Gfx::setThreadQueue(&snapshot.sprites);
+		game.drawFrame();
+		Gfx::setThreadQueue(nullptr);
+		snapshots.publish();
+		if (replay) {
+			replay->recordSize(game.gfx.width(), game.gfx.height());
+			replay->endTick();
+		}
+
+		// Sleep off the rest of the tick, a late tick starts the next one right away
+		nextTick += tickLength;
+		uint64_t now = SDL_GetPerformanceCounter();
+		if (now < nextTick) SDL_Delay(uint32_t((nextTick - now) * 1000 / frequency));
+		else nextTick = now;
+	}
+
+	// Soldiers come from a pool of this thread
+	game.clearUnits();
+	running = false;
+}
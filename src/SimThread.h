@@ -0,0 +1,87 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "RenderQueue.h"
+#include "TripleBuffer.h"
+#include <SDL2/SDL.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Game;
+class Timer;
+class Replay;
+class ChecksumLog;
+
+// Sprites of one Game::drawFrame, recorded on the simulation thread
+struct RenderSnapshot {
+	RenderQueue sprites;
+	int tick{ 0 };
+};
+
+// Runs Game::update and Game::drawFrame on a thread of their own at a fixed tick rate.
+// The sprites of every tick are published as a RenderSnapshot, the thread owning the
+// window draws the newest one each frame, so a slow tick repeats a frame instead of
+// delaying it. The game belongs to this thread while it runs.
+class SimThread {
+public:
+	static const int ticksPerSecond = 60;
+
+	// Replay and checksums are optional and recorded like in the main loop
+	SimThread(Game& game, Timer& timer, Replay* replay, ChecksumLog* checksums);
+	~SimThread();
+
+	bool isRunning() const { return running; }
+	// Events and the mouse state reach the game before its next tick, both come from
+	// the thread pumping SDL events
+	void handleEvent(const SDL_Event& event);
+	void setMouseState(int x, int y, uint32_t buttons);
+	// Whether the game asked for its textures to be reloaded since the last call, the
+	// thread owning the Gfx reloads them with Game::reloadTextures
+	bool takeTextureReload();
+	// Newest snapshot, nullptr if none was published since the last call
+	const RenderSnapshot* next();
+
+private:
+	void run();
+
+private:
+	Game& game;
+	Timer& timer;
+	Replay* replay;
+	ChecksumLog* checksums;
+	std::mutex eventMutex;
+	std::vector<SDL_Event> events;
+	std::vector<SDL_Event> tickEvents;
+	int mouseX{ 0 };
+	int mouseY{ 0 };
+	uint32_t mouseButtons{ 0 };
+	TripleBuffer<RenderSnapshot> snapshots;
+	std::atomic<bool> running{ true };
+	std::atomic<bool> quit{ false };
+	std::thread thread;
+};
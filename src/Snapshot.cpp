@@ -0,0 +1,196 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Snapshot.h"
+#include "Compress.h"
+#include "sys.h"
+#include "Unit.h"
+#include "Soldier.h"
+#include "Rocket.h"
+#include "Grenade.h"
+#include "Explosion.h"
+#include "Crater.h"
+#include "Drone.h"
+#include "Jet.h"
+#include "Wall.h"
+#include "ComputeCore.h"
+#include "SiliconRefinery.h"
+#include "DroneDeployer.h"
+#include <cstdio>
+#include <fstream>
+
+static const char snapshotMagic[4]{ 'O', 'L', 'C', 'S' };
+static const uint32_t snapshotVersion = 2;
+
+SnapshotWriter::SnapshotWriter(const std::vector<Unit*>& units) : units(units) {
+	for (size_t i = 0; i < units.size(); i++) {
+		units[i]->snapshotHandle = int(i);
+	}
+}
+
+void SnapshotWriter::writeRef(const Unit* unit) {
+	// Units that are no longer part of the game are written as null
+	int32_t handle = -1;
+	if (unit && unit->snapshotHandle >= 0 && unit->snapshotHandle < int(units.size()) && units[unit->snapshotHandle] == unit) {
+		handle = unit->snapshotHandle;
+	}
+	write(handle);
+}
+
+Unit* SnapshotReader::readRef() {
+	int32_t handle;
+	read(handle);
+	if (handle < 0 || handle >= int(units.size())) return nullptr;
+	return units[handle];
+}
+
+void Unit::write(SnapshotWriter& writer) const {
+	writer.write(pos);
+	writer.write(alive);
+	writer.write(health);
+	writer.write(maxHealth);
+}
+
+void Unit::read(SnapshotReader& reader) {
+	reader.read(pos);
+	reader.read(alive);
+	reader.read(health);
+	reader.read(maxHealth);
+}
+
+Unit* createUnit(UnitType type) {
+	switch (type) {
+	case UnitType::Soldier: return new Soldier(Vec2(0, 0));
+	case UnitType::Rocket: return new Rocket(Vec2(0, 0), Vec2(0, 0), 0, Faction::CPU);
+	case UnitType::Grenade: return new Grenade(Vec2(0, 0), Vec2(0, 0), Faction::CPU);
+	case UnitType::Explosion: return new Explosion(Vec2(0, 0));
+	case UnitType::Crater: return new Crater(Vec2(0, 0));
+	case UnitType::Drone: return new Drone(Vec2(0, 0));
+	case UnitType::Jet: return new Jet(Vec2(0, 0), Vec2(0, 0), 0);
+	case UnitType::Wall: return new Wall(Vec2(0, 0));
+	case UnitType::ComputeCore: return new ComputeCore(Vec2(0, 0));
+	case UnitType::SiliconRefinery: return new SiliconRefinery(Vec2(0, 0));
+	case UnitType::DroneDeployer: return new DroneDeployer(Vec2(0, 0));
+	}
+	return nullptr;
+}
+
+bool writeSnapshotFile(const char* filename, const std::vector<char>& data) {
+	auto compressed = compress(data.data(), data.size());
+
+	// Write to a temporary file first so a crash never leaves a broken save behind
+	std::string tempname = std::string(filename) + ".tmp";
+	{
+		std::ofstream file(tempname, std::ios::binary);
+		if (!file.good()) {
+			log_error("Could not open snapshot file %s for writing.", tempname.c_str());
+			return false;
+		}
+		uint32_t uncompressedSize = uint32_t(data.size());
+		uint32_t compressedSize = uint32_t(compressed.size());
+		file.write(snapshotMagic, 4);
+		file.write(reinterpret_cast<const char*>(&snapshotVersion), 4);
+		file.write(reinterpret_cast<const char*>(&uncompressedSize), 4);
+		file.write(reinterpret_cast<const char*>(&compressedSize), 4);
+		file.write(compressed.data(), compressed.size());
+		if (!file.good()) {
+			log_error("Could not write snapshot file %s.", tempname.c_str());
+			return false;
+		}
+	}
+	remove(filename);
+	if (rename(tempname.c_str(), filename) != 0) {
+		log_error("Could not rename %s to %s.", tempname.c_str(), filename);
+		return false;
+	}
+	log("Saved snapshot %s (%u bytes, %u compressed).", filename, unsigned(data.size()), unsigned(compressed.size()));
+	return true;
+}
+
+bool readSnapshotFile(const char* filename, std::vector<char>& data) {
+	std::ifstream file(filename, std::ios::binary);
+	if (!file.good()) {
+		log_error("Could not open snapshot file %s for reading.", filename);
+		return false;
+	}
+
+	char magic[4];
+	uint32_t version = 0;
+	uint32_t uncompressedSize = 0;
+	uint32_t compressedSize = 0;
+	file.read(magic, 4);
+	file.read(reinterpret_cast<char*>(&version), 4);
+	file.read(reinterpret_cast<char*>(&uncompressedSize), 4);
+	file.read(reinterpret_cast<char*>(&compressedSize), 4);
+	if (!file.good() || memcmp(magic, snapshotMagic, 4) != 0) {
+		log_error("%s is not a snapshot file.", filename);
+		return false;
+	}
+	if (version != snapshotVersion) {
+		log_error("Unsupported snapshot version %u in %s.", version, filename);
+		return false;
+	}
+
+	std::vector<char> compressed(compressedSize);
+	file.read(compressed.data(), compressedSize);
+	data.resize(uncompressedSize);
+	if (!file.good() || !decompress(compressed.data(), compressed.size(), data.data(), data.size())) {
+		log_error("Snapshot file %s is corrupt.", filename);
+		return false;
+	}
+	return true;
+}
+
+SnapshotSaver::SnapshotSaver() : thread(&SnapshotSaver::run, this) {}
+
+SnapshotSaver::~SnapshotSaver() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	condition.notify_one();
+	thread.join();
+}
+
+void SnapshotSaver::save(std::vector<char>&& data, const std::string& filename) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back({ std::move(data), filename });
+	}
+	condition.notify_one();
+}
+
+void SnapshotSaver::run() {
+	while (true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this] { return quit || !jobs.empty(); });
+			if (jobs.empty()) return;
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		writeSnapshotFile(job.filename.c_str(), job.data);
+	}
+}
@@ -0,0 +1,137 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "Vec2.h"
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class Unit;
+enum class UnitType;
+
+class SnapshotWriter {
+public:
+	// Units are referenced by their index in this list
+	SnapshotWriter(const std::vector<Unit*>& units);
+
+	template<typename T> void write(const T& v) {
+		static_assert(std::is_trivially_copyable<T>::value, "Write members individually");
+		writeBytes(&v, sizeof(T));
+	}
+
+	void write(const Vec2& v) {
+		write(v.x);
+		write(v.y);
+	}
+
+	void writeRef(const Unit* unit);
+	void writeBytes(const void* data, size_t size) {
+		auto p = reinterpret_cast<const char*>(data);
+		buffer.insert(buffer.end(), p, p + size);
+	}
+
+	std::vector<char>& data() { return buffer; }
+
+private:
+	const std::vector<Unit*>& units;
+	std::vector<char> buffer;
+};
+
+class SnapshotReader {
+public:
+	SnapshotReader(const char* data, size_t size) : data(data), size(size) {}
+
+	template<typename T> void read(T& v) {
+		static_assert(std::is_trivially_copyable<T>::value, "Read members individually");
+		readBytes(&v, sizeof(T));
+	}
+
+	void read(Vec2& v) {
+		read(v.x);
+		read(v.y);
+	}
+
+	template<typename T> void readRef(T*& unit) {
+		unit = static_cast<T*>(readRef());
+	}
+	Unit* readRef();
+
+	void readBytes(void* out, size_t count) {
+		if (pos + count > size) {
+			failed = true;
+			memset(out, 0, count);
+			return;
+		}
+		memcpy(out, data + pos, count);
+		pos += count;
+	}
+
+	bool good() const { return !failed; }
+
+	// Filled before unit data is read so references can be resolved
+	std::vector<Unit*> units;
+
+private:
+	const char* data;
+	size_t size;
+	size_t pos{ 0 };
+	bool failed{ false };
+};
+
+Unit* createUnit(UnitType type);
+
+bool writeSnapshotFile(const char* filename, const std::vector<char>& data);
+bool readSnapshotFile(const char* filename, std::vector<char>& data);
+
+// Compresses and writes snapshots on a background thread
+class SnapshotSaver {
+public:
+	SnapshotSaver();
+	~SnapshotSaver();
+
+	void save(std::vector<char>&& data, const std::string& filename);
+
+private:
+	struct Job {
+		std::vector<char> data;
+		std::string filename;
+	};
+
+	void run();
+
+private:
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::deque<Job> jobs;
+	bool quit{ false };
+	std::thread thread;
+};
@@ -0,0 +1,134 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Socket.h"
+#include "sys.h"
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef int socklen_t;
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define INVALID_SOCKET (~uintptr_t(0))
+#define closesocket close
+#endif
+#include <cstring>
+
+static bool initSockets() {
+#ifdef _WIN32
+	static bool initialized = false;
+	if (!initialized) {
+		WSADATA data;
+		if (WSAStartup(MAKEWORD(2, 2), &data) != 0) return false;
+		initialized = true;
+	}
+#endif
+	return true;
+}
+
+bool resolveAddress(const char* host, int port, NetAddress& address) {
+	if (!initSockets()) return false;
+
+	addrinfo hints{};
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	addrinfo* result = nullptr;
+	if (getaddrinfo(host, nullptr, &hints, &result) != 0 || !result) {
+		log_error("Could not resolve %s.", host);
+		return false;
+	}
+	address.host = reinterpret_cast<sockaddr_in*>(result->ai_addr)->sin_addr.s_addr;
+	address.port = htons(uint16_t(port));
+	freeaddrinfo(result);
+	return true;
+}
+
+UdpSocket::UdpSocket() : handle(INVALID_SOCKET) {}
+
+UdpSocket::~UdpSocket() {
+	if (handle != INVALID_SOCKET) closesocket(handle);
+}
+
+bool UdpSocket::open(int port) {
+	if (!initSockets()) {
+		log_error("Could not initialize sockets.");
+		return false;
+	}
+
+	handle = uintptr_t(socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP));
+	if (handle == INVALID_SOCKET) {
+		log_error("Could not create socket.");
+		return false;
+	}
+
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(uint16_t(port));
+	if (bind(handle, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+		log_error("Could not bind socket to port %d.", port);
+		closesocket(handle);
+		handle = INVALID_SOCKET;
+		return false;
+	}
+
+#ifdef _WIN32
+	u_long nonBlocking = 1;
+	ioctlsocket(handle, FIONBIO, &nonBlocking);
+#else
+	fcntl(int(handle), F_SETFL, fcntl(int(handle), F_GETFL, 0) | O_NONBLOCK);
+#endif
+	return true;
+}
+
+bool UdpSocket::isOpen() const {
+	return handle != INVALID_SOCKET;
+}
+
+bool UdpSocket::send(const NetAddress& to, const void* data, size_t size) {
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = to.host;
+	address.sin_port = to.port;
+	int sent = sendto(handle, reinterpret_cast<const char*>(data), int(size), 0, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+	if (sent != int(size)) return false;
+	bytesSent += size;
+	return true;
+}
+
+int UdpSocket::receive(void* buffer, size_t size, NetAddress& from) {
+	sockaddr_in address{};
+	socklen_t length = sizeof(address);
+	int received = recvfrom(handle, reinterpret_cast<char*>(buffer), int(size), 0, reinterpret_cast<sockaddr*>(&address), &length);
+	if (received < 0) return -1;
+	from.host = address.sin_addr.s_addr;
+	from.port = address.sin_port;
+	bytesReceived += received;
+	return received;
+}
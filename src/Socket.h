@@ -0,0 +1,57 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+struct NetAddress {
+	uint32_t host{ 0 };	// IPv4, network byte order
+	uint16_t port{ 0 };	// Network byte order
+
+	bool operator==(const NetAddress& other) const { return host == other.host && port == other.port; }
+	bool operator!=(const NetAddress& other) const { return !(*this == other); }
+};
+
+bool resolveAddress(const char* host, int port, NetAddress& address);
+
+// Non-blocking UDP socket
+class UdpSocket {
+public:
+	UdpSocket();
+	~UdpSocket();
+
+	bool open(int port);
+	bool isOpen() const;
+	bool send(const NetAddress& to, const void* data, size_t size);
+	// Returns the size of the received datagram or -1 if there is none
+	int receive(void* buffer, size_t size, NetAddress& from);
+
+	uint64_t bytesSent{ 0 };
+	uint64_t bytesReceived{ 0 };
+
+private:
+	uintptr_t handle;
+};
@@ -0,0 +1,387 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "SoftwareRenderer.h"
+#include "Texture.h"
+#include <algorithm>
+#include <cmath>
+
+// The inner loops work on one pixel per SIMD lane. The widest instruction set
+// the build targets is used, with a scalar fallback for other platforms.
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+struct Lanes {
+	static const int count = 8;
+	typedef __m256 Float;
+	typedef __m256i Int;
+
+	static Float splat(float v) { return _mm256_set1_ps(v); }
+	static Float centers() { return _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f); }
+	static Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+	static Float sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+	static Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+	static Float min(Float a, Float b) { return _mm256_min_ps(a, b); }
+	static Float max(Float a, Float b) { return _mm256_max_ps(a, b); }
+	static Int inside(Float a) { return _mm256_castps_si256(_mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_GE_OQ)); }
+	static Int both(Int a, Int b) { return _mm256_and_si256(a, b); }
+	static bool any(Int mask) { return _mm256_movemask_ps(_mm256_castsi256_ps(mask)) != 0; }
+	static Float select(Int mask, Float a, Float b) { return _mm256_blendv_ps(b, a, _mm256_castsi256_ps(mask)); }
+	static Int select(Int mask, Int a, Int b) { return _mm256_blendv_epi8(b, a, mask); }
+	static Int truncate(Float a) { return _mm256_cvttps_epi32(a); }
+	static Float toFloat(Int a) { return _mm256_cvtepi32_ps(a); }
+	template<int shift> static Float channel(Int a) { return _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(a, shift), _mm256_set1_epi32(255))); }
+	static Int pack(Float r, Float g, Float b, Float a) {
+		auto rg = _mm256_or_si256(_mm256_cvtps_epi32(r), _mm256_slli_epi32(_mm256_cvtps_epi32(g), 8));
+		auto ba = _mm256_or_si256(_mm256_slli_epi32(_mm256_cvtps_epi32(b), 16), _mm256_slli_epi32(_mm256_cvtps_epi32(a), 24));
+		return _mm256_or_si256(rg, ba);
+	}
+	static Int load(const uint32_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+	static void store(uint32_t* p, Int a) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), a); }
+	static Int gather(const uint32_t* base, Int index) { return _mm256_i32gather_epi32(reinterpret_cast<const int*>(base), index, 4); }
+};
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+
+struct Lanes {
+	static const int count = 4;
+	typedef __m128 Float;
+	typedef __m128i Int;
+
+	static Float splat(float v) { return _mm_set1_ps(v); }
+	static Float centers() { return _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f); }
+	static Float add(Float a, Float b) { return _mm_add_ps(a, b); }
+	static Float sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+	static Float mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+	static Float min(Float a, Float b) { return _mm_min_ps(a, b); }
+	static Float max(Float a, Float b) { return _mm_max_ps(a, b); }
+	static Int inside(Float a) { return _mm_castps_si128(_mm_cmpge_ps(a, _mm_setzero_ps())); }
+	static Int both(Int a, Int b) { return _mm_and_si128(a, b); }
+	static bool any(Int mask) { return _mm_movemask_ps(_mm_castsi128_ps(mask)) != 0; }
+	static Float select(Int mask, Float a, Float b) {
+		auto m = _mm_castsi128_ps(mask);
+		return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+	}
+	static Int select(Int mask, Int a, Int b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+	static Int truncate(Float a) { return _mm_cvttps_epi32(a); }
+	static Float toFloat(Int a) { return _mm_cvtepi32_ps(a); }
+	template<int shift> static Float channel(Int a) { return _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(a, shift), _mm_set1_epi32(255))); }
+	static Int pack(Float r, Float g, Float b, Float a) {
+		auto rg = _mm_or_si128(_mm_cvtps_epi32(r), _mm_slli_epi32(_mm_cvtps_epi32(g), 8));
+		auto ba = _mm_or_si128(_mm_slli_epi32(_mm_cvtps_epi32(b), 16), _mm_slli_epi32(_mm_cvtps_epi32(a), 24));
+		return _mm_or_si128(rg, ba);
+	}
+	static Int load(const uint32_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+	static void store(uint32_t* p, Int a) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), a); }
+	static Int gather(const uint32_t* base, Int index) {
+		alignas(16) int32_t i[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(i), index);
+		return _mm_setr_epi32(base[i[0]], base[i[1]], base[i[2]], base[i[3]]);
+	}
+};
+#else
+struct Lanes {
+	static const int count = 1;
+	typedef float Float;
+	typedef uint32_t Int;
+
+	static Float splat(float v) { return v; }
+	static Float centers() { return 0.5f; }
+	static Float add(Float a, Float b) { return a + b; }
+	static Float sub(Float a, Float b) { return a - b; }
+	static Float mul(Float a, Float b) { return a * b; }
+	static Float min(Float a, Float b) { return a < b ? a : b; }
+	static Float max(Float a, Float b) { return a > b ? a : b; }
+	static Int inside(Float a) { return a >= 0 ? ~0u : 0; }
+	static Int both(Int a, Int b) { return a & b; }
+	static bool any(Int mask) { return mask != 0; }
+	static Float select(Int mask, Float a, Float b) { return mask ? a : b; }
+	static Int select(Int mask, Int a, Int b) { return mask ? a : b; }
+	static Int truncate(Float a) { return Int(int32_t(a)); }
+	static Float toFloat(Int a) { return float(int32_t(a)); }
+	template<int shift> static Float channel(Int a) { return float((a >> shift) & 255); }
+	static Int pack(Float r, Float g, Float b, Float a) {
+		return Int(r + 0.5f) | (Int(g + 0.5f) << 8) | (Int(b + 0.5f) << 16) | (Int(a + 0.5f) << 24);
+	}
+	static Int load(const uint32_t* p) { return *p; }
+	static void store(uint32_t* p, Int a) { *p = a; }
+	static Int gather(const uint32_t* base, Int index) { return base[index]; }
+};
+#endif
+
+static uint32_t packColor(const Vec4& color) {
+	return packUnorm8(color.x) | (packUnorm8(color.y) << 8) | (packUnorm8(color.z) << 16) | (uint32_t(packUnorm8(color.w)) << 24);
+}
+
+SoftwareRenderer::SoftwareRenderer(int threads) : workers(threads) {}
+
+void SoftwareRenderer::resize(int width, int height) {
+	if (width == width_ && height == height_) return;
+	width_ = width;
+	height_ = height;
+	tilesX = (width + tileSize - 1) / tileSize;
+	tilesY = (height + tileSize - 1) / tileSize;
+	// Rows are padded to whole tiles so SIMD loads never leave the buffer
+	stride_ = tilesX * tileSize;
+	pixels_.assign(size_t(stride_) * tilesY * tileSize, 0);
+	bins.assign(size_t(tilesX) * tilesY, {});
+	quads.clear();
+}
+
+void SoftwareRenderer::clear(const Vec4& color) {
+	clearColor = packColor(color);
+	quads.clear();
+	for (auto& bin : bins) {
+		bin.clear();
+	}
+}
+
+void SoftwareRenderer::drawQuads(const Texture* texture, const SpriteVertex* vertices, int numQuads) {
+	for (int i = 0; i < numQuads; i++) {
+		addQuad(texture, vertices + i * 4, 0);
+	}
+}
+
+void SoftwareRenderer::drawRadialProgress(const SpriteVertex* quad, float progress) {
+	addQuad(nullptr, quad, progress);
+}
+
+void SoftwareRenderer::addQuad(const Texture* texture, const SpriteVertex* vertices, float progress) {
+	Quad quad;
+	quad.texture = texture;
+	quad.progress = progress;
+	quad.originX = (vertices[0].x + 0.5f) * 0.25f;
+	quad.originY = (vertices[0].y + 0.5f) * 0.25f;
+
+	// Same placement as sprite_vs.glsl
+	float x[4], y[4], u[4], v[4];
+	float area = 0;
+	for (int i = 0; i < 4; i++) {
+		x[i] = (vertices[i].x + 0.5f) * 0.25f - quad.originX;
+		y[i] = (vertices[i].y + 0.5f) * 0.25f - quad.originY;
+		u[i] = vertices[i].u;
+		v[i] = vertices[i].v;
+	}
+	for (int i = 0; i < 4; i++) {
+		area += x[i] * y[(i + 1) % 4] - x[(i + 1) % 4] * y[i];
+	}
+	if (area == 0) return;
+
+	const float sign = area > 0 ? 1.0f : -1.0f;
+	for (int i = 0; i < 4; i++) {
+		int j = (i + 1) % 4;
+		float dx = x[j] - x[i];
+		float dy = y[j] - y[i];
+		quad.edges[i][0] = -sign * dy;
+		quad.edges[i][1] = sign * dx;
+		quad.edges[i][2] = sign * (dy * x[i] - dx * y[i]);
+	}
+	quad.diagonal[0] = -sign * y[2];
+	quad.diagonal[1] = sign * x[2];
+	quad.diagonal[2] = 0;
+
+	// GL draws the quad as two triangles and interpolates uvs in each
+	static const int triangles[2][3]{ { 0, 1, 2 }, { 0, 2, 3 } };
+	bool valid[2];
+	for (int t = 0; t < 2; t++) {
+		int i = triangles[t][0];
+		int j = triangles[t][1];
+		int k = triangles[t][2];
+		float det = (x[j] - x[i]) * (y[k] - y[i]) - (x[k] - x[i]) * (y[j] - y[i]);
+		valid[t] = det != 0;
+		if (!valid[t]) continue;
+		const float* values[2]{ u, v };
+		float* planes[2]{ quad.u[t], quad.v[t] };
+		for (int n = 0; n < 2; n++) {
+			const float* w = values[n];
+			float ax = ((w[j] - w[i]) * (y[k] - y[i]) - (w[k] - w[i]) * (y[j] - y[i])) / det;
+			float ay = ((w[k] - w[i]) * (x[j] - x[i]) - (w[j] - w[i]) * (x[k] - x[i])) / det;
+			planes[n][0] = ax;
+			planes[n][1] = ay;
+			planes[n][2] = w[i] - ax * x[i] - ay * y[i];
+		}
+	}
+	if (!valid[0] && !valid[1]) return;
+	for (int t = 0; t < 2; t++) {
+		if (valid[t]) continue;
+		std::copy(quad.u[1 - t], quad.u[1 - t] + 3, quad.u[t]);
+		std::copy(quad.v[1 - t], quad.v[1 - t] + 3, quad.v[t]);
+	}
+
+	for (int i = 0; i < 4; i++) {
+		quad.color[i] = vertices[0].color[i];
+	}
+	for (int i = 0; i < 3; i++) {
+		quad.overbright[i] = vertices[0].overbright[i];
+	}
+
+	float minX = *std::min_element(x, x + 4) + quad.originX;
+	float maxX = *std::max_element(x, x + 4) + quad.originX;
+	float minY = *std::min_element(y, y + 4) + quad.originY;
+	float maxY = *std::max_element(y, y + 4) + quad.originY;
+	quad.minX = std::max(0, int(floorf(minX)));
+	quad.minY = std::max(0, int(floorf(minY)));
+	quad.maxX = std::min(width_, int(ceilf(maxX)));
+	quad.maxY = std::min(height_, int(ceilf(maxY)));
+	if (quad.minX >= quad.maxX || quad.minY >= quad.maxY) return;
+
+	auto index = uint32_t(quads.size());
+	quads.push_back(quad);
+	for (int ty = quad.minY / tileSize; ty <= (quad.maxY - 1) / tileSize; ty++) {
+		for (int tx = quad.minX / tileSize; tx <= (quad.maxX - 1) / tileSize; tx++) {
+			bins[ty * tilesX + tx].push_back(index);
+		}
+	}
+}
+
+void SoftwareRenderer::finish() {
+	workers.run(tilesX * tilesY, [this](int tile) { renderTile(tile); });
+
+	quads.clear();
+	for (auto& bin : bins) {
+		bin.clear();
+	}
+}
+
+void SoftwareRenderer::renderTile(int index) {
+	const int x0 = (index % tilesX) * tileSize;
+	const int y0 = (index / tilesX) * tileSize;
+	for (int y = y0; y < y0 + tileSize; y++) {
+		std::fill_n(pixels_.data() + size_t(y) * stride_ + x0, tileSize, clearColor);
+	}
+
+	for (auto i : bins[index]) {
+		auto& quad = quads[i];
+		int minX = std::max(x0, quad.minX);
+		int minY = std::max(y0, quad.minY);
+		int maxX = std::min(x0 + tileSize, quad.maxX);
+		int maxY = std::min(y0 + tileSize, quad.maxY);
+		if (quad.texture) drawSprite(quad, minX, minY, maxX, maxY);
+		else drawRadial(quad, minX, minY, maxX, maxY);
+	}
+}
+
+// sprite_fs.glsl with GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA blending, colors are kept in 0..255
+void SoftwareRenderer::drawSprite(const Quad& quad, int x0, int y0, int x1, int y1) {
+	typedef Lanes L;
+	const uint32_t* texels = quad.texture->pixels();
+	const L::Float zero = L::splat(0);
+	const L::Float maxU = L::splat(float(quad.texture->width() - 1));
+	const L::Float maxV = L::splat(float(quad.texture->height() - 1));
+	const L::Float textureWidth = L::splat(float(quad.texture->width()));
+	const L::Float colorR = L::splat(quad.color[0] / 255);
+	const L::Float colorG = L::splat(quad.color[1] / 255);
+	const L::Float colorB = L::splat(quad.color[2] / 255);
+	const L::Float colorA = L::splat(quad.color[3] / 255);
+	const L::Float overbrightR = L::splat(quad.overbright[0]);
+	const L::Float overbrightG = L::splat(quad.overbright[1]);
+	const L::Float overbrightB = L::splat(quad.overbright[2]);
+	const L::Float full = L::splat(255);
+	const L::Float normalize = L::splat(1.0f / 255);
+
+	// Tiles start at multiples of the lane count, so aligning down stays inside the tile
+	x0 -= x0 % L::count;
+	for (int y = y0; y < y1; y++) {
+		const float py = y + 0.5f - quad.originY;
+		L::Float edgeRows[4];
+		for (int i = 0; i < 4; i++) {
+			edgeRows[i] = L::splat(quad.edges[i][1] * py + quad.edges[i][2]);
+		}
+		const L::Float diagonalRow = L::splat(quad.diagonal[1] * py + quad.diagonal[2]);
+		const L::Float uRows[2]{ L::splat(quad.u[0][1] * py + quad.u[0][2]), L::splat(quad.u[1][1] * py + quad.u[1][2]) };
+		const L::Float vRows[2]{ L::splat(quad.v[0][1] * py + quad.v[0][2]), L::splat(quad.v[1][1] * py + quad.v[1][2]) };
+		uint32_t* row = pixels_.data() + size_t(y) * stride_;
+
+		for (int x = x0; x < x1; x += L::count) {
+			const L::Float px = L::add(L::splat(x - quad.originX), L::centers());
+			L::Int mask = L::inside(L::add(L::mul(L::splat(quad.edges[0][0]), px), edgeRows[0]));
+			for (int i = 1; i < 4; i++) {
+				mask = L::both(mask, L::inside(L::add(L::mul(L::splat(quad.edges[i][0]), px), edgeRows[i])));
+			}
+			if (!L::any(mask)) continue;
+
+			const L::Int second = L::inside(L::add(L::mul(L::splat(quad.diagonal[0]), px), diagonalRow));
+			L::Float u = L::select(second, L::add(L::mul(L::splat(quad.u[1][0]), px), uRows[1]), L::add(L::mul(L::splat(quad.u[0][0]), px), uRows[0]));
+			L::Float v = L::select(second, L::add(L::mul(L::splat(quad.v[1][0]), px), vRows[1]), L::add(L::mul(L::splat(quad.v[0][0]), px), vRows[0]));
+			u = L::toFloat(L::truncate(L::min(L::max(u, zero), maxU)));
+			v = L::toFloat(L::truncate(L::min(L::max(v, zero), maxV)));
+			const L::Int texel = L::gather(texels, L::truncate(L::add(L::mul(v, textureWidth), u)));
+			const L::Int destination = L::load(row + x);
+
+			const L::Float sourceA = L::min(L::mul(L::channel<24>(texel), colorA), full);
+			const L::Float alpha = L::mul(sourceA, normalize);
+			const L::Float sourceR = L::min(L::add(L::mul(L::channel<0>(texel), colorR), overbrightR), full);
+			const L::Float sourceG = L::min(L::add(L::mul(L::channel<8>(texel), colorG), overbrightG), full);
+			const L::Float sourceB = L::min(L::add(L::mul(L::channel<16>(texel), colorB), overbrightB), full);
+			const L::Float destinationR = L::channel<0>(destination);
+			const L::Float destinationG = L::channel<8>(destination);
+			const L::Float destinationB = L::channel<16>(destination);
+			const L::Float destinationA = L::channel<24>(destination);
+			const L::Int blended = L::pack(
+				L::add(destinationR, L::mul(L::sub(sourceR, destinationR), alpha)),
+				L::add(destinationG, L::mul(L::sub(sourceG, destinationG), alpha)),
+				L::add(destinationB, L::mul(L::sub(sourceB, destinationB), alpha)),
+				L::add(destinationA, L::mul(L::sub(sourceA, destinationA), alpha))
+			);
+			L::store(row + x, L::select(mask, blended, destination));
+		}
+	}
+}
+
+// radial_fs.glsl, only a few of these are drawn per frame so they stay scalar
+void SoftwareRenderer::drawRadial(const Quad& quad, int x0, int y0, int x1, int y1) {
+	const float PI = 3.141592653f;
+	const float limit = -PI + quad.progress * PI * 2;
+	const float sourceR = std::min(quad.color[0] + quad.overbright[0], 255.0f);
+	const float sourceG = std::min(quad.color[1] + quad.overbright[1], 255.0f);
+	const float sourceB = std::min(quad.color[2] + quad.overbright[2], 255.0f);
+	const float sourceA = quad.color[3];
+	const float alpha = sourceA / 255;
+
+	for (int y = y0; y < y1; y++) {
+		const float py = y + 0.5f - quad.originY;
+		uint32_t* row = pixels_.data() + size_t(y) * stride_;
+		for (int x = x0; x < x1; x++) {
+			const float px = x + 0.5f - quad.originX;
+			bool inside = true;
+			for (int i = 0; i < 4; i++) {
+				inside = inside && quad.edges[i][0] * px + quad.edges[i][1] * py + quad.edges[i][2] >= 0;
+			}
+			if (!inside) continue;
+
+			int t = quad.diagonal[0] * px + quad.diagonal[1] * py + quad.diagonal[2] >= 0 ? 1 : 0;
+			float u = quad.u[t][0] * px + quad.u[t][1] * py + quad.u[t][2];
+			float v = quad.v[t][0] * px + quad.v[t][1] * py + quad.v[t][2];
+			if (!(limit > atan2f(u - 0.5f, 0.5f - v))) continue;
+
+			uint32_t destination = row[x];
+			float blended[4]{ sourceR, sourceG, sourceB, sourceA };
+			for (int c = 0; c < 4; c++) {
+				float d = float((destination >> (c * 8)) & 255);
+				blended[c] = d + (blended[c] - d) * alpha;
+			}
+			row[x] = uint32_t(blended[0] + 0.5f) | (uint32_t(blended[1] + 0.5f) << 8) | (uint32_t(blended[2] + 0.5f) << 16) | (uint32_t(blended[3] + 0.5f) << 24);
+		}
+	}
+}
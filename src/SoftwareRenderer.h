@@ -0,0 +1,98 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "SpriteVertex.h"
+#include "WorkerPool.h"
+#include <cstdint>
+#include <vector>
+
+class Texture;
+
+// Rasterizes the quads Gfx would send to the GL vertex path into a framebuffer in memory.
+// The screen is split into tiles that worker threads render independently, each tile
+// draws its quads in submission order so blending matches the GL path.
+class SoftwareRenderer {
+public:
+	// Tiles are square and a multiple of every SIMD width
+	static const int tileSize = 64;
+
+	SoftwareRenderer(int threads);
+
+	void resize(int width, int height);
+	void clear(const Vec4& color);
+
+	// Four SpriteVertex per quad as written for the GL vertex path, the texture must be in memory
+	void drawQuads(const Texture* texture, const SpriteVertex* vertices, int numQuads);
+	// The quad's uvs go from 0 to 1 like for radial_fs.glsl
+	void drawRadialProgress(const SpriteVertex* quad, float progress);
+
+	// Renders everything drawn since clear
+	void finish();
+
+	int width() const { return width_; }
+	int height() const { return height_; }
+	// RGBA8, rows from top to bottom, stride() pixels apart
+	const uint32_t* pixels() const { return pixels_.data(); }
+	int stride() const { return stride_; }
+
+private:
+	struct Quad {
+		const Texture* texture;
+		float progress;
+		// All coordinates are relative to the first vertex
+		float originX, originY;
+		// Pixels are inside when all four edge functions are >= 0
+		float edges[4][3];
+		// Picks the triangle for uv interpolation, (0, 1, 2) below 0 and (0, 2, 3) otherwise
+		float diagonal[3];
+		float u[2][3];
+		float v[2][3];
+		// Texture color is multiplied by color and overbright added, both in 0..255
+		float color[4];
+		float overbright[3];
+		int minX, minY, maxX, maxY;
+	};
+
+	void addQuad(const Texture* texture, const SpriteVertex* vertices, float progress);
+	void renderTile(int index);
+	void drawSprite(const Quad& quad, int x0, int y0, int x1, int y1);
+	void drawRadial(const Quad& quad, int x0, int y0, int x1, int y1);
+
+private:
+	int width_{ 0 };
+	int height_{ 0 };
+	int stride_{ 0 };
+	int tilesX{ 0 };
+	int tilesY{ 0 };
+	uint32_t clearColor{ 0 };
+	std::vector<uint32_t> pixels_;
+	std::vector<Quad> quads;
+	// Quad indices per tile
+	std::vector<std::vector<uint32_t>> bins;
+
+	// Renders tiles together with the thread calling finish
+	WorkerPool workers;
+};
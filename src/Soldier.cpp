@@ -21,15 +21,28 @@ SOFTWARE.
 */
 
 #include "Soldier.h"
+#include "Snapshot.h"
 #include "utils.h"
-#include "globals.h"
 #include "Game.h"
 #include "Gfx.h"
 #include "Sfx.h"
 #include "AudioClip.h"
+#include "Pool.h"
 
 Sprite Soldier::sprites[6];
 
+void* Soldier::operator new(size_t size) {
+	return Pool<Soldier>::local().allocate();
+}
+
+void Soldier::operator delete(void* p) {
+	Pool<Soldier>::local().release(p);
+}
+
+void Soldier::reserve(size_t count) {
+	Pool<Soldier>::local().reserve(count);
+}
+
 void Soldier::findTarget(Game& game) {
 	target = nullptr;
 	float distance = 9999999999;
@@ -52,7 +65,7 @@ void Soldier::update(float dt, Game& game, Sfx& sfx) {
 		if (target) state = RUN;
 		break;
 	case RUN:
-		if (!target->isAlive()) {
+		if (!target || !target->isAlive()) {
 			target = nullptr;
 			state = STAND;
 			break;
@@ -65,7 +78,7 @@ void Soldier::update(float dt, Game& game, Sfx& sfx) {
 		if ((tpos - pos).length() < 32) state = SHOOT;
 		break;
 	case SHOOT:
-		if (!target->isAlive()) {
+		if (!target || !target->isAlive()) {
 			target = nullptr;
 			state = STAND;
 			break;
@@ -85,14 +98,15 @@ void Soldier::update(float dt, Game& game, Sfx& sfx) {
 	}
 }
 
-void Soldier::draw_bottom(Gfx& gfx) {
+void Soldier::draw(Gfx& gfx, const Vec2& camera) {
+	gfx.setLayer(LAYER_BOTTOM);
 	int frame = 0;
 	switch (state) {
 	case STAND: frame = 5; break;
 	case RUN: frame = int(time * 8) % 4; break;
 	case SHOOT: frame = shoottime < 0.5f ? 4 + int(time * 16) % 2 : 5; break;
 	}
-	gfx.drawSprite(sprites[frame], pos + Vec2(-5, -4) - floor(cameraPosition), Vec4::WHITE, mirrored);
+	gfx.drawSprite(sprites[frame], pos + Vec2(-5, -4) - camera, Vec4::WHITE, mirrored);
 }
 
 void Soldier::damage(int amount, Faction originator) {
@@ -100,3 +114,48 @@ void Soldier::damage(int amount, Faction originator) {
 	health -= amount;
 	if (health <= 0) alive = false;
 }
+
+void Soldier::hash(StateHash& hash) const {
+	Unit::hash(hash);
+	hash.add(state);
+	hash.add(time);
+	hash.add(shoottime);
+	hash.add(grenadier);
+	hashRef(hash, target);
+}
+
+void Soldier::write(SnapshotWriter& writer) const {
+	Unit::write(writer);
+	writer.write(state);
+	writer.write(time);
+	writer.write(shoottime);
+	writer.write(grenadier);
+	writer.write(mirrored);
+	writer.writeRef(target);
+}
+
+void Soldier::read(SnapshotReader& reader) {
+	Unit::read(reader);
+	reader.read(state);
+	reader.read(time);
+	reader.read(shoottime);
+	reader.read(grenadier);
+	reader.read(mirrored);
+	reader.readRef(target);
+}
+
+void Soldier::writeView(ViewWriter& writer) const {
+	Unit::writeView(writer);
+	writer.write(uint8_t(state | (mirrored ? 4 : 0) | (shoottime < 0.5f ? 8 : 0)));
+	writer.writeTime(time);
+}
+
+void Soldier::readView(ViewReader& reader) {
+	Unit::readView(reader);
+	uint8_t flags;
+	reader.read(flags);
+	state = State(flags & 3);
+	mirrored = (flags & 4) != 0;
+	shoottime = (flags & 8) ? 0.0f : 1.0f;
+	reader.readTime(time);
+}
@@ -35,9 +35,20 @@ class Soldier : public Unit {
 public:
 	Soldier(const Vec2& pos) : Unit(pos, 100) {}
 	virtual void update(float dt, Game& game, Sfx& sfx) override;
-	virtual void draw_bottom(Gfx& gfx) override;
+	virtual void draw(Gfx& gfx, const Vec2& camera) override;
 	virtual void damage(int amount, Faction originator) override;
 	virtual bool isSoldier() const override { return true; }
+	virtual UnitType type() const override { return UnitType::Soldier; }
+	virtual void hash(StateHash& hash) const override;
+	virtual void write(SnapshotWriter& writer) const override;
+	virtual void read(SnapshotReader& reader) override;
+	virtual void writeView(ViewWriter& writer) const override;
+	virtual void readView(ViewReader& reader) override;
+
+	// Soldiers come by the thousands, they live in a pool
+	static void* operator new(size_t size);
+	static void operator delete(void* p);
+	static void reserve(size_t count);
 
 private:
 	void findTarget(Game&);
@@ -26,9 +26,92 @@ SOFTWARE.
 
 #include "Vec2.h"
 #include "Vec4.h"
+#include <cmath>
+#include <cstdint>
 
+inline float packClamp(float value, float min, float max) {
+	return value < min ? min : value > max ? max : value;
+}
+
+// Quarter pixels, the shader moves them to the middle of their quarter pixel
+// so quad edges never pass exactly through pixel centers
+inline int16_t packPosition(float value) {
+	return int16_t(packClamp(floorf(value * 4), -32768, 32767));
+}
+
+inline int16_t packTexel(float value) {
+	return int16_t(packClamp(value + (value < 0 ? -0.5f : 0.5f), -32768, 32767));
+}
+
+inline uint8_t packUnorm8(float value) {
+	return uint8_t(packClamp(value * 255 + 0.5f, 0, 255));
+}
+
+// 16 byte vertex, positions are stored in quarter pixels and uvs in texels.
+// Colors above 1 are split into a multiplied and an added part.
 struct SpriteVertex {
-	Vec2 position;
-	Vec2 uv;
-	Vec4 color;
+	SpriteVertex() = default;
+	SpriteVertex(const Vec2& position, const Vec2& uv, const Vec4& color, float layer) {
+		x = packPosition(position.x);
+		y = packPosition(position.y);
+		u = uint16_t(packTexel(uv.x));
+		v = uint16_t(packTexel(uv.y));
+		this->color[0] = packUnorm8(color.x);
+		this->color[1] = packUnorm8(color.y);
+		this->color[2] = packUnorm8(color.z);
+		this->color[3] = packUnorm8(color.w);
+		overbright[0] = packUnorm8(color.x - 1);
+		overbright[1] = packUnorm8(color.y - 1);
+		overbright[2] = packUnorm8(color.z - 1);
+		this->layer = uint8_t(layer);
+	}
+
+	int16_t x, y;
+	uint16_t u, v;
+	uint8_t color[4];
+	uint8_t overbright[3];
+	// Texture array layer
+	uint8_t layer;
+};
+
+// 32 byte instance expanded into a quad by sprite_instanced_vs.glsl, rotated
+// around its center. Units are the same as in SpriteVertex. Shadows are
+// moved down by their shadow offset.
+struct SpriteInstance {
+	SpriteInstance() = default;
+	SpriteInstance(const Vec2& center, const Vec2& size, const Vec2& uv, const Vec2& clipSize, const Vec4& color, float layer, float angle, bool mirror, float shadow = 0) {
+		x = packPosition(center.x);
+		y = packPosition(center.y);
+		width = packPosition(size.x);
+		height = packPosition(size.y);
+		u = uint16_t(packTexel(uv.x));
+		v = uint16_t(packTexel(uv.y));
+		du = packTexel(clipSize.x);
+		dv = packTexel(clipSize.y);
+		this->color[0] = packUnorm8(color.x);
+		this->color[1] = packUnorm8(color.y);
+		this->color[2] = packUnorm8(color.z);
+		this->color[3] = packUnorm8(color.w);
+		overbright[0] = packUnorm8(color.x - 1);
+		overbright[1] = packUnorm8(color.y - 1);
+		overbright[2] = packUnorm8(color.z - 1);
+		this->layer = uint8_t(layer);
+		this->angle = angle;
+		this->mirror = mirror ? 1 : 0;
+		padding = 0;
+		this->shadow = packPosition(shadow);
+	}
+
+	int16_t x, y;
+	int16_t width, height;
+	// Top left of the clip rect and its size, dv is negative
+	uint16_t u, v;
+	int16_t du, dv;
+	uint8_t color[4];
+	uint8_t overbright[3];
+	uint8_t layer;
+	float angle;
+	uint8_t mirror;
+	uint8_t padding;
+	int16_t shadow;
 };
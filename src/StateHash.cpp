@@ -0,0 +1,71 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "StateHash.h"
+#include "sys.h"
+#include <cinttypes>
+#include <cstdio>
+
+bool ChecksumLog::open(const char* filename) {
+	file.open(filename);
+	if (!file.good()) {
+		log_error("Could not open checksum file %s for writing.", filename);
+		return false;
+	}
+	return true;
+}
+
+void ChecksumLog::write(int tick, uint64_t hash) {
+	if (!file.is_open()) return;
+	char line[32];
+	snprintf(line, sizeof(line), "%d %016" PRIx64 "\n", tick, hash);
+	file << line;
+}
+
+int compareChecksumLogs(const char* filenameA, const char* filenameB) {
+	std::ifstream a(filenameA);
+	std::ifstream b(filenameB);
+	if (!a.good() || !b.good()) {
+		log_error("Could not open checksum files %s and %s.", filenameA, filenameB);
+		return 0;
+	}
+
+	int tickA, tickB;
+	std::string hashA, hashB;
+	int lastTick = -1;
+	while (true) {
+		bool moreA = bool(a >> tickA >> hashA);
+		bool moreB = bool(b >> tickB >> hashB);
+		if (!moreA && !moreB) return -1;
+		if (moreA != moreB) {
+			log("Checksum logs have different length, %s ends after tick %d.", moreA ? filenameB : filenameA, lastTick);
+			return lastTick + 1;
+		}
+		if (tickA != tickB || hashA != hashB) {
+			log("Runs diverge at tick %d: %s != %s", tickA, hashA.c_str(), hashB.c_str());
+			return tickA;
+		}
+		lastTick = tickA;
+	}
+}
@@ -0,0 +1,81 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "Vec2.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+// Cheap order dependent hash over simulation state. Floats are hashed by
+// their bit pattern so any divergence between two runs shows up.
+class StateHash {
+public:
+	static uint64_t mix(uint64_t v) {
+		v ^= v >> 30;
+		v *= 0xbf58476d1ce4e5b9ull;
+		v ^= v >> 27;
+		v *= 0x94d049bb133111ebull;
+		v ^= v >> 31;
+		return v;
+	}
+
+	void add(uint64_t v) {
+		h = (h ^ mix(v)) * 0x100000001b3ull;
+		h = (h << 23) | (h >> 41);
+	}
+
+	template<typename T> void add(const T& v) {
+		static_assert(std::is_trivially_copyable<T>::value && sizeof(T) <= 8, "Hash members individually");
+		uint64_t bits = 0;
+		memcpy(&bits, &v, sizeof(T));
+		add(bits);
+	}
+
+	void add(const Vec2& v) {
+		add(v.x);
+		add(v.y);
+	}
+
+	uint64_t value() const { return mix(h); }
+
+private:
+	uint64_t h{ 0xcbf29ce484222325ull };
+};
+
+// Writes one "tick hash" line per simulation tick
+class ChecksumLog {
+public:
+	bool open(const char* filename);
+	bool isOpen() const { return file.is_open(); }
+	void write(int tick, uint64_t hash);
+
+private:
+	std::ofstream file;
+};
+
+// Returns the first tick at which two checksum logs differ, or -1 if they match
+int compareChecksumLogs(const char* filenameA, const char* filenameB);
@@ -28,6 +28,20 @@ SOFTWARE.
 #include "sys.h"
 
 Texture::Texture(const Image& image): width_(image.width()), height_(image.height()) {
+	create(image);
+}
+
+Texture::Texture(const Image& image, bool inMemory) : width_(image.width()), height_(image.height()) {
+	if (!inMemory) {
+		create(image);
+		return;
+	}
+	pixels_.resize(size_t(width_) * height_);
+	load(image);
+}
+
+void Texture::create(const Image& image) {
+	target = GL_TEXTURE_2D;
 	glGenTextures(1, &texture);
 	glBindTexture(GL_TEXTURE_2D, texture);
 	glTexImage2D(GL_TEXTURE_2D, 0, image.format() == Image::Format::RGB8 ? GL_RGB8 : GL_RGBA8, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
@@ -36,8 +50,40 @@ Texture::Texture(const Image& image): width_(image.width()), height_(image.heigh
 	load(image);
 }
 
+Texture::Texture(unsigned int width, unsigned int height, int layers) : width_(width), height_(height), target(GL_TEXTURE_2D_ARRAY), layers(layers) {
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width_, height_, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+}
+
+Texture::Texture(unsigned int width, unsigned int height, const uint16_t* indices) : width_(width), height_(height), target(GL_TEXTURE_2D) {
+	// Index maps are created while other textures are bound, keep the one on the active unit
+	GLint previous;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16UI, width_, height_, 0, GL_RG_INTEGER, GL_UNSIGNED_SHORT, indices);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, previous);
+}
+
+// Smaller images sit in the bottom left corner of their layer, which is where
+// their flipped rows start
+Texture::Texture(const Image& image, Texture* array) : width_(image.width()), height_(image.height()), array(array) {
+	layer_ = array->usedLayers++;
+	load(image);
+}
+
+bool Texture::canHold(const Image& image) const {
+	return usedLayers < layers && image.width() <= width_ && image.height() <= height_;
+}
+
 Texture::~Texture() {
-	glDeleteTextures(1, &texture);
+	if (texture) glDeleteTextures(1, &texture);
 }
 
 void Texture::load(const Image& image) {
@@ -46,20 +92,51 @@ void Texture::load(const Image& image) {
 		return;
 	}
 
+	if (!pixels_.empty()) {
+		auto bytes = static_cast<const uint8_t*>(image.data());
+		const int components = image.format() == Image::Format::RGB8 ? 3 : 4;
+		for (size_t i = 0; i < pixels_.size(); i++) {
+			auto p = bytes + i * components;
+			uint32_t alpha = components == 4 ? p[3] : 255;
+			pixels_[i] = p[0] | (p[1] << 8) | (p[2] << 16) | (alpha << 24);
+		}
+		return;
+	}
+
+	if (array) {
+		glBindTexture(GL_TEXTURE_2D_ARRAY, array->texture);
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer_, width_, height_, 1, image.format() == Image::Format::RGB8 ? GL_RGB : GL_RGBA, GL_UNSIGNED_BYTE, image.data());
+		return;
+	}
+
 	glBindTexture(GL_TEXTURE_2D, texture);
 	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, image.format() == Image::Format::RGB8 ? GL_RGB : GL_RGBA, GL_UNSIGNED_BYTE, image.data());
 }
 
+void Texture::setIndices(int x, int y, uint16_t first, uint16_t second) {
+	uint16_t texel[2]{ first, second };
+	if (unit_ >= 0) {
+		glActiveTexture(GL_TEXTURE0 + unit_);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, 1, 1, GL_RG_INTEGER, GL_UNSIGNED_SHORT, texel);
+		return;
+	}
+	GLint previous;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, 1, 1, GL_RG_INTEGER, GL_UNSIGNED_SHORT, texel);
+	glBindTexture(GL_TEXTURE_2D, previous);
+}
+
 void Texture::bind(int unit) {
 	if (unit_ >= 0) unbind();
 	unit_ = unit;
 	glActiveTexture(GL_TEXTURE0 + unit_);
-	glBindTexture(GL_TEXTURE_2D, texture);
+	glBindTexture(target, texture);
 }
 
 void Texture::unbind() {
 	if (unit_ < 0) return;
 	glActiveTexture(GL_TEXTURE0 + unit_);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindTexture(target, 0);
 	unit_ = -1;
 }
\ No newline at end of file
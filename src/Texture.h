@@ -24,23 +24,54 @@ SOFTWARE.
 
 #pragma once
 
+#include <cstdint>
+#include <vector>
+
 class Image;
 
 class Texture {
 public:
 	Texture(const Image&);
+	// Empty texture array, images become layers through the constructor below
+	Texture(unsigned int width, unsigned int height, int layers);
+	// Layer of an array, check canHold first
+	Texture(const Image&, Texture* array);
+	// Two 16 bit unsigned integers per texel for usampler2D lookups, data may be null
+	Texture(unsigned int width, unsigned int height, const uint16_t* indices);
+	// In memory textures keep RGBA8 pixels for the software renderer instead of creating a GL
+	// texture. Rows are stored bottom to top like in the GL texture.
+	Texture(const Image&, bool inMemory);
 	~Texture();
 
 	void load(const Image&);
+	void setIndices(int x, int y, uint16_t first, uint16_t second);
 	void bind(int index);
 	void unbind();
 	int unit() const { return unit_; }
 	unsigned int width() const { return width_; }
 	unsigned int height() const { return height_; }
 
+	bool isArray() const { return layers > 0; }
+	bool canHold(const Image&) const;
+	int layer() const { return layer_; }
+	// Texture to bind when drawing this one, textures sharing it can be batched
+	Texture* storage() { return array ? array : this; }
+	const Texture* storage() const { return array ? array : this; }
+	const uint32_t* pixels() const { return pixels_.data(); }
+
+private:
+	void create(const Image&);
+
 private:
 	unsigned int width_{ 0 };
 	unsigned int height_{ 0 };
 	unsigned int texture{ 0 };
+	unsigned int target{ 0 };
 	int unit_{ -1 };
+	Texture* array{ nullptr };
+	int layer_{ 0 };
+	int layers{ 0 };
+	int usedLayers{ 0 };
+	// Only used by in memory textures
+	std::vector<uint32_t> pixels_;
 };
@@ -42,3 +42,9 @@ void Timer::lap() {
 	}
 	lapTick = tick;
 }
+
+void Timer::set(float deltaTime, double elapsedTime) {
+	frameCount++;
+	dt = deltaTime;
+	time = elapsedTime;
+}
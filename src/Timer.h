@@ -28,6 +28,7 @@ class Timer {
 public:
 	Timer();
 	void lap();
+	void set(float deltaTime, double elapsedTime);
 
 	float deltaTime() const { return dt; }
 	double elapsedTime() const { return time; }
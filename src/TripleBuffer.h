@@ -0,0 +1,56 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <atomic>
+
+// Hands values from one producer thread to one consumer thread without locks. The
+// producer fills the back slot, the consumer reads the front slot and the third
+// slot holds the newest published value, so neither side ever waits for the other.
+// Values the consumer did not pick up in time are overwritten.
+template<typename T> class TripleBuffer {
+public:
+	// Producer side, only valid until the next publish
+	T& back() { return slots[backIndex]; }
+	void publish() { backIndex = middle.exchange(backIndex | fresh) & indexMask; }
+
+	// Consumer side, switches to the newest published value. Returns false if
+	// nothing was published since the last call.
+	bool update() {
+		if (!(middle.load() & fresh)) return false;
+		frontIndex = middle.exchange(frontIndex) & indexMask;
+		return true;
+	}
+	const T& front() const { return slots[frontIndex]; }
+
+private:
+	static const int indexMask = 3;
+	static const int fresh = 4;
+
+	T slots[3];
+	int backIndex{ 0 };
+	std::atomic<int> middle{ 1 };
+	int frontIndex{ 2 };
+};
@@ -25,16 +25,35 @@ SOFTWARE.
 #pragma once
 
 #include "Vec2.h"
+#include "StateHash.h"
+#include "NetView.h"
 
 class Sfx;
 class Gfx;
 class Game;
+class SnapshotWriter;
+class SnapshotReader;
 
 enum class Faction {
 	Player,
 	CPU,
 };
 
+enum class UnitType {
+	Unknown,
+	Soldier,
+	Rocket,
+	Grenade,
+	Explosion,
+	Crater,
+	Drone,
+	Jet,
+	Wall,
+	ComputeCore,
+	SiliconRefinery,
+	DroneDeployer,
+};
+
 static const int damage_bullet = 5;
 static const int damage_grenade = 40;
 static const int damage_explosion = 100;
@@ -44,11 +63,11 @@ public:
 	Unit(const Vec2& pos, float maxHealth_) : pos(pos), health(maxHealth_), maxHealth(maxHealth_) {}
 	virtual ~Unit() {}
 	virtual void update(float dt, Game& game, Sfx& sfx) {};
-	virtual void draw_floor(Gfx& gfx) {};
-	virtual void draw_structure(Gfx& gfx) {};
-	virtual void draw_bottom(Gfx& gfx) {};
-	virtual void draw_top(Gfx& gfx) {};
+	// Emits every layer of the unit, switching with gfx.setLayer
+	virtual void draw(Gfx& gfx, const Vec2& camera) {};
 	virtual void damage(int amount, Faction originator) {};
+	// Drops references to dead units, Game::updateUnits frees dead soldiers after calling it
+	virtual void forgetDeadUnits() {}
 	bool isAlive() const { return alive; }
 	bool inRadius(const Vec2& c, float r) {
 		return (c - pos).length() < r;
@@ -71,9 +90,38 @@ public:
 		return isWall() || isComputeCore() || isDroneDeployer() || isSiliconRefinery();
 	}
 
+	virtual UnitType type() const { return UnitType::Unknown; }
+	virtual void hash(StateHash& hash) const {
+		hash.add(type());
+		hash.add(pos);
+		hash.add(alive);
+		hash.add(health);
+		hash.add(maxHealth);
+	}
+	virtual void write(SnapshotWriter& writer) const;
+	virtual void read(SnapshotReader& reader);
+
+	// Quantized state a network client needs to draw the unit, starting with the position
+	virtual void writeView(ViewWriter& writer) const {
+		writer.writePosition(pos);
+	}
+	virtual void readView(ViewReader& reader) {
+		reader.readPosition(pos);
+	}
+
+protected:
+	static void hashRef(StateHash& hash, const Unit* unit) {
+		// Dead units behave like no unit at all
+		bool live = unit && unit->alive;
+		hash.add(live);
+		if (live) hash.add(unit->pos);
+	}
+
 public:
 	Vec2 pos;
 	bool alive{ true };
 	float health;
 	float maxHealth;
+	int snapshotHandle{ -1 };
+	uint32_t netId{ 0 };
 };
@@ -0,0 +1,136 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "WaveDirector.h"
+#include "Game.h"
+#include "Jet.h"
+#include "sys.h"
+#include "utils.h"
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+// Same waves as the game always had, one soldier at a time
+static const WaveSpec builtinWaves[] = {
+	{ 1, 2.0f, 1, 0, 2, 0, 0, 0, 0 },
+	{ 2, 1.5f, 1, 0, 4, 0, 0, 0, 0 },
+	{ 3, 1.0f, 1, 0, 6, 0, 10, 1, 0 },
+	{ 4, 0.5f, 1, 0, 8, 2, 10, 2, 1 },
+};
+
+static bool parseTable(const char* filename, std::vector<WaveSpec>& table) {
+	std::ifstream file(filename);
+	if (!file.good()) return false;
+
+	std::vector<WaveSpec> rows;
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line)) {
+		lineNumber++;
+		auto comment = line.find('#');
+		if (comment != std::string::npos) line.resize(comment);
+		if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+
+		WaveSpec row;
+		std::istringstream in(line);
+		in >> row.wave >> row.squadInterval >> row.squadSize >> row.squadGrowth >> row.grenadierPercent >> row.grenadierGrowth
+			>> row.jetInterval >> row.jets >> row.jetGrowth;
+		if (in.fail() || row.wave < 1 || row.squadInterval <= 0 || (!rows.empty() && row.wave <= rows.back().wave)) {
+			log_error("Invalid wave table row in %s line %d.", filename, lineNumber);
+			return false;
+		}
+		rows.push_back(row);
+	}
+	if (rows.empty()) {
+		log_error("Wave table %s is empty.", filename);
+		return false;
+	}
+	table = std::move(rows);
+	return true;
+}
+
+const char* WaveDirector::tableFile = "media/waves.txt";
+
+static const std::vector<WaveSpec>& defaultTable() {
+	static std::vector<WaveSpec> table;
+	static std::once_flag once;
+	std::call_once(once, [] {
+		if (parseTable(WaveDirector::tableFile, table)) {
+			log("Loaded %d wave table rows from %s.", int(table.size()), WaveDirector::tableFile);
+		}
+		else {
+			log_error("Could not load wave table %s, using the built-in waves.", WaveDirector::tableFile);
+			table.assign(std::begin(builtinWaves), std::end(builtinWaves));
+		}
+	});
+	return table;
+}
+
+WaveDirector::WaveDirector() : table(defaultTable()) {}
+
+void WaveDirector::reset() {
+	nextSquadTime = 0;
+	nextJetTime = 0;
+}
+
+const WaveSpec& WaveDirector::spec(int wave) const {
+	size_t row = 0;
+	while (row + 1 < table.size() && table[row + 1].wave <= wave) row++;
+	return table[row];
+}
+
+void WaveDirector::update(Game& game, double time, int wave) {
+	auto& row = spec(wave);
+	int waves = std::max(0, wave - row.wave);
+
+	if (time > nextSquadTime) {
+		nextSquadTime = time + row.squadInterval;
+		int size = row.squadSize + row.squadGrowth * waves;
+		if (size > 0) game.spawnSquad(size, row.grenadierPercent + row.grenadierGrowth * waves);
+	}
+
+	int jets = row.jets + row.jetGrowth * waves;
+	if (jets > 0 && row.jetInterval > 0 && time > nextJetTime) {
+		nextJetTime = time + row.jetInterval;
+		auto dir = Vec2(frand(-1, 1), frand(-1, 1)).normalized();
+		Vec2 hittarget(-1, -1);
+		for (auto unit : game.units) {
+			if (unit->isPlayerStructure()) {
+				hittarget = unit->pos + Vec2(16, 16);
+				break;
+			}
+		}
+		if (hittarget.x != -1 && hittarget.y != -1) {
+			for (int i = 0; i < jets; i++) {
+				auto target = hittarget + Vec2(frand(-100, 100), frand(-100, 100));
+				auto pos = target - dir * 500;
+				auto jet = new Jet(pos, dir, 0);
+				jet->target = target;
+				game.units.push_back(jet);
+				game.addUnit(jet, jet->pos);
+			}
+		}
+	}
+}
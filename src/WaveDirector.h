@@ -0,0 +1,63 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <vector>
+
+class Game;
+
+// One row of the wave table, used from its wave on until the next row.
+// Counts grow by their per wave value for every wave past the row.
+struct WaveSpec {
+	int wave{ 1 };
+	float squadInterval{ 1 };
+	int squadSize{ 1 };
+	int squadGrowth{ 0 };
+	int grenadierPercent{ 0 };
+	int grenadierGrowth{ 0 };
+	float jetInterval{ 0 };
+	int jets{ 0 };
+	int jetGrowth{ 0 };
+};
+
+// Spawns the enemies of a wave from a data table. Every squad arrives as
+// one batch so even waves of tens of thousands of soldiers stay cheap.
+class WaveDirector {
+public:
+	WaveDirector();
+
+	// Table every new game starts with, read on first use, one row per line:
+	// wave interval squad +squad grenadier% +grenadier% jet-interval jets +jets
+	static const char* tableFile;
+	void reset();
+	void update(Game& game, double time, int wave);
+
+	const WaveSpec& spec(int wave) const;
+
+public:
+	std::vector<WaveSpec> table;
+	double nextSquadTime{ 0 };
+	double nextJetTime{ 0 };
+};
@@ -0,0 +1,92 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(int threads) {
+	for (int i = 1; i < threads; i++) {
+		workers.emplace_back(&WorkerPool::work, this);
+	}
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	start.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+void WorkerPool::run(int count, const std::function<void(int)>& job) {
+	if (count <= 0) return;
+	if (workers.empty() || count == 1) {
+		for (int i = 0; i < count; i++) {
+			job(i);
+		}
+		return;
+	}
+
+	nextJob = 0;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->job = &job;
+		numJobs = count;
+		busy = int(workers.size());
+		generation++;
+	}
+	start.notify_all();
+	runJobs();
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this] { return busy == 0; });
+		this->job = nullptr;
+	}
+}
+
+void WorkerPool::work() {
+	int finished = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			start.wait(lock, [&] { return quit || generation != finished; });
+			if (quit) return;
+			finished = generation;
+		}
+		runJobs();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			busy--;
+		}
+		done.notify_one();
+	}
+}
+
+void WorkerPool::runJobs() {
+	for (int i = nextJob++; i < numJobs; i = nextJob++) {
+		(*job)(i);
+	}
+}
@@ -0,0 +1,60 @@
+/*
+MIT License
+
+Copyright(c) 2020 Stephan Unverwerth
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Threads that wait between calls to run, so work done every frame does not pay
+// for starting threads. The thread calling run works on the jobs too.
+class WorkerPool {
+public:
+	WorkerPool(int threads);
+	~WorkerPool();
+
+	int threads() const { return int(workers.size()) + 1; }
+	// Calls job(i) for every i below count, spread over all threads, and returns when all are done
+	void run(int count, const std::function<void(int)>& job);
+
+private:
+	void work();
+	void runJobs();
+
+private:
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable start;
+	std::condition_variable done;
+	const std::function<void(int)>* job{ nullptr };
+	std::atomic<int> nextJob{ 0 };
+	int numJobs{ 0 };
+	int generation{ 0 };
+	int busy{ 0 };
+	bool quit{ false };
+};
@@ -27,37 +27,354 @@ SOFTWARE.
 #include "Timer.h"
 #include "Game.h"
 #include "Sfx.h"
+#include "Replay.h"
+#include "StateHash.h"
+#include "Level.h"
+#include "SelfPlay.h"
+#include "Environment.h"
+#include "Lockstep.h"
+#include "Server.h"
+#include "Client.h"
+#include "NetBench.h"
+#include "RenderBench.h"
+#include "LevelGenerator.h"
+#include "FloorCache.h"
+#include "FloorTileMap.h"
+#include "SimThread.h"
 
 #define SDL_MAIN_HANDLED
 #include <SDL2/SDL.h>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
 
 #ifdef _WIN32
 #include <Windows.h>
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nShowCmd) {
+	int argc = __argc;
+	char** argv = __argv;
 #else
 int main(int argc, char** argv) {
 #endif
-	sys_init();
+	const char* recordFile = nullptr;
+	const char* replayFile = nullptr;
+	const char* timingsFile = nullptr;
+	const char* checksumFile = nullptr;
+	const char* compareFiles[2]{ nullptr, nullptr };
+	const char* convertFiles[2]{ nullptr, nullptr };
+	SelfPlayOptions selfPlay;
+	bool runSelfPlayGames = false;
+	const char* envName = nullptr;
+	int envCount = 1;
+	int frameSkip = 1;
+	const char* lockstepHost = nullptr;
+	int lockstepPlayer = 0;
+	int lockstepPort = 0;
+	int inputDelay = 4;
+	int serverPort = 0;
+	const char* connectHost = nullptr;
+	int connectPort = 0;
+	NetBenchOptions netBench;
+	bool runNetBenchmark = false;
+	RenderBenchOptions renderBench;
+	bool runRenderBenchmark = false;
+	const char* wavesFile = nullptr;
+	const char* levelFile = nullptr;
+	LevelGeneratorOptions levelGenerator;
+	const char* generateFile = nullptr;
+	bool headless = false;
+	const char* screenshotFile = nullptr;
+	int screenshotFrame = 0;
+	bool simThread = false;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--record") && i + 1 < argc) recordFile = argv[++i];
+		else if (!strcmp(argv[i], "--replay") && i + 1 < argc) replayFile = argv[++i];
+		else if (!strcmp(argv[i], "--timings") && i + 1 < argc) timingsFile = argv[++i];
+		else if (!strcmp(argv[i], "--checksums") && i + 1 < argc) checksumFile = argv[++i];
+		else if (!strcmp(argv[i], "--compare") && i + 2 < argc) {
+			compareFiles[0] = argv[++i];
+			compareFiles[1] = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--convert-level") && i + 2 < argc) {
+			convertFiles[0] = argv[++i];
+			convertFiles[1] = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--headless")) headless = true;
+		else if (!strcmp(argv[i], "--selfplay") && i + 1 < argc) {
+			selfPlay.games = atoi(argv[++i]);
+			runSelfPlayGames = true;
+		}
+		else if (!strcmp(argv[i], "--threads") && i + 1 < argc) selfPlay.threads = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--seed") && i + 1 < argc) selfPlay.firstSeed = strtoul(argv[++i], nullptr, 10);
+		else if (!strcmp(argv[i], "--max-time") && i + 1 < argc) selfPlay.maxGameTime = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--report") && i + 1 < argc) selfPlay.reportFile = argv[++i];
+		else if (!strcmp(argv[i], "--env") && i + 2 < argc) {
+			envName = argv[++i];
+			envCount = atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--frame-skip") && i + 1 < argc) frameSkip = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--lockstep") && i + 3 < argc) {
+			lockstepPlayer = atoi(argv[++i]) ? 1 : 0;
+			lockstepHost = argv[++i];
+			lockstepPort = atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--input-delay") && i + 1 < argc) inputDelay = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--waves") && i + 1 < argc) wavesFile = argv[++i];
+		else if (!strcmp(argv[i], "--level") && i + 1 < argc) levelFile = argv[++i];
+		else if (!strcmp(argv[i], "--batch-quads") && i + 1 < argc) Gfx::maxBatchQuads = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--separate-textures")) Gfx::useTextureArray = false;
+		else if (!strcmp(argv[i], "--no-instancing")) Gfx::useInstancing = false;
+		else if (!strcmp(argv[i], "--no-floor-cache")) FloorCache::enabled = false;
+		else if (!strcmp(argv[i], "--tilemap-floor")) FloorTileMap::enabled = true;
+		else if (!strcmp(argv[i], "--software-renderer")) Gfx::useSoftwareRenderer = true;
+		else if (!strcmp(argv[i], "--offscreen")) Gfx::useOffscreen = true;
+		else if (!strcmp(argv[i], "--sim-thread")) simThread = true;
+		else if (!strcmp(argv[i], "--draw-threads") && i + 1 < argc) Game::drawThreads = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--screenshot") && i + 2 < argc) {
+			screenshotFrame = atoi(argv[++i]);
+			screenshotFile = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--generate-level") && i + 4 < argc) {
+			levelGenerator.width = atoi(argv[++i]);
+			levelGenerator.height = atoi(argv[++i]);
+			levelGenerator.seed = strtoul(argv[++i], nullptr, 10);
+			generateFile = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--server") && i + 1 < argc) serverPort = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--connect") && i + 2 < argc) {
+			connectHost = argv[++i];
+			connectPort = atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--net-bench") && i + 2 < argc) {
+			netBench.clients = atoi(argv[++i]);
+			netBench.seconds = atof(argv[++i]);
+			runNetBenchmark = true;
+		}
+		else if (!strcmp(argv[i], "--render-bench") && i + 3 < argc) {
+			renderBench.frames = atoi(argv[++i]);
+			renderBench.width = atoi(argv[++i]);
+			renderBench.height = atoi(argv[++i]);
+			runRenderBenchmark = true;
+		}
+	}
+
+	if (wavesFile) WaveDirector::tableFile = wavesFile;
+	if (levelFile) Game::levelFile = levelFile;
+
+	if (compareFiles[0]) {
+		sys_init(true);
+		int tick = compareChecksumLogs(compareFiles[0], compareFiles[1]);
+		if (tick < 0) printf("Runs are identical\n");
+		else printf("Runs diverge at tick %d\n", tick);
+		sys_shutdown();
+		return tick < 0 ? 0 : 1;
+	}
+
+	if (convertFiles[0]) {
+		sys_init(true);
+		Level level(100, 100);
+		bool converted = level.load(convertFiles[0], true) && level.save(convertFiles[1], true);
+		printf(converted ? "Converted level to %s\n" : "Could not convert level to %s\n", convertFiles[1]);
+		sys_shutdown();
+		return converted ? 0 : 1;
+	}
+
+	if (generateFile) {
+		sys_init(true);
+		levelGenerator.threads = selfPlay.threads;
+		Level level(1, 1);
+		bool generated = generateLevel(level, levelGenerator) && level.save(generateFile, true);
+		printf(generated ? "Generated level %s\n" : "Could not generate level %s\n", generateFile);
+		sys_shutdown();
+		return generated ? 0 : 1;
+	}
+
+	if (runSelfPlayGames) {
+		sys_init(true);
+		int result = runSelfPlay(selfPlay);
+		sys_shutdown();
+		return result;
+	}
+
+	if (envName) {
+		sys_init(true);
+		int result = runEnvironments(envName, envCount, frameSkip);
+		sys_shutdown();
+		return result;
+	}
+
+	if (serverPort) {
+		sys_init(true);
+		int result = runServer(serverPort, selfPlay.firstSeed);
+		sys_shutdown();
+		return result;
+	}
+
+	if (runNetBenchmark) {
+		sys_init(true);
+		int result = runNetBench(netBench);
+		sys_shutdown();
+		return result;
+	}
+
+	if (runRenderBenchmark) {
+		sys_init(true);
+		renderBench.seed = selfPlay.firstSeed;
+		int result = runRenderBench(renderBench);
+		sys_shutdown();
+		return result;
+	}
+
+	// Without a replay there is nobody to provide input
+	if (!replayFile) headless = false;
+	if (lockstepHost || connectHost) {
+		replayFile = nullptr;
+		recordFile = nullptr;
+		headless = false;
+	}
+
+	if (simThread && screenshotFile && !replayFile && !lockstepHost && !connectHost) {
+		// The sim thread's frames are drawn whenever they are ready, so frame numbers are not repeatable
+		printf("--screenshot cannot be combined with --sim-thread\n");
+		return 1;
+	}
+
+	// Offscreen runs need neither a display nor an audio device
+	sys_init(headless || Gfx::useOffscreen);
+
+	Replay replay;
+	int width = 1280;
+	int height = 800;
+	if (replayFile) {
+		if (!replay.startPlayback(replayFile)) sys_crash("Could not load replay file.");
+		width = replay.width();
+		height = replay.height();
+	}
 
-	Gfx gfx("OLC CodeJam 2020", 1280, 800, false);
-	Sfx sfx;
+	Gfx gfx("OLC CodeJam 2020", width, height, false, headless);
+	if (screenshotFile) gfx.saveScreenshot(screenshotFile, screenshotFrame);
+	Sfx sfx(headless || Gfx::useOffscreen);
 	Timer timer;
 	Game game(gfx, sfx, timer);
-	
-	game.start();
+	game.replay = &replay;
+
+	unsigned int seed = replay.isPlaying() ? replay.seed() : SDL_GetTicks();
+	if (recordFile && !replay.isPlaying()) {
+		replay.startRecording(recordFile, seed, gfx.width(), gfx.height());
+	}
+
+	Lockstep lockstep(lockstepPlayer, inputDelay);
+	if (lockstepHost) {
+		if (!lockstep.open(lockstepHost, lockstepPort) || !lockstep.connect(seed, 60000)) sys_crash("Could not connect to the other player.");
+		game.lockstep = &lockstep;
+	}
+
+	Client client;
+	if (connectHost) {
+		if (!client.open(connectHost, connectPort)) sys_crash("Could not reach the server.");
+		game.client = &client;
+	}
+
+	ChecksumLog checksums;
+	if (checksumFile) checksums.open(checksumFile);
+
+	game.start(seed);
 
 	SDL_Event event;
-	bool run = true;
+	int tick = 0;
+	Timer clock;
+	const float lockstepTickTime = 1.0f / 60;
+	float lockstepTime = 0;
+	if (simThread && !replay.isPlaying() && !game.lockstep && !game.client) {
+		// The simulation ticks on its own thread until the game ends, this one only draws
+		// what it publishes
+		SimThread sim(game, timer, &replay, &checksums);
+		while (sim.isRunning()) {
+			while (SDL_PollEvent(&event)) {
+				sim.handleEvent(event);
+			}
+			int mouseX, mouseY;
+			uint32_t mouseButtons = SDL_GetMouseState(&mouseX, &mouseY);
+			sim.setMouseState(mouseX, mouseY, mouseButtons);
+			auto snapshot = sim.next();
+			if (!snapshot) {
+				SDL_Delay(1);
+				continue;
+			}
+			if (sim.takeTextureReload()) game.reloadTextures();
+			gfx.beginFrame();
+			gfx.submit(snapshot->sprites);
+			gfx.endFrame();
+		}
+	}
 	while (game.shouldKeepRunning()) {
+		if (game.lockstep) {
+			while (SDL_PollEvent(&event)) {
+				game.handleEvent(event);
+			}
+			clock.lap();
+			lockstep.poll();
+
+			// Fixed rate ticks, waiting whenever the other player's input is late
+			lockstepTime = std::min(lockstepTime + clock.deltaTime(), 0.25f);
+			while (lockstepTime >= lockstepTickTime && lockstep.canAdvance()) {
+				lockstepTime -= lockstepTickTime;
+				timer.set(lockstepTickTime, (lockstep.tick() + 1) * double(lockstepTickTime));
+				game.update();
+				if (checksums.isOpen()) checksums.write(tick++, game.checksum());
+			}
+			gfx.beginFrame();
+			game.drawFrame();
+			gfx.endFrame();
+			continue;
+		}
+
+		if (replay.isPlaying()) {
+			if (!headless) {
+				while (SDL_PollEvent(&event)) {
+					if (event.type == SDL_QUIT) game.keepRunning = false;
+				}
+			}
+			if (!replay.nextTick()) break;
+
+			auto frameStart = SDL_GetPerformanceCounter();
+			for (auto& replayEvent : replay.events()) {
+				game.handleEvent(replayEvent);
+			}
+			timer.set(replay.deltaTime(), replay.elapsedTime());
+			game.update();
+			if (checksums.isOpen()) checksums.write(tick++, game.checksum());
+			gfx.beginFrame();
+			gfx.setSize(replay.width(), replay.height());
+			game.drawFrame();
+			gfx.endFrame();
+			replay.addFrameTime(float(double(SDL_GetPerformanceCounter() - frameStart) / SDL_GetPerformanceFrequency()));
+			continue;
+		}
+
 		while (SDL_PollEvent(&event)) {
+			replay.recordEvent(event);
 			game.handleEvent(event);
 		}
 		timer.lap();
+		replay.recordTimer(timer.deltaTime(), timer.elapsedTime());
 		game.update();
+		if (checksums.isOpen()) checksums.write(tick++, game.checksum());
 		gfx.beginFrame();
+		replay.recordSize(gfx.width(), gfx.height());
 		game.drawFrame();
 		gfx.endFrame();
+		replay.endTick();
+	}
+
+	if (game.lockstep && clock.elapsedTime() > 0) {
+		log("Lockstep sent %.0f and received %.0f bytes per second.", lockstep.bytesSent() / clock.elapsedTime(), lockstep.bytesReceived() / clock.elapsedTime());
+	}
+	if (game.client && timer.elapsedTime() > 0) {
+		log("Client sent %.0f and received %.0f bytes per second.", client.bytesSent() / timer.elapsedTime(), client.bytesReceived() / timer.elapsedTime());
 	}
+	if (replay.isPlaying()) replay.reportTimings(timingsFile);
+	replay.stop();
 
 	sys_shutdown();
 	return 0;
@@ -29,10 +29,12 @@ SOFTWARE.
 #include <Windows.h>
 #endif
 #include <fstream>
+#include <mutex>
 
 static std::ofstream logfile;
+static std::mutex logMutex;
 
-int sys_init() {
+int sys_init(bool headless) {
 	logfile.open("codejam.log");
 	if (!logfile.good()) {
 		sys_crash("Could not open log file.");
@@ -42,7 +44,8 @@ int sys_init() {
 	log("Hello, world!");
 	log("sys_init");
 
-	if (SDL_Init(SDL_INIT_EVERYTHING)) {
+	// Headless runs have no window and no audio device
+	if (SDL_Init(headless ? SDL_INIT_TIMER | SDL_INIT_EVENTS : SDL_INIT_EVERYTHING)) {
 		sys_crash("Could not initialize SDL2.");
 		return 1;
 	}
@@ -65,8 +68,9 @@ void sys_crash(const char* reason) {
 void log(const char* fmt, ...) {
 	va_list vl;
 	va_start(vl, fmt);
-	static char buf[512];
+	char buf[512];
 	vsprintf_s(buf, fmt, vl);
+	std::lock_guard<std::mutex> lock(logMutex);
 	logfile << buf << std::endl;
 	va_end(vl);
 	logfile.flush();
@@ -75,8 +79,9 @@ void log(const char* fmt, ...) {
 void log_error(const char* fmt, ...) {
 	va_list vl;
 	va_start(vl, fmt);
-	static char buf[512];
+	char buf[512];
 	vsprintf_s(buf, fmt, vl);
+	std::lock_guard<std::mutex> lock(logMutex);
 	logfile << "ERROR: " << buf << std::endl;
 	va_end(vl);
 	logfile.flush();
@@ -26,7 +26,7 @@ SOFTWARE.
 
 #include <string>
 
-int sys_init();
+int sys_init(bool headless = false);
 void sys_shutdown();
 void sys_crash(const char* reason);
 void log(const char* fmt, ...);
@@ -24,6 +24,7 @@ SOFTWARE.
 
 #pragma once
 
+#include "Random.h"
 #include <cstdlib>
 
 static inline int countNewlines(const char* text) {
@@ -54,7 +55,7 @@ static inline float clamp(float  v, float  min, float  max) {
 }
 
 static inline float frand(float min, float max) {
-	return min + (max - min) * rand() / RAND_MAX;
+	return Random::current().range(min, max);
 }
 
 static inline float easein(float t) {